@@ -0,0 +1,63 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+/**
+ Caching layer on top of any storage. Writes go directly to underlying storage (write-through),
+ reads are served from memory once value is known. Cached strings and binary values are kept only as wipeable
+ secure strings and byte arrays. Plain string and data reads return copy made for the caller.
+ */
+@interface CachedStorage : NSObject <StorageProtocol>
+
+/**
+ Number of reads served from memory.
+ */
+@property (atomic, assign, readonly) NSUInteger hitCount;
+
+/**
+ Number of reads forwarded to underlying storage.
+ */
+@property (atomic, assign, readonly) NSUInteger missCount;
+
+/**
+ Create cache on top of given storage.
+
+ @param storage Underlying storage. It should not be modified directly, otherwise cache must be invalidated.
+ @return New instance
+ */
+- (instancetype)initWithStorage:(id<StorageProtocol>)storage;
+
+/**
+ Wipe and remove all cached values. Next reads will go to underlying storage.
+ */
+- (void)invalidate;
+
+/**
+ Wipe and remove cached value for given key.
+
+ @param key Key of cached value.
+ */
+- (void)invalidateKey:(NSString *)key;
+
+@end
@@ -0,0 +1,296 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import "CachedStorage.h"
+
+@interface CachedStorage()
+
+@property (nonatomic, strong) id<StorageProtocol>                                       storage;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, id<EMSecureString>>       *strings;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, id<EMSecureByteArray>>    *bytes;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *>               *integers;
+
+@end
+
+@implementation CachedStorage
+
+// MARK: - Life Cycle
+
+- (instancetype)initWithStorage:(id<StorageProtocol>)storage {
+    if (self = [super init]) {
+        self.storage    = storage;
+        self.strings    = [NSMutableDictionary new];
+        self.bytes      = [NSMutableDictionary new];
+        self.integers   = [NSMutableDictionary new];
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    [self invalidate];
+}
+
+// MARK: - Public API
+
+- (void)invalidate {
+    @synchronized (self) {
+        for (id loopValue in [_strings.allValues arrayByAddingObjectsFromArray:_bytes.allValues]) {
+            [self wipeValue:loopValue];
+        }
+        [_strings removeAllObjects];
+        [_bytes removeAllObjects];
+        [_integers removeAllObjects];
+    }
+}
+
+- (void)invalidateKey:(NSString *)key {
+    @synchronized (self) {
+        [self wipeValue:_strings[key]];
+        [self wipeValue:_bytes[key]];
+        [_strings removeObjectForKey:key];
+        [_bytes removeObjectForKey:key];
+        [_integers removeObjectForKey:key];
+    }
+}
+
+// MARK: - StorageProtocol
+
+- (BOOL)writeString:(NSString *)value forKey:(NSString *)key {
+    @synchronized (self) {
+        BOOL retValue = [_storage writeString:value forKey:key];
+        [self cacheString:retValue ? value : nil forKey:key];
+        return retValue;
+    }
+}
+
+- (BOOL)writeInteger:(NSInteger)value forKey:(NSString *)key {
+    @synchronized (self) {
+        BOOL retValue = [_storage writeInteger:value forKey:key];
+        [self cacheInteger:retValue ? @(value) : nil forKey:key];
+        return retValue;
+    }
+}
+
+- (NSString *)readStringForKey:(NSString *)key {
+    @synchronized (self) {
+        id cached = _strings[key];
+        if (cached) {
+            _hitCount++;
+            return cached == [NSNull null] ? nil : [(id<EMSecureString>)cached stringValue];
+        }
+        
+        _missCount++;
+        NSString *retValue = [_storage readStringForKey:key];
+        _strings[key] = retValue ? [retValue secureString] : (id)[NSNull null];
+        return retValue;
+    }
+}
+
+- (NSInteger)readIntegerForKey:(NSString *)key {
+    @synchronized (self) {
+        NSNumber *cached = _integers[key];
+        if (cached) {
+            _hitCount++;
+            return cached.integerValue;
+        }
+        
+        _missCount++;
+        NSInteger retValue = [_storage readIntegerForKey:key];
+        _integers[key] = @(retValue);
+        return retValue;
+    }
+}
+
+- (BOOL)writeInt64:(int64_t)value forKey:(NSString *)key {
+    @synchronized (self) {
+        BOOL retValue = [_storage writeInt64:value forKey:key];
+        [self cacheInteger:retValue ? @(value) : nil forKey:key];
+        return retValue;
+    }
+}
+
+- (int64_t)readInt64ForKey:(NSString *)key {
+    @synchronized (self) {
+        NSNumber *cached = _integers[key];
+        if (cached) {
+            _hitCount++;
+            return cached.longLongValue;
+        }
+        
+        _missCount++;
+        int64_t retValue = [_storage readInt64ForKey:key];
+        _integers[key] = @(retValue);
+        return retValue;
+    }
+}
+
+- (BOOL)writeBool:(BOOL)value forKey:(NSString *)key {
+    @synchronized (self) {
+        BOOL retValue = [_storage writeBool:value forKey:key];
+        [self cacheInteger:retValue ? @(value) : nil forKey:key];
+        return retValue;
+    }
+}
+
+- (BOOL)readBoolForKey:(NSString *)key {
+    @synchronized (self) {
+        NSNumber *cached = _integers[key];
+        if (cached) {
+            _hitCount++;
+            return cached.boolValue;
+        }
+        
+        _missCount++;
+        BOOL retValue = [_storage readBoolForKey:key];
+        _integers[key] = @(retValue);
+        return retValue;
+    }
+}
+
+- (BOOL)writeBytes:(NSData *)value forKey:(NSString *)key {
+    @synchronized (self) {
+        BOOL retValue = [_storage writeBytes:value forKey:key];
+        [self cacheBytes:retValue ? [value secureByteArray:NO] : nil forKey:key];
+        return retValue;
+    }
+}
+
+- (NSData *)readBytesForKey:(NSString *)key {
+    @synchronized (self) {
+        id<EMSecureByteArray> cached = [self cachedBytesForKey:key];
+        return cached == (id)[NSNull null] ? nil : [NSData dataWithData:cached.dataValue];
+    }
+}
+
+- (BOOL)writeSecureBytes:(id<EMSecureByteArray>)value forKey:(NSString *)key {
+    // Caller keeps ownership of the value. Cache holds its own copy.
+    @synchronized (self) {
+        BOOL retValue = [_storage writeSecureBytes:value forKey:key];
+        [self cacheBytes:retValue ? [value.dataValue secureByteArray:YES] : nil forKey:key];
+        return retValue;
+    }
+}
+
+- (id<EMSecureByteArray>)readSecureBytesForKey:(NSString *)key {
+    // Caller is responsible for wiping the value, so it gets copy of the cached one.
+    @synchronized (self) {
+        id<EMSecureByteArray> cached = [self cachedBytesForKey:key];
+        return cached == (id)[NSNull null] ? nil : [cached.dataValue secureByteArray:YES];
+    }
+}
+
+- (BOOL)removeValueForKey:(NSString *)key {
+    @synchronized (self) {
+        BOOL retValue = [_storage removeValueForKey:key];
+        [self invalidateKey:key];
+        
+        // Missing value is cached as well, so we don't have to ask underlying storage again.
+        if (retValue) {
+            _strings[key]   = (id)[NSNull null];
+            _bytes[key]     = (id)[NSNull null];
+            _integers[key]  = @(0);
+        }
+        return retValue;
+    }
+}
+
+- (BOOL)commitValues:(NSDictionary<NSString *, id> *)values removeKeys:(NSArray<NSString *> *)keys {
+    @synchronized (self) {
+        BOOL retValue = [_storage commitValues:values removeKeys:keys];
+        
+        [values enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+            if (retValue && [value isKindOfClass:[NSString class]]) {
+                [self cacheString:value forKey:key];
+            } else if (retValue && [value isKindOfClass:[NSNumber class]]) {
+                [self cacheInteger:value forKey:key];
+            } else if (retValue && [value isKindOfClass:[NSData class]]) {
+                [self cacheBytes:[value secureByteArray:NO] forKey:key];
+            } else {
+                [self invalidateKey:key];
+            }
+        }];
+        for (NSString *loopKey in keys) {
+            [self invalidateKey:loopKey];
+            if (retValue) {
+                _strings[loopKey]   = (id)[NSNull null];
+                _bytes[loopKey]     = (id)[NSNull null];
+                _integers[loopKey]  = @(0);
+            }
+        }
+        
+        return retValue;
+    }
+}
+
+- (void)flush {
+    [_storage flush];
+}
+
+// MARK: - Private Helpers
+
+- (void)cacheString:(NSString *)value forKey:(NSString *)key {
+    // Same key might be read as different type. Keep only value we know for sure.
+    [self invalidateKey:key];
+    if (value) {
+        _strings[key] = [value secureString];
+    }
+}
+
+- (void)cacheBytes:(id<EMSecureByteArray>)value forKey:(NSString *)key {
+    [self invalidateKey:key];
+    if (value) {
+        _bytes[key] = value;
+    }
+}
+
+- (id<EMSecureByteArray>)cachedBytesForKey:(NSString *)key {
+    // Must be called from synchronized block. Missing value is returned as NSNull.
+    id<EMSecureByteArray> retValue = _bytes[key];
+    if (retValue) {
+        _hitCount++;
+        return retValue;
+    }
+    
+    _missCount++;
+    retValue = [_storage readSecureBytesForKey:key] ?: (id)[NSNull null];
+    _bytes[key] = retValue;
+    return retValue;
+}
+
+- (void)cacheInteger:(NSNumber *)value forKey:(NSString *)key {
+    [self invalidateKey:key];
+    if (value) {
+        _integers[key] = value;
+    }
+}
+
+- (void)wipeValue:(id)value {
+    if (value && value != [NSNull null]) {
+        [(id<EMSecureByteArray>)value wipe];
+    }
+}
+
+@end
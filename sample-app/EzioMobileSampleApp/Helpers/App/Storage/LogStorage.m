@@ -0,0 +1,241 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import "LogStorage.h"
+#import "LogStore.h"
+
+#define kLogStorageFile         @"SampleJournal.log"
+
+// Compaction is triggered once file is at least this big and mostly consists of obsolete records.
+#define kCompactionMinSize      (1024 * 1024)
+#define kCompactionGarbageRatio 0.5
+
+@interface LogStorage()
+
+@property (nonatomic, assign) LogStore          *store;
+@property (nonatomic, strong) dispatch_queue_t  compactionQueue;
+@property (nonatomic, assign) BOOL              compactionScheduled;
+
+@end
+
+@implementation LogStorage
+
+// MARK: - Life Cycle
+
+- (instancetype)initWithPath:(NSString *)path {
+    if (self = [super init]) {
+        LogStore *store = NULL;
+        if (LogStoreOpen(path.fileSystemRepresentation, &store)) {
+            return nil;
+        }
+        
+        self.store              = store;
+        self.compactionQueue    = dispatch_queue_create("LogStorage.compaction", DISPATCH_QUEUE_SERIAL);
+        
+        // Application might be suspended or killed. Make sure all changes are on disk.
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(flush)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
+    }
+    
+    return self;
+}
+
+- (instancetype)init {
+    NSURL *directory = [[NSFileManager defaultManager] URLForDirectory:NSApplicationSupportDirectory
+                                                              inDomain:NSUserDomainMask
+                                                     appropriateForURL:nil
+                                                                create:YES
+                                                                 error:nil];
+    return [self initWithPath:[directory URLByAppendingPathComponent:kLogStorageFile].path];
+}
+
+- (void)dealloc {
+    // Scheduled compaction keeps strong reference, so it can't be running at this point.
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (_store) {
+        LogStoreSync(_store);
+        LogStoreClose(_store);
+    }
+}
+
+// MARK: - StorageProtocol
+
+- (BOOL)writeString:(NSString *)value forKey:(NSString *)key {
+    return [self writeBytes:[value dataUsingEncoding:NSUTF8StringEncoding] forKey:key];
+}
+
+- (BOOL)writeInteger:(NSInteger)value forKey:(NSString *)key {
+    return [self writeInt64:value forKey:key];
+}
+
+- (BOOL)writeInt64:(int64_t)value forKey:(NSString *)key {
+    return [self writeBytes:[NSData dataWithBytes:&value length:sizeof(int64_t)] forKey:key];
+}
+
+- (BOOL)writeBool:(BOOL)value forKey:(NSString *)key {
+    uint8_t convertedValue = value ? 1 : 0;
+    return [self writeBytes:[NSData dataWithBytes:&convertedValue length:1] forKey:key];
+}
+
+- (BOOL)writeBytes:(NSData *)value forKey:(NSString *)key {
+    if (!value) {
+        return NO;
+    }
+    
+    const char  *keyBytes   = key.UTF8String;
+    BOOL        retValue    = LogStorePut(_store, keyBytes, strlen(keyBytes), value.bytes, value.length) == 0;
+    [self scheduleCompactionIfNeeded];
+    return retValue;
+}
+
+- (BOOL)writeSecureBytes:(id<EMSecureByteArray>)value forKey:(NSString *)key {
+    return [self writeBytes:value.dataValue forKey:key];
+}
+
+- (NSString *)readStringForKey:(NSString *)key {
+    NSData *value = [self readBytesForKey:key];
+    return value ? [[NSString alloc] initWithData:value encoding:NSUTF8StringEncoding] : nil;
+}
+
+- (NSInteger)readIntegerForKey:(NSString *)key {
+    return (NSInteger)[self readInt64ForKey:key];
+}
+
+- (int64_t)readInt64ForKey:(NSString *)key {
+    int64_t retValue = 0;
+    NSData  *value   = [self readBytesForKey:key];
+    [value getBytes:&retValue length:MIN(value.length, sizeof(int64_t))];
+    return retValue;
+}
+
+- (BOOL)readBoolForKey:(NSString *)key {
+    uint8_t retValue = 0;
+    [[self readBytesForKey:key] getBytes:&retValue length:1];
+    return retValue != 0;
+}
+
+- (NSData *)readBytesForKey:(NSString *)key {
+    const char  *keyBytes       = key.UTF8String;
+    void        *value          = NULL;
+    size_t      valueLength     = 0;
+    
+    if (LogStoreGet(_store, keyBytes, strlen(keyBytes), &value, &valueLength)) {
+        return nil;
+    }
+    
+    // Take ownership of copied value.
+    return [NSData dataWithBytesNoCopy:value length:valueLength freeWhenDone:YES];
+}
+
+- (id<EMSecureByteArray>)readSecureBytesForKey:(NSString *)key {
+    return [[self readBytesForKey:key] secureByteArray:NO];
+}
+
+- (BOOL)removeValueForKey:(NSString *)key {
+    const char  *keyBytes   = key.UTF8String;
+    BOOL        retValue    = LogStoreRemove(_store, keyBytes, strlen(keyBytes)) == 0;
+    [self scheduleCompactionIfNeeded];
+    return retValue;
+}
+
+- (BOOL)commitValues:(NSDictionary<NSString *, id> *)values removeKeys:(NSArray<NSString *> *)keys {
+    // Keep converted values alive until batch is written.
+    NSMutableArray      *buffers    = [NSMutableArray new];
+    NSMutableData       *operations = [NSMutableData dataWithLength:(values.count + keys.count) * sizeof(LogStoreOperation)];
+    LogStoreOperation   *operation  = operations.mutableBytes;
+    
+    for (NSString *loopKey in values) {
+        NSData *value = [self dataWithValue:values[loopKey]];
+        if (!value) {
+            return NO;
+        }
+        [buffers addObject:value];
+        
+        operation->key          = loopKey.UTF8String;
+        operation->keyLength    = strlen(operation->key);
+        operation->value        = value.bytes ?: "";
+        operation->valueLength  = value.length;
+        operation++;
+    }
+    for (NSString *loopKey in keys) {
+        operation->key          = loopKey.UTF8String;
+        operation->keyLength    = strlen(operation->key);
+        operation->value        = NULL;
+        operation->valueLength  = 0;
+        operation++;
+    }
+    
+    // Batch is durability barrier.
+    BOOL retValue = LogStoreWrite(_store, operations.bytes, values.count + keys.count) == 0 && LogStoreSync(_store) == 0;
+    [self scheduleCompactionIfNeeded];
+    return retValue;
+}
+
+- (void)flush {
+    LogStoreSync(_store);
+}
+
+// MARK: - Private Helpers
+
+- (NSData *)dataWithValue:(id)value {
+    if ([value isKindOfClass:[NSString class]]) {
+        return [value dataUsingEncoding:NSUTF8StringEncoding];
+    } else if ([value isKindOfClass:[NSNumber class]]) {
+        int64_t integerValue = [value longLongValue];
+        return [NSData dataWithBytes:&integerValue length:sizeof(int64_t)];
+    } else if ([value isKindOfClass:[NSData class]]) {
+        return value;
+    }
+    
+    return nil;
+}
+
+- (void)scheduleCompactionIfNeeded {
+    LogStoreStats stats = LogStoreGetStats(_store);
+    if (stats.fileSize < kCompactionMinSize || stats.liveSize > stats.fileSize * kCompactionGarbageRatio) {
+        return;
+    }
+    
+    @synchronized (self) {
+        if (_compactionScheduled) {
+            return;
+        }
+        _compactionScheduled = YES;
+    }
+    
+    // Other calls are blocked only for the short final part of compaction.
+    dispatch_async(_compactionQueue, ^{
+        if (LogStoreCompact(self.store) == 0) {
+            self->_compactionCount++;
+        }
+        @synchronized (self) {
+            self.compactionScheduled = NO;
+        }
+    });
+}
+
+@end
@@ -0,0 +1,779 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#include "LogStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// MARK: - Definitions
+
+// File starts with magic, records follow right after it.
+#define kLogStoreMagic              "LOGSTOR1"
+#define kLogStoreMagicLength        8
+
+// Record is tombstone of removed key.
+#define kLogStoreFlagRemove         0x1u
+// Record is followed by other record of the same atomic batch.
+#define kLogStoreFlagMore           0x2u
+
+#define kLogStoreMinMapLength       (1u << 20)
+#define kLogStoreMinIndexCapacity   64
+#define kLogStoreCopyChunk          (64u << 10)
+
+// Header of each record. Key and value data follow right after it.
+// Checksum covers rest of the header, key and value.
+typedef struct {
+    uint32_t    crc;
+    uint32_t    keyLength;
+    uint32_t    valueLength;
+    uint32_t    flags;
+} LogStoreRecord;
+
+// Keys are not copied to memory. They are compared directly with mapped file.
+typedef struct {
+    uint64_t    hash;
+    // Zero marks empty slot. File header is at offset zero, so no record can be there.
+    uint64_t    offset;
+} LogStoreSlot;
+
+// Open addressing hash table with linear probing.
+typedef struct {
+    LogStoreSlot    *slots;
+    size_t          capacity;
+    size_t          count;
+    uint64_t        liveSize;
+} LogStoreIndex;
+
+struct LogStore {
+    pthread_mutex_t lock;
+    char            *path;
+    int             fd;
+    uint64_t        size;
+    const uint8_t   *map;
+    size_t          mapLength;
+    LogStoreIndex   index;
+    int             compacting;
+};
+
+// MARK: - Checksum
+
+static uint32_t         sCrcTable[256];
+static pthread_once_t   sCrcOnce = PTHREAD_ONCE_INIT;
+
+static void LogStoreCrcInit(void) {
+    for (uint32_t loop = 0; loop < 256; loop++) {
+        uint32_t crc = loop;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        sCrcTable[loop] = crc;
+    }
+}
+
+static uint32_t LogStoreCrc(uint32_t crc, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+    crc = ~crc;
+    while (length--) {
+        crc = sCrcTable[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t LogStoreRecordCrc(const LogStoreRecord *record, const void *key, const void *value) {
+    uint32_t crc = LogStoreCrc(0, &record->keyLength, sizeof(LogStoreRecord) - sizeof(uint32_t));
+    crc = LogStoreCrc(crc, key, record->keyLength);
+    return LogStoreCrc(crc, value, record->valueLength);
+}
+
+// MARK: - Records
+
+static uint64_t LogStoreHash(const void *key, size_t length) {
+    // FNV-1a
+    const uint8_t   *bytes  = key;
+    uint64_t        hash    = 14695981039346656037ULL;
+    while (length--) {
+        hash = (hash ^ *bytes++) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static LogStoreRecord LogStoreRecordAt(const uint8_t *map, uint64_t offset) {
+    // Records are not aligned.
+    LogStoreRecord record;
+    memcpy(&record, map + offset, sizeof(LogStoreRecord));
+    return record;
+}
+
+static uint64_t LogStoreRecordSize(LogStoreRecord record) {
+    return sizeof(LogStoreRecord) + (uint64_t)record.keyLength + record.valueLength;
+}
+
+// MARK: - Index
+
+static int LogStoreIndexInit(LogStoreIndex *index, size_t count) {
+    // Keep load factor under 3/4.
+    size_t capacity = kLogStoreMinIndexCapacity;
+    while (capacity * 3 < count * 4) {
+        capacity <<= 1;
+    }
+    
+    memset(index, 0, sizeof(LogStoreIndex));
+    index->slots = calloc(capacity, sizeof(LogStoreSlot));
+    if (!index->slots) {
+        return ENOMEM;
+    }
+    index->capacity = capacity;
+    return 0;
+}
+
+static void LogStoreIndexFree(LogStoreIndex *index) {
+    free(index->slots);
+    memset(index, 0, sizeof(LogStoreIndex));
+}
+
+static void LogStoreIndexPlace(LogStoreIndex *index, uint64_t hash, uint64_t offset) {
+    size_t mask = index->capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    while (index->slots[slot].offset) {
+        slot = (slot + 1) & mask;
+    }
+    index->slots[slot].hash     = hash;
+    index->slots[slot].offset   = offset;
+    index->count++;
+}
+
+static int LogStoreIndexReserve(LogStoreIndex *index, size_t additional) {
+    if ((index->count + additional) * 4 <= index->capacity * 3) {
+        return 0;
+    }
+    
+    // Rehash does not need keys. Hash is enough to find new place.
+    LogStoreIndex resized;
+    int result = LogStoreIndexInit(&resized, index->count + additional);
+    if (result) {
+        return result;
+    }
+    for (size_t loop = 0; loop < index->capacity; loop++) {
+        if (index->slots[loop].offset) {
+            LogStoreIndexPlace(&resized, index->slots[loop].hash, index->slots[loop].offset);
+        }
+    }
+    resized.liveSize = index->liveSize;
+    
+    LogStoreIndexFree(index);
+    *index = resized;
+    return 0;
+}
+
+static LogStoreSlot *LogStoreIndexFind(const LogStoreIndex *index, const uint8_t *map,
+                                       uint64_t hash, const void *key, size_t keyLength) {
+    size_t mask = index->capacity - 1;
+    for (size_t slot = (size_t)hash & mask; index->slots[slot].offset; slot = (slot + 1) & mask) {
+        if (index->slots[slot].hash != hash) {
+            continue;
+        }
+        
+        LogStoreRecord record = LogStoreRecordAt(map, index->slots[slot].offset);
+        if (record.keyLength == keyLength &&
+            memcmp(map + index->slots[slot].offset + sizeof(LogStoreRecord), key, keyLength) == 0) {
+            return &index->slots[slot];
+        }
+    }
+    
+    return NULL;
+}
+
+static void LogStoreIndexErase(LogStoreIndex *index, LogStoreSlot *slot) {
+    // Backward shift deletion. Following entries are moved closer to their ideal position, so no tombstones are needed.
+    size_t mask = index->capacity - 1;
+    size_t hole = (size_t)(slot - index->slots);
+    for (size_t next = (hole + 1) & mask; index->slots[next].offset; next = (next + 1) & mask) {
+        size_t ideal = (size_t)index->slots[next].hash & mask;
+        if (((next - ideal) & mask) >= ((next - hole) & mask)) {
+            index->slots[hole] = index->slots[next];
+            hole = next;
+        }
+    }
+    index->slots[hole].hash     = 0;
+    index->slots[hole].offset   = 0;
+    index->count--;
+}
+
+static int LogStoreIndexApply(LogStoreIndex *index, const uint8_t *map, uint64_t offset) {
+    LogStoreRecord  record  = LogStoreRecordAt(map, offset);
+    const uint8_t   *key    = map + offset + sizeof(LogStoreRecord);
+    uint64_t        hash    = LogStoreHash(key, record.keyLength);
+    LogStoreSlot    *slot   = LogStoreIndexFind(index, map, hash, key, record.keyLength);
+    
+    // Older record of the same key is garbage from now on.
+    if (slot) {
+        index->liveSize -= LogStoreRecordSize(LogStoreRecordAt(map, slot->offset));
+        if (record.flags & kLogStoreFlagRemove) {
+            LogStoreIndexErase(index, slot);
+        } else {
+            slot->offset = offset;
+            index->liveSize += LogStoreRecordSize(record);
+        }
+        return 0;
+    }
+    
+    if (record.flags & kLogStoreFlagRemove) {
+        return 0;
+    }
+    
+    int result = LogStoreIndexReserve(index, 1);
+    if (!result) {
+        LogStoreIndexPlace(index, hash, offset);
+        index->liveSize += LogStoreRecordSize(record);
+    }
+    return result;
+}
+
+static int LogStoreIndexReplay(LogStoreIndex *index, const uint8_t *map, uint64_t start, uint64_t end, uint64_t *validEnd) {
+    // Apply only valid and complete batches. Everything after first damaged record is ignored.
+    uint64_t offset     = start;
+    uint64_t batchStart = start;
+    
+    *validEnd = start;
+    while (end - offset >= sizeof(LogStoreRecord)) {
+        LogStoreRecord  record  = LogStoreRecordAt(map, offset);
+        uint64_t        size    = LogStoreRecordSize(record);
+        if (size > end - offset) {
+            break;
+        }
+        
+        const uint8_t *key = map + offset + sizeof(LogStoreRecord);
+        if (LogStoreRecordCrc(&record, key, key + record.keyLength) != record.crc) {
+            break;
+        }
+        
+        offset += size;
+        if (record.flags & kLogStoreFlagMore) {
+            continue;
+        }
+        
+        for (uint64_t loop = batchStart; loop < offset; loop += LogStoreRecordSize(LogStoreRecordAt(map, loop))) {
+            int result = LogStoreIndexApply(index, map, loop);
+            if (result) {
+                return result;
+            }
+        }
+        batchStart = offset;
+        *validEnd  = offset;
+    }
+    
+    return 0;
+}
+
+// MARK: - File
+
+static int LogStoreWriteAll(int fd, const void *data, size_t length, uint64_t offset) {
+    const uint8_t *bytes = data;
+    while (length) {
+        ssize_t written = pwrite(fd, bytes, length, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        bytes   += written;
+        length  -= (size_t)written;
+        offset  += (uint64_t)written;
+    }
+    
+    return 0;
+}
+
+static int LogStoreSyncFile(int fd) {
+#ifdef F_FULLFSYNC
+    // On Apple platforms fsync does not flush drive cache.
+    if (fcntl(fd, F_FULLFSYNC) == 0) {
+        return 0;
+    }
+#endif
+    return fsync(fd) ? errno : 0;
+}
+
+static int LogStoreSyncDirectory(const char *path) {
+    // Rename is durable only once directory entry itself reaches the disk.
+    const char  *slash      = strrchr(path, '/');
+    char        *directory  = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : strdup(".");
+    if (!directory) {
+        return ENOMEM;
+    }
+    
+    int fd      = open(directory, O_RDONLY | O_CLOEXEC);
+    int result  = fd < 0 ? errno : LogStoreSyncFile(fd);
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(directory);
+    return result;
+}
+
+static int LogStoreMapFile(int fd, uint64_t size, const uint8_t **map, size_t *mapLength) {
+    // Map more than needed, so appends do not require remapping each time. Only written part is ever accessed.
+    uint64_t page   = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t length = size * 2 < kLogStoreMinMapLength ? kLogStoreMinMapLength : size * 2;
+    length = (length + page - 1) / page * page;
+    if (length > SIZE_MAX) {
+        return EFBIG;
+    }
+    
+    void *mapped = mmap(NULL, (size_t)length, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        return errno;
+    }
+    
+    if (*map) {
+        munmap((void *)*map, *mapLength);
+    }
+    *map        = mapped;
+    *mapLength  = (size_t)length;
+    return 0;
+}
+
+static int LogStoreLoad(LogStore *store) {
+    struct stat info;
+    if (fstat(store->fd, &info)) {
+        return errno;
+    }
+    store->size = (uint64_t)info.st_size;
+    
+    // New file or crash during creation.
+    if (store->size < kLogStoreMagicLength) {
+        int result = LogStoreWriteAll(store->fd, kLogStoreMagic, kLogStoreMagicLength, 0);
+        if (!result && ftruncate(store->fd, kLogStoreMagicLength)) {
+            result = errno;
+        }
+        if (!result) {
+            result = LogStoreSyncFile(store->fd);
+        }
+        if (result) {
+            return result;
+        }
+        store->size = kLogStoreMagicLength;
+    }
+    
+    int result = LogStoreMapFile(store->fd, store->size, &store->map, &store->mapLength);
+    if (result) {
+        return result;
+    }
+    if (memcmp(store->map, kLogStoreMagic, kLogStoreMagicLength)) {
+        return EILSEQ;
+    }
+    
+    uint64_t validEnd = 0;
+    result = LogStoreIndexReplay(&store->index, store->map, kLogStoreMagicLength, store->size, &validEnd);
+    
+    // Drop damaged tail, so new records are not appended after garbage.
+    if (!result && validEnd < store->size) {
+        if (ftruncate(store->fd, (off_t)validEnd)) {
+            return errno;
+        }
+        store->size = validEnd;
+    }
+    
+    return result;
+}
+
+// MARK: - Public API
+
+int LogStoreOpen(const char *path, LogStore **store) {
+    pthread_once(&sCrcOnce, LogStoreCrcInit);
+    
+    LogStore *retValue = calloc(1, sizeof(LogStore));
+    if (!retValue) {
+        return ENOMEM;
+    }
+    
+    int result = pthread_mutex_init(&retValue->lock, NULL);
+    if (result) {
+        free(retValue);
+        return result;
+    }
+    
+    retValue->fd = -1;
+    retValue->path = strdup(path);
+    if (!retValue->path) {
+        result = ENOMEM;
+    }
+    if (!result) {
+        result = LogStoreIndexInit(&retValue->index, 0);
+    }
+    if (!result) {
+        retValue->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (retValue->fd < 0) {
+            result = errno;
+        }
+    }
+    if (!result) {
+        result = LogStoreLoad(retValue);
+    }
+    
+    if (result) {
+        LogStoreClose(retValue);
+    } else {
+        *store = retValue;
+    }
+    
+    return result;
+}
+
+void LogStoreClose(LogStore *store) {
+    if (!store) {
+        return;
+    }
+    
+    if (store->map) {
+        munmap((void *)store->map, store->mapLength);
+    }
+    if (store->fd >= 0) {
+        close(store->fd);
+    }
+    LogStoreIndexFree(&store->index);
+    free(store->path);
+    pthread_mutex_destroy(&store->lock);
+    free(store);
+}
+
+int LogStorePut(LogStore *store, const void *key, size_t keyLength, const void *value, size_t valueLength) {
+    // Empty value is still value, not a removal.
+    LogStoreOperation operation = { key, keyLength, value ? value : "", value ? valueLength : 0 };
+    return LogStoreWrite(store, &operation, 1);
+}
+
+int LogStoreRemove(LogStore *store, const void *key, size_t keyLength) {
+    LogStoreOperation operation = { key, keyLength, NULL, 0 };
+    return LogStoreWrite(store, &operation, 1);
+}
+
+int LogStoreWrite(LogStore *store, const LogStoreOperation *operations, size_t count) {
+    if (!count) {
+        return 0;
+    }
+    
+    // Serialize whole batch first, so it's appended with single write outside of the lock.
+    size_t length = 0;
+    for (size_t loop = 0; loop < count; loop++) {
+        size_t valueLength = operations[loop].value ? operations[loop].valueLength : 0;
+        if (operations[loop].keyLength > UINT32_MAX || valueLength > UINT32_MAX) {
+            return EINVAL;
+        }
+        
+        // Batch must fit to single buffer. Each step is checked, so the sum can't wrap around.
+        size_t available = SIZE_MAX - length;
+        if (available < sizeof(LogStoreRecord) ||
+            available - sizeof(LogStoreRecord) < operations[loop].keyLength ||
+            available - sizeof(LogStoreRecord) - operations[loop].keyLength < valueLength) {
+            return EOVERFLOW;
+        }
+        length += sizeof(LogStoreRecord) + operations[loop].keyLength + valueLength;
+    }
+    
+    uint8_t *buffer = malloc(length);
+    if (!buffer) {
+        return ENOMEM;
+    }
+    
+    uint8_t *position = buffer;
+    for (size_t loop = 0; loop < count; loop++) {
+        const LogStoreOperation *operation = &operations[loop];
+        LogStoreRecord          record;
+        
+        record.keyLength    = (uint32_t)operation->keyLength;
+        record.valueLength  = operation->value ? (uint32_t)operation->valueLength : 0;
+        record.flags        = (operation->value ? 0 : kLogStoreFlagRemove) | (loop + 1 < count ? kLogStoreFlagMore : 0);
+        record.crc          = LogStoreRecordCrc(&record, operation->key, operation->value);
+        
+        memcpy(position, &record, sizeof(LogStoreRecord));
+        position += sizeof(LogStoreRecord);
+        if (record.keyLength) {
+            memcpy(position, operation->key, record.keyLength);
+            position += record.keyLength;
+        }
+        if (record.valueLength) {
+            memcpy(position, operation->value, record.valueLength);
+            position += record.valueLength;
+        }
+    }
+    
+    pthread_mutex_lock(&store->lock);
+    
+    // Make sure that applying to index can't fail once records are written.
+    uint64_t    start   = store->size;
+    int         result  = LogStoreIndexReserve(&store->index, count);
+    if (!result) {
+        result = LogStoreWriteAll(store->fd, buffer, length, start);
+    }
+    if (!result && start + length > store->mapLength) {
+        result = LogStoreMapFile(store->fd, start + length, &store->map, &store->mapLength);
+    }
+    
+    if (result) {
+        // Do not leave partial batch behind.
+        if (ftruncate(store->fd, (off_t)start)) {
+            // Damaged tail will be dropped on next open.
+        }
+    } else {
+        store->size = start + length;
+        for (uint64_t offset = start; offset < store->size; offset += LogStoreRecordSize(LogStoreRecordAt(store->map, offset))) {
+            LogStoreIndexApply(&store->index, store->map, offset);
+        }
+    }
+    
+    pthread_mutex_unlock(&store->lock);
+    
+    free(buffer);
+    return result;
+}
+
+int LogStoreGet(LogStore *store, const void *key, size_t keyLength, void **value, size_t *valueLength) {
+    int result = 0;
+    
+    pthread_mutex_lock(&store->lock);
+    
+    LogStoreSlot *slot = LogStoreIndexFind(&store->index, store->map, LogStoreHash(key, keyLength), key, keyLength);
+    if (slot) {
+        LogStoreRecord  record  = LogStoreRecordAt(store->map, slot->offset);
+        void            *copy   = malloc(record.valueLength ? record.valueLength : 1);
+        if (copy) {
+            memcpy(copy, store->map + slot->offset + sizeof(LogStoreRecord) + record.keyLength, record.valueLength);
+            *value       = copy;
+            *valueLength = record.valueLength;
+        } else {
+            result = ENOMEM;
+        }
+    } else {
+        result = ENOENT;
+    }
+    
+    pthread_mutex_unlock(&store->lock);
+    
+    return result;
+}
+
+int LogStoreSync(LogStore *store) {
+    pthread_mutex_lock(&store->lock);
+    int result = LogStoreSyncFile(store->fd);
+    pthread_mutex_unlock(&store->lock);
+    
+    return result;
+}
+
+LogStoreStats LogStoreGetStats(LogStore *store) {
+    LogStoreStats retValue;
+    
+    pthread_mutex_lock(&store->lock);
+    retValue.count      = store->index.count;
+    retValue.fileSize   = store->size;
+    retValue.liveSize   = store->index.liveSize;
+    pthread_mutex_unlock(&store->lock);
+    
+    return retValue;
+}
+
+// MARK: - Compaction
+
+static int LogStoreCompareOffset(const void *first, const void *second) {
+    uint64_t lhs = *(const uint64_t *)first;
+    uint64_t rhs = *(const uint64_t *)second;
+    return lhs < rhs ? -1 : lhs > rhs;
+}
+
+static int LogStoreCopyLive(const uint8_t *source, const uint64_t *offsets, size_t count,
+                            int fd, LogStoreIndex *index, uint64_t *size) {
+    // Records are collected to larger chunks to save system calls.
+    size_t      capacity    = kLogStoreCopyChunk;
+    size_t      length      = 0;
+    uint8_t     *chunk      = malloc(capacity);
+    int         result      = chunk ? 0 : ENOMEM;
+    
+    for (size_t loop = 0; loop < count && !result; loop++) {
+        LogStoreRecord  record      = LogStoreRecordAt(source, offsets[loop]);
+        uint64_t        recordSize  = LogStoreRecordSize(record);
+        const uint8_t   *key        = source + offsets[loop] + sizeof(LogStoreRecord);
+        
+        if (length + recordSize > capacity && length) {
+            result  = LogStoreWriteAll(fd, chunk, length, *size);
+            *size  += length;
+            length  = 0;
+        }
+        if (!result && recordSize > capacity) {
+            uint8_t *resized = realloc(chunk, (size_t)recordSize);
+            if (resized) {
+                chunk       = resized;
+                capacity    = (size_t)recordSize;
+            } else {
+                result = ENOMEM;
+            }
+        }
+        if (result) {
+            break;
+        }
+        
+        // Record is no longer part of any batch.
+        record.flags &= ~kLogStoreFlagMore;
+        record.crc    = LogStoreRecordCrc(&record, key, key + record.keyLength);
+        memcpy(chunk + length, &record, sizeof(LogStoreRecord));
+        memcpy(chunk + length + sizeof(LogStoreRecord), key, (size_t)recordSize - sizeof(LogStoreRecord));
+        
+        // Keys of live records are unique. No need to compare them.
+        LogStoreIndexPlace(index, LogStoreHash(key, record.keyLength), *size + length);
+        index->liveSize += recordSize;
+        length          += (size_t)recordSize;
+    }
+    
+    if (!result && length) {
+        result  = LogStoreWriteAll(fd, chunk, length, *size);
+        *size  += length;
+    }
+    
+    free(chunk);
+    return result;
+}
+
+int LogStoreCompact(LogStore *store) {
+    // Take snapshot of live records. File is append only, so they will not change meanwhile.
+    pthread_mutex_lock(&store->lock);
+    if (store->compacting) {
+        pthread_mutex_unlock(&store->lock);
+        return EBUSY;
+    }
+    
+    size_t      count       = store->index.count;
+    uint64_t    *offsets    = malloc((count ? count : 1) * sizeof(uint64_t));
+    uint64_t    snapshotEnd = store->size;
+    int         oldFd       = store->fd;
+    if (!offsets) {
+        pthread_mutex_unlock(&store->lock);
+        return ENOMEM;
+    }
+    for (size_t loop = 0, used = 0; loop < store->index.capacity; loop++) {
+        if (store->index.slots[loop].offset) {
+            offsets[used++] = store->index.slots[loop].offset;
+        }
+    }
+    store->compacting = 1;
+    
+    pthread_mutex_unlock(&store->lock);
+    
+    // Own mapping of the snapshot. Store mapping might be replaced by concurrent writes.
+    const uint8_t   *source         = NULL;
+    size_t          sourceLength    = 0;
+    const uint8_t   *target         = NULL;
+    size_t          targetLength    = 0;
+    uint64_t        size            = kLogStoreMagicLength;
+    LogStoreIndex   index           = { 0 };
+    char            *path           = malloc(strlen(store->path) + sizeof(".compact"));
+    int             fd              = -1;
+    int             result          = path ? 0 : ENOMEM;
+    
+    if (!result) {
+        sprintf(path, "%s.compact", store->path);
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        result = fd < 0 ? errno : 0;
+    }
+    if (!result) {
+        result = LogStoreMapFile(oldFd, snapshotEnd, &source, &sourceLength);
+    }
+    if (!result) {
+        result = LogStoreIndexInit(&index, count);
+    }
+    if (!result) {
+        result = LogStoreWriteAll(fd, kLogStoreMagic, kLogStoreMagicLength, 0);
+    }
+    if (!result) {
+        // Keep original order, so reading of old file is sequential.
+        qsort(offsets, count, sizeof(uint64_t), LogStoreCompareOffset);
+        result = LogStoreCopyLive(source, offsets, count, fd, &index, &size);
+    }
+    
+    pthread_mutex_lock(&store->lock);
+    
+    // Changes written during compaction are copied as they are.
+    uint64_t compactedEnd = size;
+    if (!result && store->size > snapshotEnd) {
+        result  = LogStoreWriteAll(fd, store->map + snapshotEnd, (size_t)(store->size - snapshotEnd), size);
+        size   += store->size - snapshotEnd;
+    }
+    if (!result) {
+        result = LogStoreSyncFile(fd);
+    }
+    if (!result) {
+        result = LogStoreMapFile(fd, size, &target, &targetLength);
+    }
+    if (!result) {
+        uint64_t validEnd = 0;
+        result = LogStoreIndexReplay(&index, target, compactedEnd, size, &validEnd);
+    }
+    if (!result && rename(path, store->path)) {
+        result = errno;
+    }
+    
+    // New file is already in place. Failed directory sync is reported, but store must switch to it anyway.
+    int syncResult = result ? 0 : LogStoreSyncDirectory(store->path);
+    
+    if (result) {
+        // Keep original file.
+        if (target) {
+            munmap((void *)target, targetLength);
+        }
+        if (fd >= 0) {
+            close(fd);
+            unlink(path);
+        }
+        LogStoreIndexFree(&index);
+    } else {
+        munmap((void *)store->map, store->mapLength);
+        close(store->fd);
+        LogStoreIndexFree(&store->index);
+        
+        store->fd           = fd;
+        store->map          = target;
+        store->mapLength    = targetLength;
+        store->size         = size;
+        store->index        = index;
+    }
+    store->compacting = 0;
+    
+    pthread_mutex_unlock(&store->lock);
+    
+    if (source) {
+        munmap((void *)source, sourceLength);
+    }
+    free(offsets);
+    free(path);
+    return result ? result : syncResult;
+}
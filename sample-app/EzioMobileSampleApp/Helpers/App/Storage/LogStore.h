@@ -0,0 +1,149 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#ifndef LogStore_h
+#define LogStore_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Append-only key / value file with in-memory index. Portable C (POSIX) so it can be built and verified outside of iOS.
+
+ Each change is appended as CRC protected record. Latest record of given key wins, removal is stored as tombstone.
+ Reads go through memory mapped file. Incomplete or corrupted tail (crash during write) is dropped on open.
+ Obsolete records are removed by compaction, which copies live records to new file without blocking other calls
+ for most of its run.
+
+ All functions are thread safe and return 0 on success or errno value on failure.
+ Stored data are not encrypted. Do not use it for secrets.
+ */
+typedef struct LogStore LogStore;
+
+/**
+ Single change in atomic batch.
+ */
+typedef struct {
+    const void  *key;
+    size_t      keyLength;
+    // NULL value means removal of given key.
+    const void  *value;
+    size_t      valueLength;
+} LogStoreOperation;
+
+/**
+ Basic information about store state. Used to decide whether compaction make sense.
+ */
+typedef struct {
+    // Number of live keys.
+    size_t      count;
+    // Size of whole file.
+    uint64_t    fileSize;
+    // Size of records which are still relevant.
+    uint64_t    liveSize;
+} LogStoreStats;
+
+/**
+ Open or create store in given file. Damaged tail of existing file is truncated.
+
+ @param path Path to store file.
+ @param store Opened store. Must be released with LogStoreClose.
+ @return 0 on success, errno value otherwise.
+ */
+int LogStoreOpen(const char *path, LogStore **store);
+
+/**
+ Close store and release all resources. Must not be called while compaction is running.
+
+ @param store Store to close.
+ */
+void LogStoreClose(LogStore *store);
+
+/**
+ Store value for given key. It will override existing key.
+ Change is visible right away, but it's not guaranteed to survive power loss until LogStoreSync.
+
+ @return 0 on success, errno value otherwise.
+ */
+int LogStorePut(LogStore *store, const void *key, size_t keyLength, const void *value, size_t valueLength);
+
+/**
+ Remove given key.
+
+ @return 0 on success, errno value otherwise.
+ */
+int LogStoreRemove(LogStore *store, const void *key, size_t keyLength);
+
+/**
+ Apply all operations at once. After crash either all of them or none of them are present.
+
+ @param store Target store.
+ @param operations List of changes.
+ @param count Number of changes.
+ @return 0 on success, errno value otherwise.
+ */
+int LogStoreWrite(LogStore *store, const LogStoreOperation *operations, size_t count);
+
+/**
+ Get copy of stored value.
+
+ @param store Source store.
+ @param key Key of stored value.
+ @param keyLength Length of key.
+ @param value Copy of value. Must be released with free.
+ @param valueLength Length of value.
+ @return 0 on success, ENOENT if key does not exists, errno value otherwise.
+ */
+int LogStoreGet(LogStore *store, const void *key, size_t keyLength, void **value, size_t *valueLength);
+
+/**
+ Make sure that all changes are stored on disk.
+
+ @return 0 on success, errno value otherwise.
+ */
+int LogStoreSync(LogStore *store);
+
+/**
+ Rewrite file with live records only. Long running, should be called from background thread.
+ Other calls are blocked only while tail written during compaction is copied and files are swapped.
+
+ @return 0 on success, EBUSY if other compaction is running, errno value otherwise.
+ */
+int LogStoreCompact(LogStore *store);
+
+/**
+ Get current store statistics.
+ */
+LogStoreStats LogStoreGetStats(LogStore *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LogStore_h */
@@ -0,0 +1,99 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#ifdef DEBUG
+
+/**
+ Type of load used during measurement.
+ */
+typedef NS_ENUM(NSInteger, StorageBenchmarkLoad) {
+    // 90 % reads, 10 % writes.
+    StorageBenchmarkLoadReadHeavy,
+    // 10 % reads, 90 % writes.
+    StorageBenchmarkLoadWriteHeavy,
+    // 50 % reads, 50 % writes.
+    StorageBenchmarkLoadMixed
+};
+
+/**
+ Result of one measured configuration.
+ */
+@interface StorageBenchmarkResult : NSObject
+
+@property (nonatomic, copy,   readonly) NSString                *storageName;
+@property (nonatomic, assign, readonly) StorageBenchmarkLoad    load;
+@property (nonatomic, assign, readonly) NSUInteger              keyCount;
+@property (nonatomic, assign, readonly) NSUInteger              valueSize;
+@property (nonatomic, assign, readonly) double                  operationsPerSecond;
+@property (nonatomic, assign, readonly) NSTimeInterval          p99Latency;
+
+/**
+ Growth of heap memory in use during measured operations.
+ */
+@property (nonatomic, assign, readonly) int64_t                 bytesAllocated;
+
+@end
+
+/**
+ Debug only tool to compare cost of the same calls on different storage implementations.
+ Only keys with benchmark prefix are used and they are removed after each configuration.
+ */
+@interface StorageBenchmark : NSObject
+
+/**
+ Number of prefilled keys. Default is 10 up to 100 000.
+ */
+@property (nonatomic, copy) NSArray<NSNumber *> *keyCounts;
+
+/**
+ Size of stored values in bytes. Default is 16, 256 and 4096.
+ */
+@property (nonatomic, copy) NSArray<NSNumber *> *valueSizes;
+
+/**
+ Number of measured operations for each configuration. Default is 1000.
+ */
+@property (nonatomic, assign) NSUInteger        operationCount;
+
+/**
+ Measure all loads, key counts and value sizes on given storage. Long running, do not call on main thread.
+
+ @param storage Storage to be measured.
+ @param name Name of storage used in results.
+ @return Result for each configuration.
+ */
+- (NSArray<StorageBenchmarkResult *> *)runWithStorage:(id<StorageProtocol>)storage name:(NSString *)name;
+
+/**
+ Format results as table suitable for log.
+
+ @param results Results of one or more runs.
+ @return Formatted table.
+ */
++ (NSString *)reportWithResults:(NSArray<StorageBenchmarkResult *> *)results;
+
+@end
+
+#endif
@@ -0,0 +1,185 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#ifdef DEBUG
+
+#import "StorageBenchmark.h"
+#import <malloc/malloc.h>
+
+#define kBenchmarkKeyPrefix @"benchmark."
+
+@interface StorageBenchmarkResult()
+
+@property (nonatomic, copy)   NSString                *storageName;
+@property (nonatomic, assign) StorageBenchmarkLoad    load;
+@property (nonatomic, assign) NSUInteger              keyCount;
+@property (nonatomic, assign) NSUInteger              valueSize;
+@property (nonatomic, assign) double                  operationsPerSecond;
+@property (nonatomic, assign) NSTimeInterval          p99Latency;
+@property (nonatomic, assign) int64_t                 bytesAllocated;
+
+@end
+
+@implementation StorageBenchmarkResult
+
+@end
+
+static int BenchmarkCompareLatency(const void *first, const void *second) {
+    uint64_t lhs = *(const uint64_t *)first;
+    uint64_t rhs = *(const uint64_t *)second;
+    return lhs < rhs ? -1 : lhs > rhs;
+}
+
+static int64_t BenchmarkHeapInUse(void) {
+    malloc_statistics_t stats;
+    malloc_zone_statistics(NULL, &stats);
+    return (int64_t)stats.size_in_use;
+}
+
+@implementation StorageBenchmark
+
+// MARK: - Life Cycle
+
+- (id)init {
+    if (self = [super init]) {
+        self.keyCounts      = @[@10, @100, @1000, @10000, @100000];
+        self.valueSizes     = @[@16, @256, @4096];
+        self.operationCount = 1000;
+    }
+    
+    return self;
+}
+
+// MARK: - Public API
+
+- (NSArray<StorageBenchmarkResult *> *)runWithStorage:(id<StorageProtocol>)storage name:(NSString *)name {
+    NSMutableArray *retValue = [NSMutableArray new];
+    
+    for (NSNumber *loopKeyCount in _keyCounts) {
+        for (NSNumber *loopValueSize in _valueSizes) {
+            NSString *value = [@"" stringByPaddingToLength:loopValueSize.unsignedIntegerValue withString:@"x" startingAtIndex:0];
+            
+            // Prefill is not measured.
+            @autoreleasepool {
+                for (NSUInteger index = 0; index < loopKeyCount.unsignedIntegerValue; index++) {
+                    [storage writeString:value forKey:[kBenchmarkKeyPrefix stringByAppendingFormat:@"%lu", (unsigned long)index]];
+                }
+                [storage flush];
+            }
+            
+            for (NSNumber *loopLoad in @[@(StorageBenchmarkLoadReadHeavy), @(StorageBenchmarkLoadWriteHeavy), @(StorageBenchmarkLoadMixed)]) {
+                StorageBenchmarkResult *result = [self measureStorage:storage
+                                                                 load:loopLoad.integerValue
+                                                             keyCount:loopKeyCount.unsignedIntegerValue
+                                                                value:value];
+                result.storageName = name;
+                [retValue addObject:result];
+            }
+            
+            // Leave storage as it was.
+            @autoreleasepool {
+                for (NSUInteger index = 0; index < loopKeyCount.unsignedIntegerValue; index++) {
+                    [storage removeValueForKey:[kBenchmarkKeyPrefix stringByAppendingFormat:@"%lu", (unsigned long)index]];
+                }
+                [storage flush];
+            }
+        }
+    }
+    
+    return retValue;
+}
+
++ (NSString *)reportWithResults:(NSArray<StorageBenchmarkResult *> *)results {
+    NSArray         *loadNames  = @[@"read", @"write", @"mixed"];
+    NSMutableString *retValue   = [NSMutableString stringWithString:@"storage\tload\tkeys\tvalue\tops/s\tp99 [us]\theap [B]\n"];
+    
+    for (StorageBenchmarkResult *loopResult in results) {
+        [retValue appendFormat:@"%@\t%@\t%lu\t%lu\t%.0f\t%.1f\t%lld\n",
+         loopResult.storageName,
+         loadNames[loopResult.load],
+         (unsigned long)loopResult.keyCount,
+         (unsigned long)loopResult.valueSize,
+         loopResult.operationsPerSecond,
+         loopResult.p99Latency * 1e6,
+         loopResult.bytesAllocated];
+    }
+    
+    return retValue;
+}
+
+// MARK: - Private Helpers
+
+- (StorageBenchmarkResult *)measureStorage:(id<StorageProtocol>)storage
+                                      load:(StorageBenchmarkLoad)load
+                                  keyCount:(NSUInteger)keyCount
+                                     value:(NSString *)value {
+    uint32_t writePercent   = load == StorageBenchmarkLoadReadHeavy ? 10 : load == StorageBenchmarkLoadWriteHeavy ? 90 : 50;
+    uint64_t *latencies     = calloc(MAX(_operationCount, 1), sizeof(uint64_t));
+    
+    // Keys are prepared up front, so only storage itself is measured.
+    NSMutableArray<NSString *>  *keys   = [NSMutableArray arrayWithCapacity:_operationCount];
+    NSMutableData               *writes = [NSMutableData dataWithLength:_operationCount];
+    uint8_t                     *write  = writes.mutableBytes;
+    for (NSUInteger index = 0; index < _operationCount; index++) {
+        [keys addObject:[kBenchmarkKeyPrefix stringByAppendingFormat:@"%u", arc4random_uniform((uint32_t)keyCount)]];
+        write[index] = arc4random_uniform(100) < writePercent;
+    }
+    
+    int64_t     heapBefore  = BenchmarkHeapInUse();
+    uint64_t    start       = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    @autoreleasepool {
+        for (NSUInteger index = 0; index < _operationCount; index++) {
+            uint64_t operationStart = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+            if (write[index]) {
+                [storage writeString:value forKey:keys[index]];
+            } else {
+                [storage readStringForKey:keys[index]];
+            }
+            latencies[index] = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - operationStart;
+        }
+        
+        // Postponed writes are part of the cost.
+        [storage flush];
+    }
+    uint64_t    total       = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start;
+    int64_t     heapAfter   = BenchmarkHeapInUse();
+    
+    qsort(latencies, _operationCount, sizeof(uint64_t), BenchmarkCompareLatency);
+    
+    StorageBenchmarkResult *retValue = [StorageBenchmarkResult new];
+    retValue.load                   = load;
+    retValue.keyCount               = keyCount;
+    retValue.valueSize              = value.length;
+    retValue.operationsPerSecond    = total ? _operationCount * 1e9 / total : 0;
+    retValue.p99Latency             = _operationCount ? latencies[(_operationCount - 1) * 99 / 100] / 1e9 : 0;
+    retValue.bytesAllocated         = heapAfter - heapBefore;
+    
+    free(latencies);
+    return retValue;
+}
+
+@end
+
+#endif
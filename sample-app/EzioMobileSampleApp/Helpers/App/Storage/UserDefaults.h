@@ -28,4 +28,29 @@
  */
 @interface UserDefaults : NSObject <StorageProtocol>
 
+/**
+ Create storage on top of standard user defaults.
+
+ @return New instance
+ */
+- (instancetype)init;
+
+/**
+ Create storage on top of user defaults with given suite name. Useful for scratch data, which must not mix with app values.
+
+ @param suiteName Name of user defaults suite.
+ @return New instance
+ */
+- (instancetype)initWithSuiteName:(NSString *)suiteName NS_DESIGNATED_INITIALIZER;
+
+/**
+ Remove all values of the suite storage was created with. Standard user defaults are never removed.
+ */
+- (void)removeSuite;
+
+/**
+ Number of times values were persisted to disk. Multiple writes within short time are persisted together.
+ */
+@property (atomic, assign, readonly) NSUInteger flushCount;
+
 @end
@@ -25,9 +25,18 @@
 
 #import "UserDefaults.h"
 
+// Writes within this time are persisted together.
+#define kFlushWindow 0.5
+
+// Instances on the same suite share values, so all of them share one lock as well.
+#define kLock [UserDefaults class]
+
 @interface UserDefaults()
 
-@property (nonatomic, strong) NSUserDefaults *manager;
+@property (nonatomic, strong) NSUserDefaults    *manager;
+@property (nonatomic, copy)   NSString          *suiteName;
+@property (nonatomic, copy)   NSString          *domainName;
+@property (nonatomic, assign) BOOL              flushScheduled;
 
 @end
 
@@ -35,36 +44,202 @@
 
 // MARK: - Life Cycle
 
-- (id)init {
+- (instancetype)init {
+    return [self initWithSuiteName:nil];
+}
+
+- (instancetype)initWithSuiteName:(NSString *)suiteName {
     if (self = [super init]) {
-        self.manager = [NSUserDefaults standardUserDefaults];
+        self.manager    = suiteName ? [[NSUserDefaults alloc] initWithSuiteName:suiteName] : [NSUserDefaults standardUserDefaults];
+        self.suiteName  = suiteName;
+        self.domainName = suiteName ?: [NSBundle mainBundle].bundleIdentifier;
+        
+        // Application might be suspended before scheduled flush. Persist everything right away.
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(flush)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
     }
     
     return self;
 }
 
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self flush];
+}
+
+// MARK: - Public API
+
+- (void)removeSuite {
+    if (!_suiteName) {
+        return;
+    }
+    
+    @synchronized (kLock) {
+        [_manager removePersistentDomainForName:_suiteName];
+        [self synchronize];
+    }
+}
+
 // MARK: - StorageProtocol
 
 - (BOOL)writeString:(NSString *)value forKey:(NSString *)key {
-    [_manager setObject:value forKey:key];
-    return [_manager synchronize];
+    // Value is available for reading right away. Persisting is postponed.
+    @synchronized (kLock) {
+        [_manager setObject:value forKey:key];
+        [self scheduleFlush];
+        return YES;
+    }
 }
 
 - (BOOL)writeInteger:(NSInteger)value forKey:(NSString *)key {
-    [_manager setInteger:value forKey:key];
-    return [_manager synchronize];
+    @synchronized (kLock) {
+        [_manager setInteger:value forKey:key];
+        [self scheduleFlush];
+        return YES;
+    }
 }
 
 - (NSString *)readStringForKey:(NSString *)key {
-    return [_manager objectForKey:key];
+    @synchronized (kLock) {
+        return [_manager objectForKey:key];
+    }
 }
 
 - (NSInteger)readIntegerForKey:(NSString *)key {
-    return [_manager integerForKey:key];
+    @synchronized (kLock) {
+        return [_manager integerForKey:key];
+    }
+}
+
+- (BOOL)writeInt64:(int64_t)value forKey:(NSString *)key {
+    @synchronized (kLock) {
+        [_manager setObject:@(value) forKey:key];
+        [self scheduleFlush];
+        return YES;
+    }
+}
+
+- (int64_t)readInt64ForKey:(NSString *)key {
+    @synchronized (kLock) {
+        return [[_manager objectForKey:key] longLongValue];
+    }
+}
+
+- (BOOL)writeBool:(BOOL)value forKey:(NSString *)key {
+    @synchronized (kLock) {
+        [_manager setBool:value forKey:key];
+        [self scheduleFlush];
+        return YES;
+    }
+}
+
+- (BOOL)readBoolForKey:(NSString *)key {
+    @synchronized (kLock) {
+        return [_manager boolForKey:key];
+    }
+}
+
+- (BOOL)writeBytes:(NSData *)value forKey:(NSString *)key {
+    @synchronized (kLock) {
+        [_manager setObject:value forKey:key];
+        [self scheduleFlush];
+        return YES;
+    }
+}
+
+- (NSData *)readBytesForKey:(NSString *)key {
+    @synchronized (kLock) {
+        return [_manager dataForKey:key];
+    }
+}
+
+- (BOOL)writeSecureBytes:(id<EMSecureByteArray>)value forKey:(NSString *)key {
+    // User defaults are not encrypted. Value is stored as plain data.
+    return [self writeBytes:[NSData dataWithData:value.dataValue] forKey:key];
+}
+
+- (id<EMSecureByteArray>)readSecureBytesForKey:(NSString *)key {
+    return [[self readBytesForKey:key] secureByteArray:NO];
 }
 
 - (BOOL)removeValueForKey:(NSString *)key {
-    [_manager removeObjectForKey:key];
-    return YES;
+    @synchronized (kLock) {
+        [_manager removeObjectForKey:key];
+        [self scheduleFlush];
+        
+        // Value might still be provided by other domain, for example registered defaults.
+        return [_manager objectForKey:key] == nil;
+    }
+}
+
+- (BOOL)commitValues:(NSDictionary<NSString *, id> *)values removeKeys:(NSArray<NSString *> *)keys {
+    // No instance of this class can see batch half applied or later reverted. Only keys of the batch are touched,
+    // so values written meanwhile by anyone using user defaults directly are never overwritten.
+    @synchronized (kLock) {
+        // Remember stored values only. Registered defaults must not end up persisted by revert.
+        NSDictionary        *domain     = [_manager persistentDomainForName:_domainName];
+        NSMutableDictionary *original   = [NSMutableDictionary new];
+        for (NSString *loopKey in [values.allKeys arrayByAddingObjectsFromArray:keys ?: @[]]) {
+            original[loopKey] = domain[loopKey] ?: [NSNull null];
+        }
+        
+        [values enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+            [self.manager setObject:value forKey:key];
+        }];
+        for (NSString *loopKey in keys) {
+            [_manager removeObjectForKey:loopKey];
+        }
+        
+        // Batch is durability barrier. Persist it together with all pending writes.
+        if ([self synchronize]) {
+            return YES;
+        }
+        
+        // Return to original state before lock is released.
+        [original enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+            if (value == [NSNull null]) {
+                [self.manager removeObjectForKey:key];
+            } else {
+                [self.manager setObject:value forKey:key];
+            }
+        }];
+        [self synchronize];
+        return NO;
+    }
+}
+
+- (void)flush {
+    @synchronized (kLock) {
+        if (!_flushScheduled) {
+            return;
+        }
+    }
+    [self synchronize];
+}
+
+// MARK: - Private Helpers
+
+- (void)scheduleFlush {
+    @synchronized (kLock) {
+        // Flush is already on the way. It will take this write as well.
+        if (_flushScheduled) {
+            return;
+        }
+        _flushScheduled = YES;
+    }
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kFlushWindow * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [self flush];
+    });
+}
+
+- (BOOL)synchronize {
+    @synchronized (kLock) {
+        _flushScheduled = NO;
+        _flushCount++;
+    }
+    return [_manager synchronize];
 }
 @end
@@ -43,6 +43,11 @@
  */
 @property (nonnull, strong, readonly) id<StorageProtocol>   storageFast;
 
+/**
+ Return instance of file based storage for larger non secret data like message queues. (LogStorage)
+ */
+@property (nonnull, strong, readonly) id<StorageProtocol>   storageJournal;
+
 /**
  Used for handling all push related actions.
  */
@@ -25,6 +25,9 @@
 
 #import "Protector/Storage/SecureStorage.h"
 #import "App/Storage/UserDefaults.h"
+#import "App/Storage/CachedStorage.h"
+#import "App/Storage/LogStorage.h"
+#import "App/Storage/StorageBenchmark.h"
 #import "../AppDelegate.h"
 
 #import "SideMenuViewController.h"
@@ -78,11 +81,21 @@ static CMain *sInstance = nil;
         }];
     }
     
-    _storageSecure      = [SecureStorage    new];
-    _storageFast        = [UserDefaults     new];
+    // Values like client id are read on each push, but almost never change. Keep them in memory.
+    _storageSecure      = [[CachedStorage alloc] initWithStorage:[SecureStorage new]];
+    _storageFast        = [[CachedStorage alloc] initWithStorage:[UserDefaults new]];
+    // Fallback to user defaults in case that journal file can't be opened.
+    _storageJournal     = [LogStorage new] ?: [UserDefaults new];
     _managerPush        = [PushManager      new];
     _managerToken       = [TokenManager     new];
     _managerQRCode      = [QRCodeManager    new];
+    
+#ifdef DEBUG
+    // Launch with -StorageBenchmark argument to compare storage implementations.
+    if ([[NSProcessInfo processInfo].arguments containsObject:@"-StorageBenchmark"]) {
+        [self runStorageBenchmark];
+    }
+#endif
 }
 
 - (void)updateRootViewController {
@@ -96,6 +109,36 @@ static CMain *sInstance = nil;
     return _managerToken.tokenDevice ? [SideMenuViewController protectorVC] : [ProvisionerViewController viewController];
 }
 
+#ifdef DEBUG
+- (void)runStorageBenchmark {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        // Scratch storages only. Production identifiers and application caches are never touched.
+        NSString            *journalPath    = [NSTemporaryDirectory() stringByAppendingPathComponent:@"StorageBenchmark.log"];
+        SecureStorage       *secure         = [[SecureStorage alloc] initWithIdentifier:@"StorageBenchmark"];
+        SecureStorage       *secureCached   = [[SecureStorage alloc] initWithIdentifier:@"StorageBenchmarkCached"];
+        UserDefaults        *defaults       = [[UserDefaults alloc] initWithSuiteName:@"StorageBenchmark"];
+        StorageBenchmark    *benchmark      = [StorageBenchmark new];
+        NSMutableArray      *results        = [NSMutableArray new];
+        NSDictionary        *storages       = @{@"secure"       : secure,
+                                                @"secureCached" : [[CachedStorage alloc] initWithStorage:secureCached],
+                                                @"defaults"     : defaults,
+                                                @"journal"      : [[LogStorage alloc] initWithPath:journalPath]};
+        
+        [storages enumerateKeysAndObjectsUsingBlock:^(NSString *name, id<StorageProtocol> storage, BOOL *stop) {
+            [results addObjectsFromArray:[benchmark runWithStorage:storage name:name]];
+        }];
+        
+        // Do not leave any scratch data behind.
+        [secure removeStorage];
+        [secureCached removeStorage];
+        [defaults removeSuite];
+        [[NSFileManager defaultManager] removeItemAtPath:journalPath error:nil];
+        
+        NSLog(@"%@", [StorageBenchmark reportWithResults:results]);
+    });
+}
+#endif
+
 - (NSSet *)moduleConfigurations {    
     // OTP module is required for token management and OTP calculation.
     EMOtpConfiguration  *otpCFG = [EMOtpConfiguration configurationWithJailbreakPolicy:CFG_OTP_JAILBREAK_POLICY()];
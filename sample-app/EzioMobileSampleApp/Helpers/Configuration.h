@@ -56,6 +56,11 @@ extern NSArray                          *CFG_MSP_SIGN_KEYS();
 // APP CONFIG
 extern NSURL                            *CFG_PRIVACY_POLICY_URL();
 
+// TUTO
+extern NSString                         *CFG_TUTO_URL_ROOT();
+extern NSString                         *CFG_TUTO_BASIC_AUTH_JWT();
+extern NSString                         *CFG_TUTO_BASIC_AUTH_API_KEY();
+
 // SECURE LOG
 extern NSData                           *CFG_SECURE_LOG_RSA_KEY_MODULUS();
 extern NSData                           *CFG_SECURE_LOG_RSA_KEY_EXPONENT();
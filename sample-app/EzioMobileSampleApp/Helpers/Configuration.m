@@ -347,6 +347,35 @@ NSURL *CFG_PRIVACY_POLICY_URL() {
     return [NSURL URLWithString:@""];
 }
 
+// MARK: - TUTO
+
+/**
+ Replace this URL with your own tutorial server. Used by HttpManager to verify OTP and signatures.
+ 
+ @return Tutorial server URL.
+ */
+NSString *CFG_TUTO_URL_ROOT() {
+    return @"";
+}
+
+/**
+ Replace this string with your own JWT for tutorial server.
+ 
+ @return Value of Authorization header.
+ */
+NSString *CFG_TUTO_BASIC_AUTH_JWT() {
+    return @"";
+}
+
+/**
+ Replace this string with your own API key for tutorial server.
+ 
+ @return Value of X-API-KEY header.
+ */
+NSString *CFG_TUTO_BASIC_AUTH_API_KEY() {
+    return @"";
+}
+
 
 // MARK: - SECURE LOG
 
@@ -0,0 +1,254 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#include "HttpJson.h"
+
+#include <string.h>
+
+#define HTTP_JSON_LITERAL(__STR__) { __STR__, sizeof(__STR__) - 1 }
+
+const char * const kHttpJsonResultPath[2] = { "state", "result" };
+
+const HttpJsonLiteral kHttpJsonAuthOtp[3] = {
+    HTTP_JSON_LITERAL("{\"name\":\"Auth_OTP\",\"input\":{\"userId\":\""),
+    HTTP_JSON_LITERAL("\",\"otp\":\""),
+    HTTP_JSON_LITERAL("\"}}")
+};
+
+const HttpJsonLiteral kHttpJsonSignOtp[5] = {
+    HTTP_JSON_LITERAL("{\"name\":\"Sign_OTP\",\"input\":{\"userId\":\""),
+    HTTP_JSON_LITERAL("\",\"otp\":\""),
+    HTTP_JSON_LITERAL("\",\"transactionData\":{\"amount\":\""),
+    HTTP_JSON_LITERAL("\",\"beneficiary\":\""),
+    HTTP_JSON_LITERAL("\"}}}")
+};
+
+const HttpJsonLiteral kHttpJsonSignOtpBatch[8] = {
+    HTTP_JSON_LITERAL("{\"name\":\"Sign_OTP_Batch\",\"input\":{\"userId\":\""),
+    HTTP_JSON_LITERAL("\",\"transactions\":["),
+    HTTP_JSON_LITERAL("{\"otp\":\""),
+    HTTP_JSON_LITERAL(",{\"otp\":\""),
+    HTTP_JSON_LITERAL("\",\"transactionData\":{\"amount\":\""),
+    HTTP_JSON_LITERAL("\",\"beneficiary\":\""),
+    HTTP_JSON_LITERAL("\"}}"),
+    HTTP_JSON_LITERAL("]}}")
+};
+
+// MARK: - Private Helpers
+
+static void HttpJsonSkipWhitespace(HttpJsonScanner *scanner) {
+    while (scanner->cursor < scanner->end &&
+           (*scanner->cursor == ' ' || *scanner->cursor == '\t' || *scanner->cursor == '\n' || *scanner->cursor == '\r')) {
+        scanner->cursor++;
+    }
+}
+
+static bool HttpJsonSkipString(HttpJsonScanner *scanner) {
+    // Cursor must point to opening quote.
+    for (const char *loopChar = scanner->cursor + 1; loopChar < scanner->end; loopChar++) {
+        if (*loopChar == '\\') {
+            loopChar++;
+        } else if (*loopChar == '"') {
+            scanner->cursor = loopChar + 1;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// MARK: - Public API
+
+HttpJsonScanner HttpJsonScannerMake(const void *bytes, size_t length) {
+    HttpJsonScanner retValue;
+    retValue.cursor = bytes;
+    retValue.end    = retValue.cursor + length;
+    return retValue;
+}
+
+bool HttpJsonSkipValue(HttpJsonScanner *scanner) {
+    size_t depth = 0;
+    
+    HttpJsonSkipWhitespace(scanner);
+    while (scanner->cursor < scanner->end) {
+        switch (*scanner->cursor) {
+            case '"':
+                if (!HttpJsonSkipString(scanner)) {
+                    return false;
+                }
+                break;
+            case '{':
+            case '[':
+                depth++;
+                scanner->cursor++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0) {
+                    return false;
+                }
+                depth--;
+                scanner->cursor++;
+                break;
+            case ',':
+            case ':':
+                if (depth == 0) {
+                    return false;
+                }
+                scanner->cursor++;
+                break;
+            default:
+                // Numbers, literals and whitespace inside containers.
+                scanner->cursor++;
+                if (depth == 0 && (scanner->cursor == scanner->end || strchr(",}] \t\n\r", *scanner->cursor))) {
+                    return true;
+                }
+                continue;
+        }
+        
+        if (depth == 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool HttpJsonExpect(HttpJsonScanner *scanner, char expected) {
+    HttpJsonSkipWhitespace(scanner);
+    if (scanner->cursor < scanner->end && *scanner->cursor == expected) {
+        scanner->cursor++;
+        return true;
+    }
+    
+    return false;
+}
+
+bool HttpJsonFindKey(HttpJsonScanner *scanner, const char *key) {
+    size_t keyLength = strlen(key);
+    
+    if (!HttpJsonExpect(scanner, '{')) {
+        return false;
+    }
+    
+    HttpJsonSkipWhitespace(scanner);
+    if (scanner->cursor < scanner->end && *scanner->cursor == '}') {
+        return false;
+    }
+    
+    do {
+        HttpJsonSkipWhitespace(scanner);
+        const char *keyStart = scanner->cursor + 1;
+        if (scanner->cursor >= scanner->end || *scanner->cursor != '"' || !HttpJsonSkipString(scanner)) {
+            return false;
+        }
+        
+        // Keys we are looking for does not contain any escaped characters. Simple compare is enough.
+        bool found = (size_t)(scanner->cursor - 1 - keyStart) == keyLength && !memcmp(keyStart, key, keyLength);
+        if (!HttpJsonExpect(scanner, ':')) {
+            return false;
+        }
+        
+        if (found) {
+            HttpJsonSkipWhitespace(scanner);
+            return true;
+        }
+        
+        if (!HttpJsonSkipValue(scanner)) {
+            return false;
+        }
+    } while (HttpJsonExpect(scanner, ','));
+    
+    return false;
+}
+
+bool HttpJsonFindPath(HttpJsonScanner *scanner, const char * const *path, size_t count) {
+    for (size_t index = 0; index < count; index++) {
+        if (!HttpJsonFindKey(scanner, path[index])) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool HttpJsonFindString(HttpJsonScanner scanner, const char *key, const char **literal, size_t *length) {
+    if (!HttpJsonFindKey(&scanner, key) || scanner.cursor >= scanner.end || *scanner.cursor != '"') {
+        return false;
+    }
+    
+    const char *start = scanner.cursor;
+    if (!HttpJsonSkipString(&scanner)) {
+        return false;
+    }
+    
+    *literal    = start;
+    *length     = (size_t)(scanner.cursor - start);
+    return true;
+}
+
+size_t HttpJsonEscape(const char *value, char *target) {
+    static const char   hex[]       = "0123456789abcdef";
+    size_t              retValue    = 0;
+    
+    // Copy runs of safe bytes at once and escape only quotes, backslash and control characters.
+    const char *run = value;
+    for (const char *loopChar = value; *loopChar; loopChar++) {
+        unsigned char   current     = (unsigned char)*loopChar;
+        char            escaped[6]  = { '\\', 0, '0', '0', 0, 0 };
+        size_t          length      = 2;
+        
+        if (current == '"' || current == '\\') {
+            escaped[1] = (char)current;
+        } else if (current == '\n') {
+            escaped[1] = 'n';
+        } else if (current == '\r') {
+            escaped[1] = 'r';
+        } else if (current == '\t') {
+            escaped[1] = 't';
+        } else if (current < 0x20) {
+            escaped[1] = 'u';
+            escaped[4] = hex[current >> 4];
+            escaped[5] = hex[current & 0x0F];
+            length = 6;
+        } else {
+            continue;
+        }
+        
+        if (target) {
+            memcpy(target + retValue, run, (size_t)(loopChar - run));
+            memcpy(target + retValue + (loopChar - run), escaped, length);
+        }
+        retValue += (size_t)(loopChar - run) + length;
+        run = loopChar + 1;
+    }
+    
+    size_t rest = strlen(run);
+    if (target) {
+        memcpy(target + retValue, run, rest);
+    }
+    
+    return retValue + rest;
+}
@@ -0,0 +1,148 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#ifndef HttpJson_h
+#define HttpJson_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ Forward only scanner of raw JSON response. Portable C, so it can be built and verified outside of iOS.
+
+ Responses might contain big audit or risk blobs we are not interested in.
+ Instead of building whole object tree, we walk the raw bytes and skip everything except requested path.
+ Scanner does not validate skipped values, it only keeps track of strings and nesting.
+ */
+typedef struct {
+    const char  *cursor;
+    const char  *end;
+} HttpJsonScanner;
+
+/**
+ Create scanner over given bytes. Bytes must stay valid while scanner is used.
+
+ @param bytes Raw JSON.
+ @param length Length of JSON.
+ @return Scanner pointing to start of JSON.
+ */
+HttpJsonScanner HttpJsonScannerMake(const void *bytes, size_t length);
+
+/**
+ Skip whole value scanner points to, including nested objects and arrays.
+
+ @return true if value was skipped.
+ */
+bool HttpJsonSkipValue(HttpJsonScanner *scanner);
+
+/**
+ Skip whitespace and given character.
+
+ @return true if next non whitespace character was the expected one.
+ */
+bool HttpJsonExpect(HttpJsonScanner *scanner, char expected);
+
+/**
+ Find key in object scanner points to. On success scanner points to value of the key.
+ Keys are compared without unescaping.
+
+ @param scanner Scanner pointing to object.
+ @param key Key to find.
+ @return true if key was found.
+ */
+bool HttpJsonFindKey(HttpJsonScanner *scanner, const char *key);
+
+/**
+ Find nested object keys one by one. On success scanner points to value of the last key.
+
+ @param scanner Scanner pointing to object.
+ @param path Keys from outermost to innermost.
+ @param count Number of keys.
+ @return true if whole path was found.
+ */
+bool HttpJsonFindPath(HttpJsonScanner *scanner, const char * const *path, size_t count);
+
+/**
+ Find string value of given key in object scanner points to. Scanner itself is not moved,
+ so caller can read multiple keys from same object.
+
+ @param scanner Scanner pointing to object.
+ @param key Key to find.
+ @param literal Start of value including quotes. Content is still escaped.
+ @param length Length of value including quotes.
+ @return true if key was found and its value is string.
+ */
+bool HttpJsonFindString(HttpJsonScanner scanner, const char *key, const char **literal, size_t *length);
+
+/**
+ Path to result object in server response. Result holds "code" and "message" strings.
+ */
+extern const char * const kHttpJsonResultPath[2];
+
+// MARK: - Request bodies
+
+/**
+ Pre-encoded literal part of request body. Requests have fixed shape, so only escaped values
+ are written between the literals. Shared by HttpManager and load generator, so both send the same bytes.
+ */
+typedef struct {
+    const char  *bytes;
+    size_t      length;
+} HttpJsonLiteral;
+
+/**
+ {"name":"Auth_OTP","input":{"userId":"%@","otp":"%@"}}
+ */
+extern const HttpJsonLiteral kHttpJsonAuthOtp[3];
+
+/**
+ {"name":"Sign_OTP","input":{"userId":"%@","otp":"%@","transactionData":{"amount":"%@","beneficiary":"%@"}}}
+ */
+extern const HttpJsonLiteral kHttpJsonSignOtp[5];
+
+/**
+ {"name":"Sign_OTP_Batch","input":{"userId":"%@","transactions":[{"otp":"%@","transactionData":{"amount":"%@","beneficiary":"%@"}},...]}}
+ Literal 2 opens first item, literal 3 any following one.
+ */
+extern const HttpJsonLiteral kHttpJsonSignOtpBatch[8];
+
+/**
+ Escape string value for request body. Quotes, backslash and control characters are escaped, rest is copied as it is.
+
+ @param value Zero terminated UTF-8 string.
+ @param target Buffer for escaped value or NULL to only compute its length. Value is not zero terminated.
+ @return Length of escaped value.
+ */
+size_t HttpJsonEscape(const char *value, char *target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HttpJson_h */
@@ -25,8 +25,110 @@
 
 typedef void (^HttpManagerCompletion)(BOOL success, NSString *message);
 
+/// Single transaction in batch sign request.
+@interface HttpSignItem : NSObject
+
+@property (nonatomic, readonly, copy) NSString *otp;
+@property (nonatomic, readonly, copy) NSString *amount;
+@property (nonatomic, readonly, copy) NSString *beneficiary;
+
+/// Simple constructor.
+/// @param otp Calculated OTP.
+/// @param amount Amount to sign.
+/// @param beneficiary Beneficiary to sign.
++ (instancetype)itemWithOtp:(NSString *)otp amount:(NSString *)amount beneficiary:(NSString *)beneficiary;
+
+@end
+
+/// Server verdict for one item of batch request.
+@interface HttpResult : NSObject
+
+@property (nonatomic, readonly, assign) BOOL        success;
+@property (nonatomic, readonly, copy)   NSString    *message;
+
+@end
+
+typedef void (^HttpManagerBatchCompletion)(NSArray<HttpResult *> *results);
+
+/// Endpoints with collected timing.
+typedef NS_ENUM(NSInteger, HttpEndpoint) {
+    HttpEndpointAuthOtp,
+    HttpEndpointSignOtp,
+    HttpEndpointSignOtpBatch
+};
+
+/// Measured phases of single request. Network phases are zero when connection was reused.
+typedef NS_ENUM(NSInteger, HttpTimingPhase) {
+    HttpTimingPhaseEncode,      // Building request body.
+    HttpTimingPhaseDns,         // Domain lookup.
+    HttpTimingPhaseConnect,     // TCP connection without TLS.
+    HttpTimingPhaseTls,         // TLS handshake.
+    HttpTimingPhaseServer,      // From request start to first byte of response.
+    HttpTimingPhaseTransfer,    // Receiving response body.
+    HttpTimingPhaseDecode,      // Reading result from response.
+    HttpTimingPhaseTotal        // Whole request including client side phases.
+};
+
+/// Client of the tutorial Auth_OTP / Sign_OTP endpoints.
+/// Sample app target does not compile this class, since none of its flows talk to own server.
+/// It is built and exercised by ProtectorSampleTests, and the same wire format is load tested by Tools/LoadGen
+/// (including the TLS handshake reuse benchmark behind connection keep-alive of the shared session).
 @interface HttpManager : NSObject
 
+/// Server endpoint all requests are posted to.
+@property (nonatomic, copy, readonly) NSString                                  *url;
+
+/// Headers added to each request. Usually authorization.
+@property (nonatomic, copy, readonly) NSDictionary<NSString *, NSString *>      *headers;
+
+/// User id sent with each request. When nil, name of currently enrolled token is used.
+/// Setting explicit value allows to drive requests without enrolled token, for example from load test.
+@property (atomic, copy)              NSString                                  *userId;
+
+/// How many times should be failed request repeated. Requests carry one time OTP, so only failures where
+/// request never left the device are retried: host not found, DNS lookup failure and refused connection.
+/// Default value is 2.
+@property (atomic, assign) NSUInteger   maxRetryCount;
+
+/// Number of requests actually sent to server.
+@property (atomic, assign, readonly) NSUInteger issuedRequestCount;
+
+/// Number of requests joined to identical request already in progress instead of being sent.
+@property (atomic, assign, readonly) NSUInteger coalescedRequestCount;
+
+/// Create manager with configured tutorial server and authorization.
+- (instancetype)init;
+
+/// Create manager for given server.
+/// @param url Server endpoint all requests are posted to.
+/// @param headers Headers added to each request.
+- (instancetype)initWithURL:(NSString *)url headers:(NSDictionary<NSString *, NSString *> *)headers;
+
+/// Create manager for given server with own session configuration. For example with stub protocol in tests.
+/// @param url Server endpoint all requests are posted to.
+/// @param headers Headers added to each request.
+/// @param configuration Base of shared session configuration. Ephemeral configuration is used when nil.
+- (instancetype)initWithURL:(NSString *)url
+                    headers:(NSDictionary<NSString *, NSString *> *)headers
+              configuration:(NSURLSessionConfiguration *)configuration NS_DESIGNATED_INITIALIZER;
+
+/// Close shared session and all kept alive connections.
+/// Should be called on logout. It's called automatically when application goes to background and when token is removed.
+/// Next request will create new session.
+- (void)invalidateSession;
+
+/// Get percentile of recently collected timing. Only last few hundreds requests are kept.
+/// @param percentile Requested percentile in range 0 - 100. For example 50, 90 or 99.
+/// @param endpoint Endpoint we are interested in.
+/// @param phase Request phase we are interested in.
+/// @return Duration in seconds or 0 if there are no samples yet.
+- (NSTimeInterval)timingPercentile:(double)percentile
+                          endpoint:(HttpEndpoint)endpoint
+                             phase:(HttpTimingPhase)phase;
+
+/// Return p50, p90 and p99 of all phases for all endpoints as JSON in milliseconds.
+- (NSData *)timingReportJSON;
+
 /// Send authentication request and return result in handler.
 /// @param otp Calculated OTP.
 /// @param handler Completion handler triggered once opeation is finished.
@@ -42,4 +144,10 @@ typedef void (^HttpManagerCompletion)(BOOL success, NSString *message);
                  amount:(NSString *)amount
             beneficiary:(NSString *)beneficiary
       completionHandler:(HttpManagerCompletion)handler;
+
+/// Send multiple transaction sign requests in one round trip.
+/// @param items Transactions to sign.
+/// @param handler Completion handler with one result per item in the same order as items.
+- (void)sendSignRequests:(NSArray<HttpSignItem *> *)items
+       completionHandler:(HttpManagerBatchCompletion)handler;
 @end
@@ -24,12 +24,99 @@
 //            Please make sure to review our IdCloud documentation, including security guidelines.
 
 #import "./HttpManager.h"
+#import "HttpJson.h"
+#import <stdatomic.h>
 
 typedef void (^HTTPResponse)(NSData * _Nullable data, NSURLResponse * _Nullable response, NSError * _Nullable error);
 
+// Retry configuration.
+#define kRetryBaseDelay     0.2
+#define kRetryMaxDelay      2.0
+#define kRetryMaxExponent   16
+
+// Timing ring buffer configuration.
+#define kTimingCapacity     256
+#define kTimingPhaseCount   (HttpTimingPhaseTotal + 1)
+#define kTimingEndpoints    (HttpEndpointSignOtpBatch + 1)
+
 #define kAuthSuccess @"0"
 #define kSignSuccess @"Signature verification succeeded"
 
+// MARK: - Request body
+
+// Request bodies have fixed shape. Instead of building dictionary and serializing it, we keep
+// literal parts of JSON pre-encoded in HttpJson and write escaped values between them directly into one buffer.
+#define HTTP_TEMPLATE_COUNT(__TPL__)    (sizeof(__TPL__) / sizeof(HttpJsonLiteral))
+
+// Rough size of one escaped value. Buffer will grow in case of longer values.
+#define kBodyValueCapacity 64
+
+static NSMutableData *HttpBodyCreate(const HttpJsonLiteral *template, NSUInteger count, NSUInteger repeat) {
+    NSUInteger capacity = 0;
+    for (NSUInteger index = 0; index < count; index++) {
+        capacity += template[index].length + kBodyValueCapacity;
+    }
+    
+    return [NSMutableData dataWithCapacity:capacity * MAX(repeat, 1)];
+}
+
+static void HttpBodyAppendLiteral(NSMutableData *body, HttpJsonLiteral literal) {
+    [body appendBytes:literal.bytes length:literal.length];
+}
+
+static void HttpBodyAppendString(NSMutableData *body, NSString *value) {
+    const char *utf8 = value.UTF8String;
+    if (!utf8) {
+        return;
+    }
+    
+    // Escaped value is written right behind current end of the body.
+    NSUInteger offset = body.length;
+    [body increaseLengthBy:HttpJsonEscape(utf8, NULL)];
+    HttpJsonEscape(utf8, (char *)body.mutableBytes + offset);
+}
+
+// MARK: - Response scanner
+
+static NSString *HttpJsonReadString(HttpJsonScanner scanner, const char *key) {
+    const char  *literal    = NULL;
+    size_t      length      = 0;
+    if (!HttpJsonFindString(scanner, key, &literal, &length)) {
+        return nil;
+    }
+    
+    // Most values are plain. Only escaped ones need full JSON decoding.
+    if (!memchr(literal, '\\', length)) {
+        return [[NSString alloc] initWithBytes:literal + 1 length:length - 2 encoding:NSUTF8StringEncoding];
+    }
+    
+    NSData *fragment = [NSData dataWithBytesNoCopy:(void *)literal length:length freeWhenDone:NO];
+    return [NSJSONSerialization JSONObjectWithData:fragment options:NSJSONReadingFragmentsAllowed error:nil];
+}
+
+static HttpJsonScanner HttpJsonScannerWithData(NSData *data) {
+    return HttpJsonScannerMake(data.bytes, data.length);
+}
+
+static int HttpCompareLatency(const void *first, const void *second) {
+    NSTimeInterval difference = *(const NSTimeInterval *)first - *(const NSTimeInterval *)second;
+    return difference < 0 ? -1 : difference > 0;
+}
+
+static NSTimeInterval HttpInterval(NSDate *start, NSDate *end) {
+    return start && end ? [end timeIntervalSinceDate:start] : 0;
+}
+
+static NSTimeInterval HttpPercentile(const NSTimeInterval *sorted, NSUInteger count, double percentile) {
+    if (!count) {
+        return 0;
+    }
+    
+    // Nearest rank method.
+    NSUInteger rank = (NSUInteger)ceil(percentile / 100. * count);
+    return sorted[MIN(MAX(rank, 1), count) - 1];
+}
+
 #define kXMLTemplateSign @"<?xml version=\"1.0\" encoding=\"UTF-8\"?> \
 <SignatureRequest> \
 <Transaction> \
@@ -40,28 +127,187 @@ typedef void (^HTTPResponse)(NSData * _Nullable data, NSURLResponse * _Nullable
 <OTP>%@</OTP> \
 </SignatureRequest>"
 
-@implementation HttpManager
+@implementation HttpSignItem
+
++ (instancetype)itemWithOtp:(NSString *)otp amount:(NSString *)amount beneficiary:(NSString *)beneficiary {
+    return [[HttpSignItem alloc] initWithOtp:otp amount:amount beneficiary:beneficiary];
+}
+
+- (id)initWithOtp:(NSString *)otp amount:(NSString *)amount beneficiary:(NSString *)beneficiary {
+    if (self = [super init]) {
+        _otp            = [otp copy];
+        _amount         = [amount copy];
+        _beneficiary    = [beneficiary copy];
+    }
+    
+    return self;
+}
+
+@end
+
+@implementation HttpResult
+
++ (instancetype)resultWithSuccess:(BOOL)success message:(NSString *)message {
+    return [[HttpResult alloc] initWithSuccess:success message:message];
+}
+
+- (id)initWithSuccess:(BOOL)success message:(NSString *)message {
+    if (self = [super init]) {
+        _success    = success;
+        _message    = [message copy];
+    }
+    
+    return self;
+}
+
+@end
+
+// MARK: - Timing
+
+// One slot of timing ring buffer guarded by sequence lock. Sequence is odd while slot is being written.
+// Reader copies the slot and accepts it only if sequence was even and did not change meanwhile.
+// Content is accessed with relaxed atomics, so concurrent read and write is not a data race.
+typedef struct {
+    _Atomic(uint64_t)           sequence;
+    _Atomic(NSInteger)          endpoint;
+    _Atomic(NSTimeInterval)     phases[kTimingPhaseCount];
+} HttpTimingSlot;
+
+/// Timing of single logical request collected from different places before it's stored.
+/// Task metrics and completion handler arrive in any order. Sample is stored by whichever comes last.
+/// Must be accessed from block synchronized on the instance.
+@interface HttpRequestTiming : NSObject
+
+@property (nonatomic, assign, readonly) HttpEndpoint    endpoint;
+@property (nonatomic, assign, readonly) NSTimeInterval  *phases;
+@property (nonatomic, assign)           NSUInteger      tasksStarted;
+@property (nonatomic, assign)           NSUInteger      tasksPending;
+@property (nonatomic, assign)           BOOL            finished;
+
+@end
+
+@implementation HttpRequestTiming {
+    NSTimeInterval _storage[kTimingPhaseCount];
+}
+
++ (instancetype)timingWithEndpoint:(HttpEndpoint)endpoint {
+    return [[HttpRequestTiming alloc] initWithEndpoint:endpoint];
+}
+
+- (id)initWithEndpoint:(HttpEndpoint)endpoint {
+    if (self = [super init]) {
+        _endpoint   = endpoint;
+        _phases     = _storage;
+    }
+    
+    return self;
+}
+
+@end
+
+/// Session keeps strong reference to delegate until it's invalidated. Use proxy to not keep manager alive.
+@interface HttpSessionDelegate : NSObject <NSURLSessionTaskDelegate>
+
+@property (nonatomic, weak) HttpManager *manager;
+
+@end
+
+@interface HttpManager()
+
+@property (nonatomic, strong) NSURLSession                                    *session;
+@property (nonatomic, copy)   NSURLSessionConfiguration                       *configuration;
+@property (nonatomic, strong) NSMutableDictionary<NSArray *, NSMutableArray *>  *inFlight;
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, HttpRequestTiming *> *pendingTimings;
+
+- (void)collectMetrics:(NSURLSessionTaskMetrics *)metrics forTask:(NSURLSessionTask *)task;
+
+@end
+
+@implementation HttpSessionDelegate
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics *)metrics {
+    [_manager collectMetrics:metrics forTask:task];
+}
+
+@end
+
+@implementation HttpManager {
+    HttpTimingSlot      *_timingSlots;
+    _Atomic(uint64_t)   _timingTicket;
+}
+
+// MARK: - Life Cycle
+
+- (instancetype)init {
+    return [self initWithURL:CFG_TUTO_URL_ROOT()
+                     headers:@{
+                         @"Authorization" : CFG_TUTO_BASIC_AUTH_JWT(),
+                         @"X-API-KEY" : CFG_TUTO_BASIC_AUTH_API_KEY()
+                     }];
+}
+
+- (instancetype)initWithURL:(NSString *)url headers:(NSDictionary<NSString *, NSString *> *)headers {
+    return [self initWithURL:url headers:headers configuration:nil];
+}
+
+- (instancetype)initWithURL:(NSString *)url
+                    headers:(NSDictionary<NSString *, NSString *> *)headers
+              configuration:(NSURLSessionConfiguration *)configuration {
+    if (self = [super init]) {
+        _url                = [url copy];
+        _headers            = [headers copy];
+        self.configuration  = configuration;
+        self.inFlight       = [NSMutableDictionary new];
+        self.pendingTimings = [NSMutableDictionary new];
+        _timingSlots        = calloc(kTimingCapacity, sizeof(HttpTimingSlot));
+        self.maxRetryCount  = 2;
+        
+        // Idle connections are useless once app is suspended. Drop them so the next request starts clean.
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(invalidateSession)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
+        
+        // Cookies and cached credentials of removed user must not be reused by the next one.
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(invalidateSession)
+                                                     name:C_NOTIFICATION_ID_TOKEN_REMOVED
+                                                   object:nil];
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [_session finishTasksAndInvalidate];
+    free(_timingSlots);
+}
 
 // MARK: - Public API
 
+- (void)invalidateSession {
+    @synchronized (self) {
+        // Let running requests finish, but do not keep any connection for future ones.
+        [_session finishTasksAndInvalidate];
+        _session = nil;
+    }
+}
+
 - (void)sendAuthRequest:(NSString *)otp completionHandler:(HttpManagerCompletion)handler {
-    // Demo app use user name for token name since it's unique.
-    TokenDevice *device = CMain.sharedInstance.managerToken.tokenDevice;
-    NSDictionary    *input = @{
-        @"userId": device.token.name,
-        @"otp":otp
-    };
-    NSDictionary    *body = @{
-        @"name": @"Auth_OTP",
-        @"input":input
-    };
+    HttpRequestTiming   *timing = [HttpRequestTiming timingWithEndpoint:HttpEndpointAuthOtp];
+    CFAbsoluteTime      start   = CFAbsoluteTimeGetCurrent();
+    NSData              *body   = [self authBodyWithOtp:otp];
+    timing.phases[HttpTimingPhaseEncode] = CFAbsoluteTimeGetCurrent() - start;
+    
     // Post message and wait for results in proccessResponse.
-    [self doPostMessage:CFG_TUTO_URL_ROOT()
+    [self doPostMessage:_url
             contentType:@"application/json"
-                headers:[self authHeaders]
+                headers:_headers
                    body:body
+                 timing:timing
        returnInUIThread:YES
-      completionHandler:[self processResponse:handler]];
+      completionHandler:[self processResponse:handler timing:timing]];
     
 }
 
@@ -69,76 +315,155 @@ typedef void (^HTTPResponse)(NSData * _Nullable data, NSURLResponse * _Nullable
                  amount:(NSString *)amount
             beneficiary:(NSString *)beneficiary
       completionHandler:(HttpManagerCompletion)handler {
-    // Demo app use user name for token name since it's unique.
-    TokenDevice *device = CMain.sharedInstance.managerToken.tokenDevice;
-    NSDictionary *transactionDict = @{
-        @"amount": amount,
-        @"beneficiary": beneficiary
-    };
-    NSDictionary    *input = @{
-        @"userId": device.token.name,
-        @"otp":otp,
-        @"transactionData":transactionDict
-    };
-    NSDictionary    *body = @{
-        @"name": @"Sign_OTP",
-        @"input":input
-    };
+    HttpRequestTiming   *timing = [HttpRequestTiming timingWithEndpoint:HttpEndpointSignOtp];
+    CFAbsoluteTime      start   = CFAbsoluteTimeGetCurrent();
+    NSData              *body   = [self signBodyWithOtp:otp amount:amount beneficiary:beneficiary];
+    timing.phases[HttpTimingPhaseEncode] = CFAbsoluteTimeGetCurrent() - start;
+    
     // Post message and wait for results in proccessResponse.
-    [self doPostMessage:CFG_TUTO_URL_ROOT()
+    [self doPostMessage:_url
+            contentType:@"application/json"
+                headers:_headers
+                   body:body
+                 timing:timing
+       returnInUIThread:YES
+      completionHandler:[self processResponse:handler timing:timing]];
+}
+
+- (void)sendSignRequests:(NSArray<HttpSignItem *> *)items
+       completionHandler:(HttpManagerBatchCompletion)handler {
+    HttpRequestTiming   *timing = [HttpRequestTiming timingWithEndpoint:HttpEndpointSignOtpBatch];
+    CFAbsoluteTime      start   = CFAbsoluteTimeGetCurrent();
+    NSMutableData       *body   = HttpBodyCreate(kHttpJsonSignOtpBatch, HTTP_TEMPLATE_COUNT(kHttpJsonSignOtpBatch), items.count);
+    HttpBodyAppendLiteral(body, kHttpJsonSignOtpBatch[0]);
+    HttpBodyAppendString(body, [self currentUserId]);
+    HttpBodyAppendLiteral(body, kHttpJsonSignOtpBatch[1]);
+    for (NSUInteger index = 0; index < items.count; index++) {
+        HttpSignItem *loopItem = items[index];
+        HttpBodyAppendLiteral(body, index ? kHttpJsonSignOtpBatch[3] : kHttpJsonSignOtpBatch[2]);
+        HttpBodyAppendString(body, loopItem.otp);
+        HttpBodyAppendLiteral(body, kHttpJsonSignOtpBatch[4]);
+        HttpBodyAppendString(body, loopItem.amount);
+        HttpBodyAppendLiteral(body, kHttpJsonSignOtpBatch[5]);
+        HttpBodyAppendString(body, loopItem.beneficiary);
+        HttpBodyAppendLiteral(body, kHttpJsonSignOtpBatch[6]);
+    }
+    HttpBodyAppendLiteral(body, kHttpJsonSignOtpBatch[7]);
+    timing.phases[HttpTimingPhaseEncode] = CFAbsoluteTimeGetCurrent() - start;
+    
+    // Post message and wait for results in proccessBatchResponse.
+    [self doPostMessage:_url
             contentType:@"application/json"
-                headers:[self authHeaders]
+                headers:_headers
                    body:body
+                 timing:timing
        returnInUIThread:YES
-      completionHandler:[self processResponse:handler]];
+      completionHandler:[self processBatchResponse:handler count:items.count timing:timing]];
 }
 
 // MARK: Private Helpers
 
-- (HTTPResponse)processResponse:(HttpManagerCompletion)handler {
+- (HTTPResponse)processResponse:(HttpManagerCompletion)handler timing:(HttpRequestTiming *)timing {
     return ^void(NSData * _Nullable data, NSURLResponse * _Nullable response, NSError * _Nullable error) {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
         if ([response isKindOfClass:[NSHTTPURLResponse class]] && ((NSHTTPURLResponse *)response).statusCode == 201 && data) {
-            NSDictionary *dict =
-            [NSJSONSerialization JSONObjectWithData:data
-                                            options:0
-                                              error:nil];
-            NSString *value = (NSString*)[dict valueForKeyPath:@"state.result.code"];
-            NSString *message = (NSString*)[dict valueForKeyPath:@"state.result.message"];
+            HttpJsonScanner scanner = HttpJsonScannerWithData(data);
+            NSString        *value      = nil;
+            NSString        *message    = nil;
+            if (HttpJsonFindPath(&scanner, kHttpJsonResultPath, 2)) {
+                value   = HttpJsonReadString(scanner, "code");
+                message = HttpJsonReadString(scanner, "message");
+            }
             BOOL        success         = [value isEqual:kAuthSuccess];
+            [self recordTiming:timing decode:CFAbsoluteTimeGetCurrent() - start];
             handler(success, message);
         } else {
+            [self recordTiming:timing decode:CFAbsoluteTimeGetCurrent() - start];
             handler(NO, error.localizedDescription);
         }
     };
 }
 
-- (NSDictionary *)authHeaders {
-    NSDictionary    *headers    = @{
-        @"Authorization" : CFG_TUTO_BASIC_AUTH_JWT(),
-        @"X-API-KEY" : CFG_TUTO_BASIC_AUTH_API_KEY()
+- (HTTPResponse)processBatchResponse:(HttpManagerBatchCompletion)handler
+                               count:(NSUInteger)count
+                              timing:(HttpRequestTiming *)timing {
+    return ^void(NSData * _Nullable data, NSURLResponse * _Nullable response, NSError * _Nullable error) {
+        CFAbsoluteTime                  start       = CFAbsoluteTimeGetCurrent();
+        NSMutableArray<HttpResult *>    *results    = [NSMutableArray arrayWithCapacity:count];
+        NSString                        *failure    = error.localizedDescription;
+        
+        if ([response isKindOfClass:[NSHTTPURLResponse class]] && ((NSHTTPURLResponse *)response).statusCode == 201 && data) {
+            HttpJsonScanner scanner = HttpJsonScannerWithData(data);
+            if (HttpJsonFindPath(&scanner, kHttpJsonResultPath, 2)) {
+                failure = HttpJsonReadString(scanner, "message");
+                
+                // Walk items array and read verdict of each element.
+                if (count && HttpJsonFindKey(&scanner, "items") && HttpJsonExpect(&scanner, '[')) {
+                    do {
+                        NSString *value = HttpJsonReadString(scanner, "code");
+                        [results addObject:[HttpResult resultWithSuccess:[value isEqual:kSignSuccess]
+                                                                 message:HttpJsonReadString(scanner, "message")]];
+                    } while (HttpJsonSkipValue(&scanner) && HttpJsonExpect(&scanner, ','));
+                    
+                    if (!HttpJsonExpect(&scanner, ']')) {
+                        [results removeAllObjects];
+                    }
+                }
+            }
+        }
+        
+        // Server must return verdict for each item. Otherwise whole batch is considered as failed.
+        if (results.count != count) {
+            [results removeAllObjects];
+            for (NSUInteger index = 0; index < count; index++) {
+                [results addObject:[HttpResult resultWithSuccess:NO message:failure]];
+            }
+        }
+        
+        [self recordTiming:timing decode:CFAbsoluteTimeGetCurrent() - start];
+        handler(results);
     };
-    return headers;
+}
+
+- (NSData *)authBodyWithOtp:(NSString *)otp {
+    NSMutableData *retValue = HttpBodyCreate(kHttpJsonAuthOtp, HTTP_TEMPLATE_COUNT(kHttpJsonAuthOtp), 0);
+    HttpBodyAppendLiteral(retValue, kHttpJsonAuthOtp[0]);
+    HttpBodyAppendString(retValue, [self currentUserId]);
+    HttpBodyAppendLiteral(retValue, kHttpJsonAuthOtp[1]);
+    HttpBodyAppendString(retValue, otp);
+    HttpBodyAppendLiteral(retValue, kHttpJsonAuthOtp[2]);
+    
+    return retValue;
+}
+
+- (NSData *)signBodyWithOtp:(NSString *)otp amount:(NSString *)amount beneficiary:(NSString *)beneficiary {
+    NSMutableData *retValue = HttpBodyCreate(kHttpJsonSignOtp, HTTP_TEMPLATE_COUNT(kHttpJsonSignOtp), 0);
+    HttpBodyAppendLiteral(retValue, kHttpJsonSignOtp[0]);
+    HttpBodyAppendString(retValue, [self currentUserId]);
+    HttpBodyAppendLiteral(retValue, kHttpJsonSignOtp[1]);
+    HttpBodyAppendString(retValue, otp);
+    HttpBodyAppendLiteral(retValue, kHttpJsonSignOtp[2]);
+    HttpBodyAppendString(retValue, amount);
+    HttpBodyAppendLiteral(retValue, kHttpJsonSignOtp[3]);
+    HttpBodyAppendString(retValue, beneficiary);
+    HttpBodyAppendLiteral(retValue, kHttpJsonSignOtp[4]);
+    
+    return retValue;
+}
+
+- (NSString *)currentUserId {
+    // Demo app use user name for token name since it's unique.
+    return _userId ?: CMain.sharedInstance.managerToken.tokenDevice.token.name;
 }
 
 - (void)doPostMessage:(NSString *)url
           contentType:(NSString *)contentType
               headers:(NSDictionary<NSString *, NSString *> *)headers
-                 body:(NSDictionary *)body
+                 body:(NSData *)postData
+               timing:(HttpRequestTiming *)timing
      returnInUIThread:(BOOL)returnInUIThread
     completionHandler:(HTTPResponse)completionHandler {
     // Prepare HTTP post request.
-    
-    NSData *data = [NSJSONSerialization dataWithJSONObject:body
-                                                   options:0
-                                                     error:nil];
-    NSString *dataString = [[NSString alloc] initWithData:data
-                                                 encoding:NSUTF8StringEncoding];
-    dataString =  [dataString stringByTrimmingCharactersInSet:
-                   [NSCharacterSet whitespaceAndNewlineCharacterSet]];
-    dataString =   [dataString stringByTrimmingCharactersInSet:
-                    [NSCharacterSet newlineCharacterSet]];
-    NSData *postData = [dataString dataUsingEncoding:NSUTF8StringEncoding];
-    
     NSMutableURLRequest     *request    = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:url]];
     [request setHTTPMethod:@"POST"];
     [request setValue:[NSString stringWithFormat:@"%lu", (unsigned long)[postData length]] forHTTPHeaderField:@"Content-Length"];
@@ -148,6 +473,9 @@ typedef void (^HTTPResponse)(NSData * _Nullable data, NSURLResponse * _Nullable
     }
     [request setHTTPBody:postData];
     
+    // Same key is used for all retries. Server is not required to honor it, so nothing relies on it.
+    [request setValue:[NSUUID UUID].UUIDString forHTTPHeaderField:@"Idempotency-Key"];
+    
     // Make response return in UI thread if needed.
     HTTPResponse handler = returnInUIThread && completionHandler ? ^void(NSData *data, NSURLResponse *response, NSError *error) {
         dispatch_async(dispatch_get_main_queue(), ^{
@@ -155,13 +483,246 @@ typedef void (^HTTPResponse)(NSData * _Nullable data, NSURLResponse * _Nullable
         });
     } : completionHandler;
     
-    // Prepare session with predefined short timeout.
-    NSURLSessionConfiguration *sessionConfig    = [NSURLSessionConfiguration defaultSessionConfiguration];
-    sessionConfig.timeoutIntervalForRequest     = 15.0;
-    sessionConfig.timeoutIntervalForResource    = 15.0;
+    // Identical request is already on the way. Wait for its result instead of sending duplicate.
+    // Server would reject second verification of the same OTP anyway.
+    NSArray *fingerprint = @[url, postData];
+    @synchronized (self) {
+        NSMutableArray *waiting = _inFlight[fingerprint];
+        if (waiting) {
+            if (handler) {
+                [waiting addObject:handler];
+            }
+            _coalescedRequestCount++;
+            return;
+        }
+        _inFlight[fingerprint] = handler ? [NSMutableArray arrayWithObject:handler] : [NSMutableArray new];
+        _issuedRequestCount++;
+    }
+    
+    // Post request and distribute result to everyone who joined meanwhile.
+    [self sendRequest:request attempt:0 timing:timing completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSArray<HTTPResponse> *handlers = nil;
+        @synchronized (self) {
+            handlers = self.inFlight[fingerprint];
+            [self.inFlight removeObjectForKey:fingerprint];
+        }
+        for (HTTPResponse loopHandler in handlers) {
+            loopHandler(data, response, error);
+        }
+    }];
+}
+
+- (void)sendRequest:(NSURLRequest *)request
+            attempt:(NSUInteger)attempt
+             timing:(HttpRequestTiming *)timing
+  completionHandler:(HTTPResponse)completionHandler {
+    HTTPResponse handler = ^void(NSData *data, NSURLResponse *response, NSError *error) {
+        if (attempt < self.maxRetryCount && [self isRetryable:response error:error]) {
+            // Full jitter exponential backoff. Spread retries so clients does not come back all at once.
+            NSTimeInterval delay = [HttpManager retryDelayCapForAttempt:attempt] * arc4random_uniform(1000) / 1000.;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                [self sendRequest:request attempt:attempt + 1 timing:timing completionHandler:completionHandler];
+            });
+        } else {
+            completionHandler(data, response, error);
+        }
+    };
+    
+    [[self dataTaskWithRequest:request timing:timing completionHandler:handler] resume];
+}
+
++ (NSTimeInterval)retryDelayCapForAttempt:(NSUInteger)attempt {
+    // Exponent is clamped for very high attempts. Delay reaches its maximum long before that anyway.
+    return MIN(kRetryMaxDelay, ldexp(kRetryBaseDelay, (int)MIN(attempt, kRetryMaxExponent)));
+}
+
+- (NSURLSessionTask *)dataTaskWithRequest:(NSURLRequest *)request
+                                   timing:(HttpRequestTiming *)timing
+                        completionHandler:(HTTPResponse)completionHandler {
+    NSURLSessionTask *retValue = [[self sharedSession] dataTaskWithRequest:request completionHandler:completionHandler];
+    
+    // Network phases will be filled once session finish collecting task metrics.
+    if (timing) {
+        @synchronized (self) {
+            _pendingTimings[@(retValue.taskIdentifier)] = timing;
+        }
+        @synchronized (timing) {
+            timing.tasksStarted++;
+            timing.tasksPending++;
+        }
+    }
+    
+    return retValue;
+}
+
+- (BOOL)isRetryable:(NSURLResponse *)response error:(NSError *)error {
+    // All requests carry one time OTP. Once request might have reached server, OTP might be already used
+    // and second verification would fail. Retry only failures where request provably never left the device.
+    if ([error.domain isEqualToString:NSURLErrorDomain]) {
+        switch (error.code) {
+            case NSURLErrorCannotConnectToHost:
+            case NSURLErrorDNSLookupFailed:
+            case NSURLErrorCannotFindHost:
+                return YES;
+            default:
+                return NO;
+        }
+    }
+    
+    return NO;
+}
+
+- (NSURLSession *)sharedSession {
+    @synchronized (self) {
+        if (!_session) {
+            // Prepare session with predefined short timeout.
+            // One session per manager keep TCP / TLS connection alive between requests.
+            // HTTP/2 is negotiated automatically by NSURLSession and all requests are multiplexed over it.
+            // Ephemeral session keeps cookies, credentials and cache only in memory, so they are gone with invalidation.
+            NSURLSessionConfiguration *sessionConfig    = [_configuration copy] ?: [NSURLSessionConfiguration ephemeralSessionConfiguration];
+            sessionConfig.timeoutIntervalForRequest     = 15.0;
+            sessionConfig.timeoutIntervalForResource    = 15.0;
+            
+            HttpSessionDelegate *delegate = [HttpSessionDelegate new];
+            delegate.manager = self;
+            _session = [NSURLSession sessionWithConfiguration:sessionConfig delegate:delegate delegateQueue:nil];
+        }
+        
+        return _session;
+    }
+}
+
+// MARK: - Timing
+
+- (void)collectMetrics:(NSURLSessionTaskMetrics *)metrics forTask:(NSURLSessionTask *)task {
+    HttpRequestTiming *timing = nil;
+    @synchronized (self) {
+        timing = _pendingTimings[@(task.taskIdentifier)];
+        [_pendingTimings removeObjectForKey:@(task.taskIdentifier)];
+    }
+    if (!timing) {
+        return;
+    }
+    
+    // Last transaction is the one which delivered response. Previous ones are redirects.
+    // Cancelled task did not deliver anything. All other attempts add up, including failed ones.
+    NSURLSessionTaskTransactionMetrics  *transaction    = metrics.transactionMetrics.lastObject;
+    BOOL                                ready           = NO;
+    @synchronized (timing) {
+        if (task.error.code != NSURLErrorCancelled) {
+            NSTimeInterval *phases  = timing.phases;
+            NSTimeInterval tls      = HttpInterval(transaction.secureConnectionStartDate, transaction.secureConnectionEndDate);
+            phases[HttpTimingPhaseDns]      += HttpInterval(transaction.domainLookupStartDate, transaction.domainLookupEndDate);
+            phases[HttpTimingPhaseConnect]  += MAX(0, HttpInterval(transaction.connectStartDate, transaction.connectEndDate) - tls);
+            phases[HttpTimingPhaseTls]      += tls;
+            phases[HttpTimingPhaseServer]   += HttpInterval(transaction.requestStartDate, transaction.responseStartDate);
+            phases[HttpTimingPhaseTransfer] += HttpInterval(transaction.responseStartDate, transaction.responseEndDate);
+            phases[HttpTimingPhaseTotal]    += metrics.taskInterval.duration;
+        }
+        timing.tasksPending--;
+        ready = timing.finished && !timing.tasksPending;
+    }
+    
+    if (ready) {
+        [self storeTiming:timing];
+    }
+}
+
+- (void)recordTiming:(HttpRequestTiming *)timing decode:(NSTimeInterval)decode {
+    BOOL ready = NO;
+    @synchronized (timing) {
+        timing.phases[HttpTimingPhaseDecode]    = decode;
+        timing.finished                         = YES;
+        
+        // Requests joined to another one in flight did not touch network. Do not count them.
+        ready = timing.tasksStarted && !timing.tasksPending;
+    }
+    
+    if (ready) {
+        [self storeTiming:timing];
+    }
+}
+
+- (void)storeTiming:(HttpRequestTiming *)timing {
+    // Called once all parts are collected, so timing is no longer changing.
+    NSTimeInterval *phases = timing.phases;
+    phases[HttpTimingPhaseTotal] += phases[HttpTimingPhaseEncode] + phases[HttpTimingPhaseDecode];
+    
+    // Writers only reserve unique ticket. There is no lock even when more requests finish at the same time.
+    uint64_t        ticket  = atomic_fetch_add(&_timingTicket, 1);
+    HttpTimingSlot  *slot   = &_timingSlots[ticket % kTimingCapacity];
+    atomic_store_explicit(&slot->sequence, ticket * 2 + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->endpoint, timing.endpoint, memory_order_relaxed);
+    for (NSUInteger index = 0; index < kTimingPhaseCount; index++) {
+        atomic_store_explicit(&slot->phases[index], phases[index], memory_order_relaxed);
+    }
+    atomic_store_explicit(&slot->sequence, ticket * 2 + 2, memory_order_release);
+}
+
+- (NSTimeInterval)timingPercentile:(double)percentile
+                          endpoint:(HttpEndpoint)endpoint
+                             phase:(HttpTimingPhase)phase {
+    NSTimeInterval  samples[kTimingCapacity];
+    NSUInteger      count = [self timingSamples:samples endpoint:endpoint phase:phase];
+    
+    return HttpPercentile(samples, count, percentile);
+}
+
+- (NSData *)timingReportJSON {
+    static NSString * const endpoints[]  = { @"Auth_OTP", @"Sign_OTP", @"Sign_OTP_Batch" };
+    static NSString * const phases[]     = { @"encode", @"dns", @"connect", @"tls", @"server", @"transfer", @"decode", @"total" };
+    NSMutableDictionary *report = [NSMutableDictionary new];
+    
+    for (HttpEndpoint loopEndpoint = 0; loopEndpoint < kTimingEndpoints; loopEndpoint++) {
+        NSMutableDictionary *endpointReport = [NSMutableDictionary new];
+        for (HttpTimingPhase loopPhase = 0; loopPhase < kTimingPhaseCount; loopPhase++) {
+            NSTimeInterval  samples[kTimingCapacity];
+            NSUInteger      count = [self timingSamples:samples endpoint:loopEndpoint phase:loopPhase];
+            if (!count) {
+                break;
+            }
+            endpointReport[@"count"] = @(count);
+            endpointReport[phases[loopPhase]] = @{
+                @"p50": @(HttpPercentile(samples, count, 50) * 1000.),
+                @"p90": @(HttpPercentile(samples, count, 90) * 1000.),
+                @"p99": @(HttpPercentile(samples, count, 99) * 1000.)
+            };
+        }
+        report[endpoints[loopEndpoint]] = endpointReport;
+    }
+    
+    return [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:nil];
+}
+
+- (NSUInteger)timingSamples:(NSTimeInterval *)samples endpoint:(HttpEndpoint)endpoint phase:(HttpTimingPhase)phase {
+    NSUInteger count = 0;
+    
+    for (NSUInteger index = 0; index < kTimingCapacity; index++) {
+        HttpTimingSlot  *slot   = &_timingSlots[index];
+        uint64_t        before  = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        
+        // Skip empty slots and slots being just written.
+        if (!before || before % 2) {
+            continue;
+        }
+        
+        NSInteger       slotEndpoint    = atomic_load_explicit(&slot->endpoint, memory_order_relaxed);
+        NSTimeInterval  value           = atomic_load_explicit(&slot->phases[phase], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        
+        // Slot was rewritten while we were reading it.
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != before) {
+            continue;
+        }
+        if (slotEndpoint == endpoint) {
+            samples[count++] = value;
+        }
+    }
     
-    // Post request.
-    [[[NSURLSession sessionWithConfiguration:sessionConfig] dataTaskWithRequest:request completionHandler:handler] resume];
+    // Sorted samples for percentile calculation.
+    qsort(samples, count, sizeof(NSTimeInterval), HttpCompareLatency);
+    return count;
 }
 
 @end
@@ -0,0 +1,95 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+/**
+ Durable queue of incoming message ids waiting to be fetched.
+ Oldest ids are dropped once capacity is reached, duplicates are ignored and ids expire after given time.
+ */
+@interface MessageInbox : NSObject
+
+/**
+ Number of pending, not expired message ids.
+ */
+@property (atomic, assign, readonly) NSUInteger count;
+
+/**
+ Create inbox on top of given storage. Existing content is loaded right away.
+
+ @param storage Storage used to persist the queue.
+ @param capacity Maximum number of pending ids.
+ @param timeToLive Time after which pending id is dropped.
+ @return New instance
+ */
+- (instancetype)initWithStorage:(id<StorageProtocol>)storage
+                       capacity:(NSUInteger)capacity
+                     timeToLive:(NSTimeInterval)timeToLive;
+
+/**
+ Add message id to the end of the queue.
+
+ @param messageId Incoming message id.
+ @param clientId Client id message belongs to. Optional.
+ @return YES if id was stored, NO if it's already queued or storing failed.
+ */
+- (BOOL)pushMessageId:(NSString *)messageId clientId:(NSString *)clientId;
+
+/**
+ Add multiple message ids to the end of the queue with single storage write.
+
+ @param messageIds Incoming message ids, oldest first.
+ @param clientIds Client ids messages belong to. Same count as message ids, empty string for none.
+ @return Message ids which were stored. Already queued ones are skipped.
+ */
+- (NSArray<NSString *> *)pushMessageIds:(NSArray<NSString *> *)messageIds clientIds:(NSArray<NSString *> *)clientIds;
+
+/**
+ Get oldest pending message id without removing it.
+
+ @param clientId Client id message belongs to. Optional.
+ @return Message id or nil if queue is empty.
+ */
+- (NSString *)peekMessageId:(NSString **)clientId;
+
+/**
+ Remove given message id from the queue. Usually once it was fetched.
+
+ @param messageId Message id to remove.
+ @return YES if id was removed.
+ */
+- (BOOL)removeMessageId:(NSString *)messageId;
+
+/**
+ Remove all pending message ids of given client id. Usually once client was unregistered.
+
+ @param clientId Client id of messages to remove.
+ */
+- (void)removeClientId:(NSString *)clientId;
+
+/**
+ Remove all pending message ids.
+ */
+- (void)removeAll;
+
+@end
@@ -0,0 +1,292 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import "MessageInbox.h"
+
+// Queue is stored as numbered slots between head and tail. Each change touches only few keys.
+#define kInboxKeyHead   @"Inbox.Head"
+#define kInboxKeyTail   @"Inbox.Tail"
+#define kInboxKeySlot   @"Inbox.%lld"
+
+@interface MessageInboxEntry : NSObject
+
+@property (nonatomic, copy)   NSString          *messageId;
+@property (nonatomic, copy)   NSString          *clientId;
+@property (nonatomic, assign) NSTimeInterval    expiry;
+@property (nonatomic, assign) int64_t           slot;
+
+@end
+
+@implementation MessageInboxEntry
+
+@end
+
+@interface MessageInbox()
+
+@property (nonatomic, strong) id<StorageProtocol>                   storage;
+@property (nonatomic, assign) NSUInteger                            capacity;
+@property (nonatomic, assign) NSTimeInterval                        timeToLive;
+@property (nonatomic, strong) NSMutableArray<MessageInboxEntry *>   *entries;
+@property (nonatomic, strong) NSMutableSet<NSString *>              *messageIds;
+@property (nonatomic, assign) int64_t                               tail;
+
+@end
+
+@implementation MessageInbox
+
+// MARK: - Life Cycle
+
+- (instancetype)initWithStorage:(id<StorageProtocol>)storage
+                       capacity:(NSUInteger)capacity
+                     timeToLive:(NSTimeInterval)timeToLive {
+    if (self = [super init]) {
+        self.storage    = storage;
+        self.capacity   = MAX(capacity, 1);
+        self.timeToLive = timeToLive;
+        self.entries    = [NSMutableArray new];
+        self.messageIds = [NSMutableSet new];
+        
+        [self load];
+    }
+    
+    return self;
+}
+
+// MARK: - Public API
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        [self removeExpired];
+        return _entries.count;
+    }
+}
+
+- (BOOL)pushMessageId:(NSString *)messageId clientId:(NSString *)clientId {
+    if (!messageId) {
+        return NO;
+    }
+    
+    return [self pushMessageIds:@[messageId] clientIds:@[clientId ?: @""]].count > 0;
+}
+
+- (NSArray<NSString *> *)pushMessageIds:(NSArray<NSString *> *)messageIds clientIds:(NSArray<NSString *> *)clientIds {
+    @synchronized (self) {
+        NSMutableArray  *removeKeys = [self removeExpired];
+        NSMutableArray  *added      = [NSMutableArray new];
+        NSMutableSet    *addedIds   = [NSMutableSet new];
+        NSTimeInterval  expiry      = [NSDate date].timeIntervalSince1970 + _timeToLive;
+        
+        for (NSUInteger index = 0; index < messageIds.count; index++) {
+            // Same push might be delivered multiple times.
+            NSString *messageId = messageIds[index];
+            if ([_messageIds containsObject:messageId] || [addedIds containsObject:messageId]) {
+                continue;
+            }
+            
+            MessageInboxEntry *entry = [MessageInboxEntry new];
+            entry.messageId = messageId;
+            entry.clientId  = clientIds[index].length ? clientIds[index] : nil;
+            entry.expiry    = expiry;
+            entry.slot      = _tail + added.count;
+            [added addObject:entry];
+            [addedIds addObject:messageId];
+        }
+        
+        // Nothing new. Just get rid of expired ones.
+        if (!added.count) {
+            [self commitValues:nil removeKeys:removeKeys];
+            return @[];
+        }
+        
+        // Make room for new ones. Oldest messages are least likely to be still valid.
+        int64_t tail = ((MessageInboxEntry *)added.lastObject).slot + 1;
+        if (added.count > _capacity) {
+            [added removeObjectsInRange:NSMakeRange(0, added.count - _capacity)];
+        }
+        NSUInteger total    = _entries.count + added.count;
+        NSUInteger dropped  = total > _capacity ? total - _capacity : 0;
+        for (NSUInteger index = 0; index < dropped; index++) {
+            [removeKeys addObject:[self slotKey:_entries[index].slot]];
+        }
+        
+        // Whole batch is stored at once.
+        int64_t             head    = _entries.count > dropped ? _entries[dropped].slot : ((MessageInboxEntry *)added.firstObject).slot;
+        NSMutableDictionary *values = [NSMutableDictionary dictionaryWithCapacity:added.count + 2];
+        for (MessageInboxEntry *loopEntry in added) {
+            values[[self slotKey:loopEntry.slot]] = [self slotValue:loopEntry];
+        }
+        values[kInboxKeyHead] = @(head);
+        values[kInboxKeyTail] = @(tail);
+        if (![self commitValues:values removeKeys:removeKeys]) {
+            return @[];
+        }
+        
+        NSMutableArray *retValue = [NSMutableArray arrayWithCapacity:added.count];
+        for (NSUInteger index = 0; index < dropped; index++) {
+            [_messageIds removeObject:_entries[index].messageId];
+        }
+        [_entries removeObjectsInRange:NSMakeRange(0, dropped)];
+        for (MessageInboxEntry *loopEntry in added) {
+            [_entries addObject:loopEntry];
+            [_messageIds addObject:loopEntry.messageId];
+            [retValue addObject:loopEntry.messageId];
+        }
+        _tail = tail;
+        
+        return retValue;
+    }
+}
+
+- (NSString *)peekMessageId:(NSString **)clientId {
+    @synchronized (self) {
+        NSMutableArray *removeKeys = [self removeExpired];
+        [self commitValues:nil removeKeys:removeKeys];
+        if (clientId) {
+            *clientId = _entries.firstObject.clientId;
+        }
+        return _entries.firstObject.messageId;
+    }
+}
+
+- (BOOL)removeMessageId:(NSString *)messageId {
+    @synchronized (self) {
+        NSMutableArray *removeKeys = [self removeExpired];
+        
+        NSUInteger index = [_entries indexOfObjectPassingTest:^BOOL(MessageInboxEntry *entry, NSUInteger idx, BOOL *stop) {
+            return [entry.messageId isEqualToString:messageId];
+        }];
+        if (index == NSNotFound) {
+            [self commitValues:nil removeKeys:removeKeys];
+            return NO;
+        }
+        
+        [removeKeys addObject:[self slotKey:_entries[index].slot]];
+        [_messageIds removeObject:messageId];
+        [_entries removeObjectAtIndex:index];
+        return [self commitValues:nil removeKeys:removeKeys];
+    }
+}
+
+- (void)removeClientId:(NSString *)clientId {
+    @synchronized (self) {
+        NSMutableArray  *removeKeys = [self removeExpired];
+        NSIndexSet      *removed    = [_entries indexesOfObjectsPassingTest:^BOOL(MessageInboxEntry *entry, NSUInteger idx, BOOL *stop) {
+            return [entry.clientId isEqualToString:clientId];
+        }];
+        [removed enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+            [removeKeys addObject:[self slotKey:self.entries[idx].slot]];
+            [self.messageIds removeObject:self.entries[idx].messageId];
+        }];
+        [_entries removeObjectsAtIndexes:removed];
+        [self commitValues:nil removeKeys:removeKeys];
+    }
+}
+
+- (void)removeAll {
+    @synchronized (self) {
+        NSMutableArray *removeKeys = [NSMutableArray new];
+        for (MessageInboxEntry *loopEntry in _entries) {
+            [removeKeys addObject:[self slotKey:loopEntry.slot]];
+        }
+        [_entries removeAllObjects];
+        [_messageIds removeAllObjects];
+        [self commitValues:nil removeKeys:removeKeys];
+    }
+}
+
+// MARK: - Private Helpers
+
+- (void)load {
+    int64_t head    = [_storage readInt64ForKey:kInboxKeyHead];
+    int64_t tail    = [_storage readInt64ForKey:kInboxKeyTail];
+    
+    // Removed slots are simply missing. Only range between head and tail is relevant.
+    for (int64_t slot = head; slot < tail; slot++) {
+        MessageInboxEntry *entry = [self entryWithSlotValue:[_storage readStringForKey:[self slotKey:slot]]];
+        entry.slot = slot;
+        if (entry && ![_messageIds containsObject:entry.messageId]) {
+            [_entries addObject:entry];
+            [_messageIds addObject:entry.messageId];
+        }
+    }
+    _tail = tail;
+    
+    [self commitValues:nil removeKeys:[self removeExpired]];
+}
+
+- (NSMutableArray<NSString *> *)removeExpired {
+    // Must be called from synchronized block. Returns keys to be removed from storage.
+    NSMutableArray  *retValue   = [NSMutableArray new];
+    NSTimeInterval  now         = [NSDate date].timeIntervalSince1970;
+    
+    NSIndexSet *expired = [_entries indexesOfObjectsPassingTest:^BOOL(MessageInboxEntry *entry, NSUInteger idx, BOOL *stop) {
+        return entry.expiry <= now;
+    }];
+    [expired enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        [retValue addObject:[self slotKey:self.entries[idx].slot]];
+        [self.messageIds removeObject:self.entries[idx].messageId];
+    }];
+    [_entries removeObjectsAtIndexes:expired];
+    
+    return retValue;
+}
+
+- (BOOL)commitValues:(NSDictionary *)values removeKeys:(NSArray<NSString *> *)removeKeys {
+    // Must be called from synchronized block. Head follows the oldest entry unless it's provided.
+    if (!values.count && !removeKeys.count) {
+        return YES;
+    }
+    
+    NSMutableDictionary *allValues = [NSMutableDictionary dictionaryWithDictionary:values];
+    if (!allValues[kInboxKeyHead]) {
+        allValues[kInboxKeyHead] = @(_entries.firstObject ? _entries.firstObject.slot : _tail);
+    }
+    
+    return [_storage commitValues:allValues removeKeys:removeKeys];
+}
+
+- (NSString *)slotValue:(MessageInboxEntry *)entry {
+    // Expiry, client id and message id separated by tab. Client id might be empty.
+    return [NSString stringWithFormat:@"%.0f\t%@\t%@", entry.expiry, entry.clientId ?: @"", entry.messageId];
+}
+
+- (MessageInboxEntry *)entryWithSlotValue:(NSString *)value {
+    NSArray<NSString *> *components = [value componentsSeparatedByString:@"\t"];
+    if (components.count != 3 || !components[2].length) {
+        return nil;
+    }
+    
+    MessageInboxEntry *retValue = [MessageInboxEntry new];
+    retValue.expiry     = components[0].doubleValue;
+    retValue.clientId   = components[1].length ? components[1] : nil;
+    retValue.messageId  = components[2];
+    return retValue;
+}
+
+- (NSString *)slotKey:(int64_t)slot {
+    return [NSString stringWithFormat:kInboxKeySlot, slot];
+}
+
+@end
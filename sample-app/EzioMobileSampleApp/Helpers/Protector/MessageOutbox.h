@@ -0,0 +1,120 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+/**
+ Signing response waiting for delivery to server.
+ */
+@interface MessageOutboxEntry : NSObject
+
+/**
+ Id of incoming message this response belongs to.
+ */
+@property (nonatomic, copy, readonly)   NSString            *messageId;
+
+/**
+ Client id which received the message.
+ */
+@property (nonatomic, copy, readonly)   NSString            *clientId;
+
+/**
+ OTP of approved request or nil if request was rejected.
+ */
+@property (nonatomic, strong, readonly) id<EMSecureString>  otp;
+
+@end
+
+/**
+ Durable queue of signing responses which were not confirmed by server yet.
+ Content is persisted before each send, so user reaction survives lost connection as well as application restart.
+ Each message id is queued only once and responses expire after given time.
+ OTP values are kept as secure values under their own keys and wiped once response leaves the queue.
+ */
+@interface MessageOutbox : NSObject
+
+/**
+ Number of pending, not expired responses.
+ */
+@property (atomic, assign, readonly) NSUInteger count;
+
+/**
+ Create outbox on top of given storage. Existing content is loaded right away.
+ Storage should be encrypted, since it keeps OTP values.
+
+ @param storage Storage used to persist the queue.
+ @param capacity Maximum number of pending responses.
+ @param timeToLive Time after which pending response is dropped.
+ @return New instance
+ */
+- (instancetype)initWithStorage:(id<StorageProtocol>)storage
+                       capacity:(NSUInteger)capacity
+                     timeToLive:(NSTimeInterval)timeToLive;
+
+/**
+ Add response to the end of the queue. Response already queued for the same message id is replaced.
+
+ @param messageId Id of incoming message.
+ @param clientId Client id which received the message.
+ @param otp OTP of approved request or nil for rejected one. Queue keeps its own copy.
+ @return YES if response was stored, NO if storing failed.
+ */
+- (BOOL)pushMessageId:(NSString *)messageId clientId:(NSString *)clientId otp:(id<EMSecureString>)otp;
+
+/**
+ Get oldest pending responses without removing them.
+
+ @param limit Maximum number of returned responses.
+ @return Pending responses, oldest first.
+ */
+- (NSArray<MessageOutboxEntry *> *)peekEntries:(NSUInteger)limit;
+
+/**
+ Check whether response of given message id is still waiting for delivery.
+
+ @param messageId Id of incoming message.
+ @return YES if response is queued.
+ */
+- (BOOL)containsMessageId:(NSString *)messageId;
+
+/**
+ Remove response of given message id from the queue. Usually once it was delivered.
+
+ @param messageId Id of incoming message.
+ @return YES if response was removed.
+ */
+- (BOOL)removeMessageId:(NSString *)messageId;
+
+/**
+ Remove all pending responses of given client id. Usually once client was unregistered.
+
+ @param clientId Client id of responses to remove.
+ */
+- (void)removeClientId:(NSString *)clientId;
+
+/**
+ Remove all pending responses.
+ */
+- (void)removeAll;
+
+@end
@@ -0,0 +1,351 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import "MessageOutbox.h"
+
+// Queue order and metadata are stored as one value. It's short and changes only with user reaction.
+// OTP values never go there. Each of them is kept as secure value in its own slot.
+#define kOutboxKey          @"Outbox"
+#define kOutboxOtpKey       @"OutboxOtp"
+#define kOutboxMessageId    @"messageId"
+#define kOutboxClientId     @"clientId"
+#define kOutboxSlot         @"slot"
+#define kOutboxExpiry       @"expiry"
+
+@interface MessageOutboxEntry()
+
+@property (nonatomic, copy)     NSString            *messageId;
+@property (nonatomic, copy)     NSString            *clientId;
+@property (nonatomic, strong)   id<EMSecureString>  otp;
+@property (nonatomic, assign)   NSInteger           slot;
+@property (nonatomic, assign)   NSTimeInterval      expiry;
+
+@end
+
+@implementation MessageOutboxEntry
+
+@end
+
+@interface MessageOutbox()
+
+@property (nonatomic, strong) id<StorageProtocol>                   storage;
+@property (nonatomic, assign) NSUInteger                            capacity;
+@property (nonatomic, assign) NSTimeInterval                        timeToLive;
+@property (nonatomic, strong) NSMutableArray<MessageOutboxEntry *>  *entries;
+
+@end
+
+@implementation MessageOutbox
+
+// MARK: - Life Cycle
+
+- (instancetype)initWithStorage:(id<StorageProtocol>)storage
+                       capacity:(NSUInteger)capacity
+                     timeToLive:(NSTimeInterval)timeToLive {
+    if (self = [super init]) {
+        self.storage    = storage;
+        self.capacity   = MAX(capacity, 1);
+        self.timeToLive = timeToLive;
+        self.entries    = [NSMutableArray new];
+        
+        [self load];
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    for (MessageOutboxEntry *loopEntry in _entries) {
+        [loopEntry.otp wipe];
+    }
+}
+
+// MARK: - Public API
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        [self saveExpired];
+        return _entries.count;
+    }
+}
+
+- (BOOL)pushMessageId:(NSString *)messageId clientId:(NSString *)clientId otp:(id<EMSecureString>)otp {
+    if (!messageId) {
+        return NO;
+    }
+    
+    @synchronized (self) {
+        NSMutableArray<NSString *>  *removedKeys    = [self removeExpired];
+        NSUInteger                  index           = [self indexOfMessageId:messageId];
+        MessageOutboxEntry          *entry          = index == NSNotFound ? nil : _entries[index];
+        
+        // User reacted to the same message again. Latest reaction replaces the queued one.
+        if (entry) {
+            [entry.otp wipe];
+            [_entries removeObjectAtIndex:index];
+            if (entry.slot >= 0 && !otp) {
+                [removedKeys addObject:[self otpKeyForSlot:entry.slot]];
+            }
+        } else {
+            entry           = [MessageOutboxEntry new];
+            entry.messageId = messageId;
+            entry.clientId  = clientId;
+            entry.slot      = -1;
+            
+            // Make room for new one. Oldest responses are least likely to be still accepted by server.
+            while (_entries.count >= _capacity) {
+                [removedKeys addObjectsFromArray:[self removeEntriesAtIndexes:[NSIndexSet indexSetWithIndex:0]]];
+            }
+        }
+        
+        entry.otp       = [otp copy];
+        entry.slot      = otp ? (entry.slot >= 0 ? entry.slot : [self freeSlot]) : -1;
+        entry.expiry    = [NSDate date].timeIntervalSince1970 + _timeToLive;
+        
+        // Entry must be persisted before it's sent. Otherwise it would be lost with the application.
+        // OTP goes first, so stored queue never points to missing value.
+        NSString *otpKey = otp ? [self otpKeyForSlot:entry.slot] : nil;
+        if (otpKey) {
+            [removedKeys removeObject:otpKey];
+        }
+        if (otpKey && ![_storage writeSecureBytes:entry.otp forKey:otpKey]) {
+            [entry.otp wipe];
+            [self saveRemoving:removedKeys];
+            return NO;
+        }
+        
+        [_entries addObject:entry];
+        if (![self saveRemoving:removedKeys]) {
+            [_entries removeObject:entry];
+            [entry.otp wipe];
+            if (otpKey) {
+                [_storage removeValueForKey:otpKey];
+            }
+            return NO;
+        }
+        
+        return YES;
+    }
+}
+
+- (NSArray<MessageOutboxEntry *> *)peekEntries:(NSUInteger)limit {
+    @synchronized (self) {
+        [self saveExpired];
+        return [_entries subarrayWithRange:NSMakeRange(0, MIN(limit, _entries.count))];
+    }
+}
+
+- (BOOL)containsMessageId:(NSString *)messageId {
+    @synchronized (self) {
+        return [self indexOfMessageId:messageId] != NSNotFound;
+    }
+}
+
+- (BOOL)removeMessageId:(NSString *)messageId {
+    @synchronized (self) {
+        NSUInteger index = [self indexOfMessageId:messageId];
+        if (index == NSNotFound) {
+            return NO;
+        }
+        
+        NSMutableArray<NSString *> *removedKeys = [self removeEntriesAtIndexes:[NSIndexSet indexSetWithIndex:index]];
+        [removedKeys addObjectsFromArray:[self removeExpired]];
+        return [self saveRemoving:removedKeys];
+    }
+}
+
+- (void)removeClientId:(NSString *)clientId {
+    @synchronized (self) {
+        NSIndexSet *removed = [_entries indexesOfObjectsPassingTest:^BOOL(MessageOutboxEntry *entry, NSUInteger idx, BOOL *stop) {
+            return [entry.clientId isEqualToString:clientId];
+        }];
+        NSMutableArray<NSString *> *removedKeys = [self removeEntriesAtIndexes:removed];
+        [removedKeys addObjectsFromArray:[self removeExpired]];
+        [self saveRemoving:removedKeys];
+    }
+}
+
+- (void)removeAll {
+    @synchronized (self) {
+        [self removeEntriesAtIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, _entries.count)]];
+        [self saveRemoving:[self allSlotKeys]];
+    }
+}
+
+// MARK: - Private Helpers
+
+- (void)load {
+    NSData  *data   = [[_storage readStringForKey:kOutboxKey] dataUsingEncoding:NSUTF8StringEncoding];
+    NSArray *values = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    if (![values isKindOfClass:[NSArray class]]) {
+        return;
+    }
+    
+    BOOL changed = NO;
+    for (NSDictionary *loopValue in values) {
+        if (![loopValue isKindOfClass:[NSDictionary class]] || ![loopValue[kOutboxMessageId] isKindOfClass:[NSString class]]) {
+            changed = YES;
+            continue;
+        }
+        
+        MessageOutboxEntry *entry = [MessageOutboxEntry new];
+        entry.messageId = loopValue[kOutboxMessageId];
+        entry.clientId  = loopValue[kOutboxClientId];
+        entry.slot      = loopValue[kOutboxSlot] ? [loopValue[kOutboxSlot] integerValue] : -1;
+        entry.expiry    = [loopValue[kOutboxExpiry] doubleValue];
+        
+        if (entry.slot >= 0) {
+            id<EMSecureByteArray> otp = [_storage readSecureBytesForKey:[self otpKeyForSlot:entry.slot]];
+            
+            // Approved response without its OTP would be delivered as rejected one. Drop it instead.
+            if (!otp) {
+                changed = YES;
+                continue;
+            }
+            entry.otp = [[[NSString alloc] initWithData:otp.dataValue encoding:NSUTF8StringEncoding] secureString];
+            [otp wipe];
+        }
+        
+        [_entries addObject:entry];
+    }
+    
+    // Slots not referenced by the queue are leftovers of interrupted push.
+    NSUInteger                  loaded      = _entries.count;
+    NSMutableArray<NSString *>  *removedKeys = [self removeExpired];
+    changed = changed || _entries.count != loaded;
+    for (NSString *loopKey in [self allSlotKeys]) {
+        if (![self isSlotKeyUsed:loopKey]) {
+            [removedKeys addObject:loopKey];
+        }
+    }
+    
+    if (changed || removedKeys.count) {
+        [self saveRemoving:removedKeys];
+    }
+}
+
+- (BOOL)saveRemoving:(NSArray<NSString *> *)removedKeys {
+    // Must be called from synchronized block. Queue and removal of released OTP slots are stored together.
+    if (!_entries.count) {
+        return [_storage commitValues:@{} removeKeys:[@[kOutboxKey] arrayByAddingObjectsFromArray:removedKeys ?: @[]]];
+    }
+    
+    NSMutableArray *values = [NSMutableArray arrayWithCapacity:_entries.count];
+    for (MessageOutboxEntry *loopEntry in _entries) {
+        NSMutableDictionary *value = [NSMutableDictionary new];
+        value[kOutboxMessageId] = loopEntry.messageId;
+        value[kOutboxClientId]  = loopEntry.clientId;
+        value[kOutboxExpiry]    = @(loopEntry.expiry);
+        if (loopEntry.slot >= 0) {
+            value[kOutboxSlot]  = @(loopEntry.slot);
+        }
+        [values addObject:value];
+    }
+    
+    NSData *data = [NSJSONSerialization dataWithJSONObject:values options:0 error:nil];
+    return data && [_storage commitValues:@{kOutboxKey: [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]}
+                               removeKeys:removedKeys ?: @[]];
+}
+
+- (void)saveExpired {
+    // Must be called from synchronized block. Store queue only if anything actually expired.
+    NSUInteger                  count       = _entries.count;
+    NSMutableArray<NSString *>  *removedKeys = [self removeExpired];
+    if (_entries.count != count) {
+        [self saveRemoving:removedKeys];
+    }
+}
+
+- (NSMutableArray<NSString *> *)removeExpired {
+    // Must be called from synchronized block. Returns OTP keys of removed entries.
+    NSTimeInterval  now     = [NSDate date].timeIntervalSince1970;
+    NSIndexSet      *expired = [_entries indexesOfObjectsPassingTest:^BOOL(MessageOutboxEntry *entry, NSUInteger idx, BOOL *stop) {
+        return entry.expiry <= now;
+    }];
+    
+    return [self removeEntriesAtIndexes:expired];
+}
+
+- (NSMutableArray<NSString *> *)removeEntriesAtIndexes:(NSIndexSet *)indexes {
+    // Must be called from synchronized block. Returns OTP keys of removed entries.
+    NSMutableArray<NSString *> *retValue = [NSMutableArray new];
+    for (MessageOutboxEntry *loopEntry in [_entries objectsAtIndexes:indexes]) {
+        [loopEntry.otp wipe];
+        if (loopEntry.slot >= 0) {
+            [retValue addObject:[self otpKeyForSlot:loopEntry.slot]];
+        }
+    }
+    [_entries removeObjectsAtIndexes:indexes];
+    
+    return retValue;
+}
+
+- (NSInteger)freeSlot {
+    // Must be called from synchronized block. Queue never holds more entries than there are slots.
+    NSMutableIndexSet *used = [NSMutableIndexSet new];
+    for (MessageOutboxEntry *loopEntry in _entries) {
+        if (loopEntry.slot >= 0) {
+            [used addIndex:loopEntry.slot];
+        }
+    }
+    
+    NSInteger retValue = 0;
+    while ([used containsIndex:retValue]) {
+        retValue++;
+    }
+    
+    return retValue;
+}
+
+- (NSString *)otpKeyForSlot:(NSInteger)slot {
+    return [NSString stringWithFormat:@"%@%ld", kOutboxOtpKey, (long)slot];
+}
+
+- (NSArray<NSString *> *)allSlotKeys {
+    NSMutableArray<NSString *> *retValue = [NSMutableArray arrayWithCapacity:_capacity];
+    for (NSUInteger slot = 0; slot < _capacity; slot++) {
+        [retValue addObject:[self otpKeyForSlot:slot]];
+    }
+    
+    return retValue;
+}
+
+- (BOOL)isSlotKeyUsed:(NSString *)key {
+    for (MessageOutboxEntry *loopEntry in _entries) {
+        if (loopEntry.slot >= 0 && [[self otpKeyForSlot:loopEntry.slot] isEqualToString:key]) {
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+- (NSUInteger)indexOfMessageId:(NSString *)messageId {
+    return [_entries indexOfObjectPassingTest:^BOOL(MessageOutboxEntry *entry, NSUInteger idx, BOOL *stop) {
+        return [entry.messageId isEqualToString:messageId];
+    }];
+}
+
+@end
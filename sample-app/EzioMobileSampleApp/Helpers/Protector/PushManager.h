@@ -28,7 +28,9 @@
 extern NSString * const C_NOTIFICATION_ID_INCOMING_MESSAGE;
 
 /**
- Helper class to handle push notifications
+ Helper class to handle push notifications.
+ Client ids of any number of tokens are stored and routed independently. Sample UI still enrolls and uses only one token,
+ so second token can be added only through TokenManager and this class.
  */
 @interface PushManager : NSObject
 
@@ -38,7 +40,7 @@ extern NSString * const C_NOTIFICATION_ID_INCOMING_MESSAGE;
 @property (nonatomic, copy, readonly)       NSString    *currentPushToken;
 
 /**
- Whenever is last provided push token registered on OOB server.
+ Whenever is last provided push token registered on OOB server for all known client ids.
  */
 @property (nonatomic, assign, readonly)     BOOL        isPushTokenRegistered;
 
@@ -47,6 +49,84 @@ extern NSString * const C_NOTIFICATION_ID_INCOMING_MESSAGE;
  */
 @property (nonatomic, assign, readonly)     BOOL        isIncomingMessageInQueue;
 
+/**
+ Keep asking server for new messages of all registered tokens in a loop while application is in foreground.
+ Useful on devices with unreliable push delivery. Received messages go through the same flow as push notifications.
+ Disabled by default.
+ */
+@property (nonatomic, assign)               BOOL        longPollEnabled;
+
+/**
+ Number of fetched messages which were handed over to user straight from prefetch.
+ */
+@property (atomic, assign, readonly)        NSUInteger      readyPrefetchedCount;
+
+/**
+ Total time in seconds from fetch request till message was handed over to user, for messages counted in readyPrefetchedCount.
+ */
+@property (atomic, assign, readonly)        NSTimeInterval  readyPrefetchedTime;
+
+/**
+ Number of fetched messages which had to be downloaded once user asked for them.
+ */
+@property (atomic, assign, readonly)        NSUInteger      readyOnDemandCount;
+
+/**
+ Total time in seconds from fetch request till message was handed over to user, for messages counted in readyOnDemandCount.
+ */
+@property (atomic, assign, readonly)        NSTimeInterval  readyOnDemandTime;
+
+/**
+ Number of incoming messages from push and long poll. Those arriving within short window are handled together as one burst.
+ */
+@property (atomic, assign, readonly)        NSUInteger      burstPushCount;
+
+/**
+ Number of handled bursts. Each of them is stored with single write and announced to UI with single notification.
+ */
+@property (atomic, assign, readonly)        NSUInteger      burstFlushCount;
+
+/**
+ Number of OOB message and notification managers reused from cache instead of being created again.
+ */
+@property (atomic, assign, readonly)        NSUInteger      managerCacheHitCount;
+
+/**
+ Number of messages delivered by both push and long poll, where push came first.
+ */
+@property (atomic, assign, readonly)        NSUInteger      deliveredFirstByPushCount;
+
+/**
+ Number of messages delivered by both push and long poll, where long poll came first.
+ */
+@property (atomic, assign, readonly)        NSUInteger      deliveredFirstByLongPollCount;
+
+/**
+ Total time in seconds by which the faster channel was ahead, for messages delivered by both channels.
+ */
+@property (atomic, assign, readonly)        NSTimeInterval  deliveryLeadTime;
+
+/**
+ Create manager with configured OOB server on top of application storages.
+
+ @return New instance
+ */
+- (instancetype)init;
+
+/**
+ Create manager on top of given OOB manager and storages. Useful for tests with stand-in server and scratch storages.
+
+ @param oobManager OOB manager used for all server calls.
+ @param storageFast Storage of push tokens and registration state.
+ @param storageSecure Storage of client ids and queued signing responses.
+ @param storageJournal Storage of incoming message ids.
+ @return New instance
+ */
+- (instancetype)initWithOobManager:(id<EMOobManager>)oobManager
+                       storageFast:(id<StorageProtocol>)storageFast
+                     storageSecure:(id<StorageProtocol>)storageSecure
+                    storageJournal:(id<StorageProtocol>)storageJournal NS_DESIGNATED_INITIALIZER;
+
 /**
  Should be called each time application get push token from Apple.
  Usually direclty from didRegisterForRemoteNotificationsWithDeviceToken.
@@ -58,14 +138,25 @@ extern NSString * const C_NOTIFICATION_ID_INCOMING_MESSAGE;
     completionHandler:(GenericCompletion)completionHandler;
 
 /**
- Register current push token with specified client Id.
+ Register current push token with specified client Id of given token.
+ Each token has its own client Id. Incoming pushes are routed to the token by their client Id.
 
  @param clientId OOB Client ID
+ @param tokenName Name of token owning the client Id
  @param completionHandler Triggered once operation is finished
  */
 - (void)registerClientId:(NSString *)clientId
+               tokenName:(NSString *)tokenName
        completionHandler:(GenericCompletion)completionHandler;
 
+/**
+ Assign client Id stored by older versions, which supported only one token, to given token.
+ Does nothing when there is no such client Id.
+
+ @param tokenName Name of token owning the legacy client Id
+ */
+- (void)adoptLegacyClientIdWithTokenName:(NSString *)tokenName;
+
 /**
  Register to OOB and store given client Id.
 
@@ -78,11 +169,14 @@ extern NSString * const C_NOTIFICATION_ID_INCOMING_MESSAGE;
             completionHandler:(void (^)(id<EMOobRegistrationResponse> aResponse, NSError *anError))completionHandler;
 
 /**
- Unregister all push tokens for current client Id on server.
+ Unregister all push tokens for client Id of given token on server.
+ Local values of the token are removed even if it was never registered. That includes signing responses
+ of the client still waiting for delivery, since server does not accept them from unregistered client.
 
+ @param tokenName Name of token owning the client Id
  @param completionHandler Triggered once operation is finished
  */
-- (void)unregisterOOBWithCompletionHandler:(GenericCompletion)completionHandler;
+- (void)unregisterOOBWithTokenName:(NSString *)tokenName completionHandler:(GenericCompletion)completionHandler;
 
 /**
  Proccess incoming push notification.
@@ -92,7 +186,8 @@ extern NSString * const C_NOTIFICATION_ID_INCOMING_MESSAGE;
 - (void)processIncomingPush:(NSDictionary *)notification;
 
 /**
- Fetch latest queued message from server and process it through the same flow as incoming push notification.
+ Fetch oldest queued message from server and process it through the same flow as incoming push notification.
+ Queued messages are drained in order of arrival. Without any queued message id, server is asked for any pending message.
 
  @param handler UI Handler
  */
@@ -24,22 +24,116 @@
 //            Please make sure to review our IdCloud documentation, including security guidelines.
 
 #import "PushManager.h"
+#import "MessageInbox.h"
+#import "MessageOutbox.h"
+#import "SubjectTemplate.h"
 
 NSString * const C_NOTIFICATION_ID_INCOMING_MESSAGE = @"NotificationIdIncomingMessage";
 
-typedef enum : NSInteger {
-    kUnregistered   = 0,
-    kRegistered     = 1,
-} ClientIdState;
-
 // Message type we want to handle. Contain message id to fetch and origin client id.
 #define kPushMessageType                @"com.gemalto.msm"
 #define kPushMessageClientId            @"clientId"
 #define kPushMessageMessageId           @"messageId"
 
+// Pending message ids. Older ones are dropped, since server will not keep them for long anyway.
+#define kInboxCapacity                  64
+#define kInboxTimeToLive                (60.0 * 60.0)
+
+// Maximum number of messages fetched ahead of user interaction.
+#define kPrefetchCapacity               8
+
+// Pushes arriving within this window in seconds are handled together.
+#define kPushBurstWindow                0.25
+
+// Long poll timeout in seconds grows while there are no messages. Failures are retried with backoff.
+#define kLongPollMinTimeout             10
+#define kLongPollMaxTimeout             60
+#define kLongPollMaxBackoff             300.0
+
+// Signing responses not confirmed by server are resent in batches. Failed attempts are retried with backoff.
+#define kOutboxCapacity                 16
+#define kOutboxTimeToLive               (60.0 * 60.0)
+#define kOutboxBatchSize                4
+#define kOutboxMinBackoff               5.0
+#define kOutboxMaxBackoff               300.0
+
+/**
+ Result of signing response delivery. Response which was not delivered stays in the outbox.
+ */
+typedef void (^OutboxCompletion)(BOOL delivered, NSError *error);
+
+/**
+ Message fetched right after push arrived. Result is kept until UI asks for it.
+ */
+@interface PushPrefetch : NSObject
+
+@property (nonatomic, strong)   id<EMOobMessageManager>         manager;
+@property (nonatomic, copy)     NSString                        *clientId;
+@property (nonatomic, strong)   id<EMOobFetchMessageResponse>   response;
+@property (nonatomic, strong)   NSError                         *error;
+@property (nonatomic, assign)   BOOL                            finished;
+@property (nonatomic, assign)   BOOL                            pinned;
+@property (nonatomic, strong)   NSMutableArray<dispatch_block_t> *waiters;
+
+@end
+
+@implementation PushPrefetch
+
+@end
+
+/**
+ Push token registration of one client id which is on the way.
+ */
+@interface PushRegistration : NSObject
+
+@property (nonatomic, copy)     NSString                            *pushToken;
+@property (nonatomic, strong)   NSMutableArray<GenericCompletion>   *handlers;
+@property (nonatomic, strong)   NSMutableArray<GenericCompletion>   *followUpHandlers;
+
+@end
+
+@implementation PushRegistration
+
+@end
+
 @interface PushManager()
 
-@property (nonatomic, strong)   id<EMOobManager>    oobManager;
+@property (nonatomic, strong)   id<EMOobManager>                                oobManager;
+@property (nonatomic, strong)   id<StorageProtocol>                             storageFast;
+@property (nonatomic, strong)   id<StorageProtocol>                             storageSecure;
+@property (nonatomic, strong)   MessageInbox                                    *inbox;
+@property (nonatomic, strong)   NSMutableDictionary<NSString *, PushPrefetch *> *prefetches;
+@property (nonatomic, strong)   NSMutableArray<NSString *>                      *prefetchOrder;
+@property (nonatomic, strong)   NSMapTable                                      *parsedData;
+@property (nonatomic, assign)   CFTimeInterval                                  fetchStarted;
+@property (nonatomic, assign)   BOOL                                            fetchPrefetched;
+@property (atomic, assign, readwrite)   NSUInteger                              readyPrefetchedCount;
+@property (atomic, assign, readwrite)   NSTimeInterval                          readyPrefetchedTime;
+@property (atomic, assign, readwrite)   NSUInteger                              readyOnDemandCount;
+@property (atomic, assign, readwrite)   NSTimeInterval                          readyOnDemandTime;
+@property (nonatomic, assign)   NSUInteger                                      longPollGeneration;
+@property (nonatomic, assign)   NSInteger                                       longPollTimeout;
+@property (nonatomic, assign)   NSUInteger                                      longPollFailures;
+@property (nonatomic, strong)   NSMutableDictionary<NSString *, NSArray *>      *deliveries;
+@property (atomic, assign, readwrite)   NSUInteger                              deliveredFirstByPushCount;
+@property (atomic, assign, readwrite)   NSUInteger                              deliveredFirstByLongPollCount;
+@property (atomic, assign, readwrite)   NSTimeInterval                          deliveryLeadTime;
+@property (atomic, copy)        NSDictionary<NSString *, NSString *>            *clientIds;
+@property (atomic, copy)        NSDictionary<NSString *, NSString *>            *routing;
+@property (nonatomic, strong)   NSMutableDictionary<NSString *, PushRegistration *> *registrations;
+@property (nonatomic, strong)   NSMutableDictionary<NSString *, id>             *managerCache;
+@property (nonatomic, strong)   NSMapTable                                      *managerClientIds;
+@property (nonatomic, strong)   NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *managerKeys;
+@property (atomic, assign, readwrite)   NSUInteger                              managerCacheHitCount;
+@property (nonatomic, strong)   NSMutableArray<NSString *>                      *burstMessageIds;
+@property (nonatomic, strong)   NSMutableArray<NSString *>                      *burstClientIds;
+@property (atomic, assign, readwrite)   NSUInteger                              burstPushCount;
+@property (atomic, assign, readwrite)   NSUInteger                              burstFlushCount;
+@property (nonatomic, strong)   MessageOutbox                                   *outbox;
+@property (nonatomic, strong)   NSMutableDictionary<NSString *, NSMutableArray<OutboxCompletion> *> *outboxSending;
+@property (nonatomic, assign)   BOOL                                            outboxDraining;
+@property (nonatomic, assign)   BOOL                                            outboxScheduled;
+@property (nonatomic, assign)   NSUInteger                                      outboxFailures;
 
 @end
 
@@ -50,17 +144,14 @@ typedef enum : NSInteger {
 - (id)init {
     NSError *error = nil;
     
-    if (self = [super init]) {
-        // Try to read previous push token already registered by app.
-        NSData *CFG_OOB_RSA_KEY_MODULUS_DATA = [self dataFromHexString: CFG_OOB_RSA_KEY_MODULUS_STRING()];
-        _currentPushToken   = [self lastProvidedTokenRead];
-        self.oobManager     = [[EMOobModule oobModule] createOobManagerWithURL:CFG_OOB_URL()
-                                                                        domain:CFG_OOB_DOMAIN()
-                                                                 applicationId:CFG_OOB_APP_ID()
-                                                                   rsaExponent:CFG_OOB_RSA_KEY_EXPONENT()
-                                                                    rsaModulus:CFG_OOB_RSA_KEY_MODULUS_DATA
-                                                                         error:&error];
-    }
+    // OOB manager for configured server.
+    NSData              *CFG_OOB_RSA_KEY_MODULUS_DATA   = [self dataFromHexString: CFG_OOB_RSA_KEY_MODULUS_STRING()];
+    id<EMOobManager>    oobManager                      = [[EMOobModule oobModule] createOobManagerWithURL:CFG_OOB_URL()
+                                                                                                    domain:CFG_OOB_DOMAIN()
+                                                                                             applicationId:CFG_OOB_APP_ID()
+                                                                                               rsaExponent:CFG_OOB_RSA_KEY_EXPONENT()
+                                                                                                rsaModulus:CFG_OOB_RSA_KEY_MODULUS_DATA
+                                                                                                     error:&error];
     
     // Something went wrong during init phase.
     // Probably wrong configuration, license etc..
@@ -69,19 +160,88 @@ typedef enum : NSInteger {
         assert(false);
         return nil;
     }
-    else {
-        return self;
+    
+    return [self initWithOobManager:oobManager
+                        storageFast:CMain.sharedInstance.storageFast
+                      storageSecure:CMain.sharedInstance.storageSecure
+                     storageJournal:CMain.sharedInstance.storageJournal];
+}
+
+- (instancetype)initWithOobManager:(id<EMOobManager>)oobManager
+                       storageFast:(id<StorageProtocol>)storageFast
+                     storageSecure:(id<StorageProtocol>)storageSecure
+                    storageJournal:(id<StorageProtocol>)storageJournal {
+    if (self = [super init]) {
+        self.oobManager     = oobManager;
+        self.storageFast    = storageFast;
+        self.storageSecure  = storageSecure;
+        
+        // Try to read previous push token already registered by app.
+        _currentPushToken   = [self lastProvidedTokenRead];
+        [self clientIdsLoad];
+        self.registrations  = [NSMutableDictionary new];
+        self.inbox          = [[MessageInbox alloc] initWithStorage:storageJournal
+                                                           capacity:kInboxCapacity
+                                                         timeToLive:kInboxTimeToLive];
+        [self incomingMessageIdMigrate];
+        self.prefetches     = [NSMutableDictionary new];
+        self.prefetchOrder  = [NSMutableArray new];
+        self.parsedData     = [NSMapTable weakToStrongObjectsMapTable];
+        self.deliveries     = [NSMutableDictionary new];
+        self.burstMessageIds    = [NSMutableArray new];
+        self.burstClientIds     = [NSMutableArray new];
+        self.managerCache       = [NSMutableDictionary new];
+        self.managerClientIds   = [NSMapTable weakToStrongObjectsMapTable];
+        self.managerKeys        = [NSMutableDictionary new];
+        self.outbox             = [[MessageOutbox alloc] initWithStorage:storageSecure
+                                                                capacity:kOutboxCapacity
+                                                              timeToLive:kOutboxTimeToLive];
+        self.outboxSending      = [NSMutableDictionary new];
+        
+        // Long poll runs only while application is in foreground.
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(longPollStop)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(longPollStart)
+                                                     name:UIApplicationWillEnterForegroundNotification
+                                                   object:nil];
+        
+        // Connection is most likely back once user returns to application.
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(outboxDrain)
+                                                     name:UIApplicationWillEnterForegroundNotification
+                                                   object:nil];
+        
+        // Deliver responses left from last run once everything is set up.
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self outboxDrain];
+        });
     }
+    
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
 }
 
 // MARK: - Public API
 
 - (BOOL)isPushTokenRegistered {
-    return [self lastRegisteredTokenRead] != nil;
+    // Push token must be registered for all client ids.
+    NSDictionary *clientIds = self.clientIds;
+    for (NSString *loopTokenName in clientIds) {
+        if (![self lastRegisteredTokenRead:loopTokenName]) {
+            return NO;
+        }
+    }
+    return clientIds.count > 0;
 }
 
 - (BOOL)isIncomingMessageInQueue {
-    return [self lastMessageIdRead] != nil;
+    return _inbox.count > 0;
 }
 
 - (void)registerToken:(NSString *)token completionHandler:(GenericCompletion)completionHandler {
@@ -92,18 +252,42 @@ typedef enum : NSInteger {
     }
 
     // Check if new registration is needed even if token is same like last time.
-    [self registerCurrent:nil completionHandler:completionHandler];
+    NSArray *tokenNames = self.clientIds.allKeys;
+    if (!tokenNames.count) {
+        [self registerCurrent:nil completionHandler:completionHandler];
+        return;
+    }
+    
+    // Each client id has its own registration. Report first failure if any.
+    dispatch_group_t    group       = dispatch_group_create();
+    __block BOOL        retSuccess  = YES;
+    __block NSError     *retError   = nil;
+    for (NSString *loopTokenName in tokenNames) {
+        dispatch_group_enter(group);
+        [self registerCurrent:loopTokenName completionHandler:^(BOOL success, NSError *error) {
+            @synchronized (group) {
+                retSuccess  = retSuccess && success;
+                retError    = retError ?: error;
+            }
+            dispatch_group_leave(group);
+        }];
+    }
+    dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+        if (completionHandler) {
+            completionHandler(retSuccess, retError);
+        }
+    });
 }
 
 - (void)registerClientId:(NSString *)clientId
+               tokenName:(NSString *)tokenName
        completionHandler:(GenericCompletion)completionHandler {
     // There is not much secure about Client Id, we are using secure storage just as showcase.
-    // Because of that we will also update state in fast storage to not affect performance.
-    [self clientIdWrite:clientId];
-    [self clientIdStateWrite:kRegistered];
+    // All client ids are kept in memory as well, so storage is not touched with each push.
+    [self clientIdWrite:clientId tokenName:tokenName];
 
     // Check if new registration is needed.
-    [self registerCurrent:clientId completionHandler:completionHandler];
+    [self registerCurrent:tokenName completionHandler:completionHandler];
 }
 
 - (void)registerOOBWithUserId:(NSString *)userId
@@ -127,17 +311,16 @@ typedef enum : NSInteger {
     }
 }
 
-- (void)unregisterOOBWithCompletionHandler:(GenericCompletion)completionHandler {
+- (void)unregisterOOBWithTokenName:(NSString *)tokenName completionHandler:(GenericCompletion)completionHandler {
+    NSString *clientId = [self clientIdRead:tokenName];
+    
     // Push token is registered
-    if ([self isPushTokenRegistered]) {
+    if (clientId && [self lastRegisteredTokenRead:tokenName]) {
         // Call unregister
-        [self unRegisterOOBClientId:[self clientIdRead] completionHandler:^(BOOL success, NSError *error) {
+        [self unRegisterOOBClientId:clientId completionHandler:^(BOOL success, NSError *error) {
             if (success) {
                 // Remove all stored values.
-                [self lastRegisteredTokenDelete];
-                [self clientIdStateDelete];
-                [self lastMessageIdDelete];
-                [self clientIdDelete];
+                [self registrationDelete:tokenName];
             }
             if (completionHandler) {
                 completionHandler(success, error);
@@ -145,6 +328,8 @@ typedef enum : NSInteger {
         }];
     }
     else {
+        // Nothing to unregister on server. Just forget local values.
+        [self registrationDelete:tokenName];
         [self returnSuccessToHandler:completionHandler];
     }
 }
@@ -158,36 +343,52 @@ typedef enum : NSInteger {
     // Get client and message id out of it.
     NSString *msgClientId   = notification[kPushMessageClientId];
     NSString *msgMessageId  = notification[kPushMessageMessageId];
-    NSString *locClientId   = [self clientIdRead];
 
-    // Find related token / client id on local. React only on current one.
-    if (![msgClientId isEqualToString:locClientId]) {
+    // Find related token / client id on local. React only on registered ones.
+    // Routing is done in memory, without touching secure storage on main thread.
+    if (!msgClientId || !self.routing[msgClientId]) {
         return;
     }
 
-    // Store current id and send local notification to UI.
-    [self lastMessageIdWrite:msgMessageId];
+    [self deliveryRecord:msgMessageId longPoll:NO];
+    
+    // Queue current id and send local notification to UI.
+    // Server often sends several pushes in a row. Whole burst is stored and announced just once.
+    [self burstAddMessageId:msgMessageId clientId:msgClientId];
 }
 
 - (void)fetchMessagesWithHandler:(BaseViewController *)handler {
-
-    NSString *locClientId   = [self clientIdRead];
-
-    // Prepare manager with current client and provider id.
-    id<EMOobMessageManager> oobMessageManager = [_oobManager oobMessageManagerWithClientId:locClientId
-                                                                                providerId:CFG_OOB_PROVIDER_ID()];
+    // Check if there is any queued incoming message id. Oldest one goes first.
+    NSString        *locClientId    = nil;
+    NSString        *messageId      = [_inbox peekMessageId:&locClientId];
+    PushPrefetch    *prefetch       = messageId ? [self prefetchTake:messageId] : nil;
     
-    // Display loading bar to indicate message downloading.
-    [handler loadingIndicatorShowWithCaption:TRANSLATE(@"STRING_LOADING_FETCHING")];
+    // Prepare manager with message client id. Without it we can only ask for messages of current token.
+    id<EMOobMessageManager> oobMessageManager = [self messageManagerWithClientId:locClientId ?: [self clientIdCurrent]];
     
-    // Check if there is any stored incoming message id.
-    NSString *messageId = [self lastMessageIdRead];
-    if (messageId) {
-        // Remove last stored id and notify UI.
-        [self lastMessageIdDelete];
-        
+    self.fetchStarted       = CACurrentMediaTime();
+    self.fetchPrefetched    = prefetch.finished;
+    
+    // Display loading bar to indicate message downloading. Not needed if message is already here.
+    if (!prefetch.finished) {
+        [handler loadingIndicatorShowWithCaption:TRANSLATE(@"STRING_LOADING_FETCHING")];
+    }
+    
+    if (prefetch) {
+        // Message was already downloaded or it's on the way.
+        [self prefetch:prefetch notify:^{
+            if (!prefetch.error) {
+                [self incomingMessageIdDelete:messageId];
+            }
+            [self processFetchResponse:prefetch.manager response:prefetch.response error:prefetch.error handler:handler];
+        }];
+    } else if (messageId) {
         // Try to fetch any possible messages on server.
         [oobMessageManager fetchWithMessageId:messageId completionHandler:^(id<EMOobFetchMessageResponse> aResponse, NSError *anError) {
+            // Keep id in queue if server was not reached, so it can be fetched later.
+            if (!anError) {
+                [self incomingMessageIdDelete:messageId];
+            }
             [self processFetchResponse:oobMessageManager response:aResponse error:anError handler:handler];
         }];
     } else {
@@ -211,8 +412,15 @@ typedef enum : NSInteger {
 
     // Check response code and either proccess incoming message or display error.
     if (response.resultCode == EMOobResultCodeSuccess) {
+        // Server is reachable again. Good time to deliver pending responses.
+        [self outboxDrain];
+        
         if (response.oobIncomingMessage) {
             [self processIncomingMessage:response.oobIncomingMessage oobMessageManager:manager handler:handler];
+            [self fetchTimingRecord];
+        } else if (self.isIncomingMessageInQueue) {
+            // Message was already handled or expired on server. Continue with next queued one.
+            [self fetchMessagesWithHandler:handler];
         } else {
             notifyDisplay(TRANSLATE(@"STRING_MESSAGING_NO_MESSAGES"), NotifyTypeInfo);
         }
@@ -222,6 +430,20 @@ typedef enum : NSInteger {
     
 }
 
+- (void)fetchTimingRecord {
+    // Time from fetch request till message is handed over to user. Prefetch should bring it close to zero.
+    CFTimeInterval elapsed = CACurrentMediaTime() - _fetchStarted;
+    @synchronized (self) {
+        if (_fetchPrefetched) {
+            self.readyPrefetchedCount++;
+            self.readyPrefetchedTime += elapsed;
+        } else {
+            self.readyOnDemandCount++;
+            self.readyOnDemandTime += elapsed;
+        }
+    }
+}
+
 - (BOOL)processIncomingMessage:(id<EMOobIncomingMessage>)message
              oobMessageManager:(id<EMOobMessageManager>)oobMessageManager
                        handler:(BaseViewController *)handler
@@ -248,30 +470,30 @@ typedef enum : NSInteger {
                                  handler:(BaseViewController *)handler
 {
     NSError         *internalError  = nil;
-    id<EMMspParser> parser          = [[[EMMspService serviceWithModule:[EMMspModule mspModule]] mspFactory] createMspParser];
 
     // Get message subject key and fill in all values.
-    NSString *subject = TRANSLATE(request.subject.stringValue);
-    NSString *origSubject = subject;
-    NSString *params = @"";
-    if (request.meta.count > 0) {
-        for (NSString *key in request.meta.allKeys) {
-            NSString *placeholder = [NSString stringWithFormat:@"%%%@", key];
-            subject = [subject stringByReplacingOccurrencesOfString:placeholder withString:request.meta[key]];
-            params = [NSString stringWithFormat:@"%@%@%@%@%@", params, @"\n", key, @":", request.meta[key]];
-            if ([origSubject isEqual:subject]) {
-                // Message string does not contain the request fields, append them to message instead
-                subject = [TRANSLATE(@"message_subject_authentication_default") stringByAppendingString:params];
-            }
+    NSUInteger  replaced    = 0;
+    NSString    *subject    = [[SubjectTemplate templateWithString:TRANSLATE(request.subject.stringValue)] renderWithValues:request.meta
+                                                                                                            replacedCount:&replaced];
+    if (request.meta.count > 0 && !replaced) {
+        // Message string does not contain the request fields, append them to message instead
+        NSMutableString *params = [NSMutableString stringWithString:TRANSLATE(@"message_subject_authentication_default")];
+        for (NSString *key in request.meta) {
+            [params appendFormat:@"\n%@:%@", key, request.meta[key]];
         }
+        subject = params;
     }
 
     // Try to parse frame.
     do {
-        id<EMMspFrame>  frame   = [parser parse:request.mspFrame error:&internalError];
-        BREAK_IF_NOT_NULL(internalError);
-
-        id<EMMspData>   data    = [parser parseMspData:frame error:&internalError];
+        // Message might be already parsed during prefetch.
+        id<EMMspData> data = nil;
+        @synchronized (_parsedData) {
+            data = [_parsedData objectForKey:request];
+        }
+        if (!data) {
+            data = [self mspDataWithRequest:request error:&internalError];
+        }
         BREAK_IF_NOT_NULL(internalError);
         
         // For purpouse of this sample app we will support only OATH.
@@ -304,25 +526,42 @@ typedef enum : NSInteger {
                        oobMessageManager:(id<EMOobMessageManager>)oobMessageManager
                                  handler:(BaseViewController *)handler
                                      otp:(id<EMSecureString>)otp {
+    // Result is reported once response is delivered, or once it's left in the outbox for later.
+    NSString        *messageId  = request.messageId;
+    OutboxCompletion completion = ^(BOOL delivered, NSError *error) {
+        // Hide loading indicator in all cases, because sending is done.
+        [handler loadingIndicatorHide];
+        
+        if (delivered) {
+            notifyDisplay(TRANSLATE(@"STRING_MESSAGING_SENT"), NotifyTypeInfo);
+        } else if ([self.outbox containsMessageId:messageId]) {
+            notifyDisplay(TRANSLATE(@"STRING_MESSAGING_QUEUED"), NotifyTypeInfo);
+        } else {
+            notifyDisplayErrorIfExists(error);
+        }
+        
+        // Let UI continue with next queued message.
+        if (self.isIncomingMessageInQueue) {
+            [[NSNotificationCenter defaultCenter] postNotificationName:C_NOTIFICATION_ID_INCOMING_MESSAGE object:nil];
+        }
+    };
+    
+    // Response for this message is already on the way. Wait for its result instead of sending it twice.
+    if (![self outboxBegin:messageId completionHandler:completion]) {
+        return;
+    }
+    
     // If we get OTP it mean, that user did approved request.
     EMOobTransactionSigningResponseValue type = otp ? EMOobTransactionSigningResponseValueAccepted : EMOobTransactionSigningResponseValueRejected;
     id<EMOobTransactionSigningResponse> responseToSend = [request createWithResponse:type
                                                                                  otp:[otp copy] // Send copy, this instance will get wiped!
                                                                                 meta:nil];
     
+    // Keep response until server confirms it, so user reaction is not lost with connection or application.
+    [_outbox pushMessageId:messageId clientId:[self messageManagerClientId:oobMessageManager] otp:otp];
+    
     // Send message and wait display result.
-    [oobMessageManager sendWithMessage:responseToSend
-                     completionHandler:^(id<EMOobMessageResponse> response, NSError *error)
-     {
-         // Hide loading indicator in all cases, because sending is done.
-         [handler loadingIndicatorHide];
-         
-         if (response && !error) {
-             notifyDisplay(TRANSLATE(@"STRING_MESSAGING_SENT"), NotifyTypeInfo);
-         } else {
-             notifyDisplayErrorIfExists(error);
-         }
-     }];
+    [self outboxSend:responseToSend messageId:messageId manager:oobMessageManager];
 }
 
 - (BOOL)processTransactionVerifyRequest:(id<EMOobTransactionVerifyRequest>)request
@@ -333,9 +572,599 @@ typedef enum : NSInteger {
     return NO;
 }
 
+// MARK: - Burst
+
+- (void)burstAddMessageId:(NSString *)messageId clientId:(NSString *)clientId {
+    if (!messageId) {
+        return;
+    }
+    
+    @synchronized (_burstMessageIds) {
+        self.burstPushCount++;
+        [_burstMessageIds addObject:messageId];
+        [_burstClientIds addObject:clientId];
+        
+        // First push opens the window. Others just join it.
+        if (_burstMessageIds.count > 1) {
+            return;
+        }
+    }
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kPushBurstWindow * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [self burstFlush];
+    });
+}
+
+- (void)burstFlush {
+    NSArray<NSString *> *messageIds = nil;
+    NSArray<NSString *> *clientIds  = nil;
+    @synchronized (_burstMessageIds) {
+        messageIds  = [_burstMessageIds copy];
+        clientIds   = [_burstClientIds copy];
+        [_burstMessageIds removeAllObjects];
+        [_burstClientIds removeAllObjects];
+    }
+    
+    // One storage write for whole burst. Duplicates are skipped by inbox.
+    NSArray<NSString *> *stored = [_inbox pushMessageIds:messageIds clientIds:clientIds];
+    if (!stored.count) {
+        return;
+    }
+    self.burstFlushCount++;
+    
+    // New messages are downloaded right away, so they are ready once UI asks for them. UI goes through the queue
+    // from the oldest one, so only as many oldest ones as prefetch can keep. Rest is fetched as user gets to them.
+    NSUInteger count = MIN(stored.count, kPrefetchCapacity);
+    for (NSString *loopMessageId in [stored subarrayWithRange:NSMakeRange(0, count)]) {
+        [self prefetchMessageId:loopMessageId clientId:clientIds[[messageIds indexOfObject:loopMessageId]]];
+    }
+    [[NSNotificationCenter defaultCenter] postNotificationName:C_NOTIFICATION_ID_INCOMING_MESSAGE object:nil];
+}
+
+// MARK: - Prefetch
+
+- (void)prefetchMessageId:(NSString *)messageId clientId:(NSString *)clientId {
+    PushPrefetch *prefetch = [PushPrefetch new];
+    prefetch.waiters = [NSMutableArray new];
+    prefetch.manager = [self messageManagerWithClientId:clientId];
+    prefetch.clientId = clientId;
+    if (![self prefetchInsert:prefetch messageId:messageId]) {
+        return;
+    }
+    
+    [prefetch.manager fetchWithMessageId:messageId completionHandler:^(id<EMOobFetchMessageResponse> aResponse, NSError *anError) {
+        // Parse message right away as well, so dialog can be displayed without any delay.
+        [self prefetchParse:aResponse];
+        [self prefetch:prefetch finishWithResponse:aResponse error:anError manager:nil];
+    }];
+}
+
+- (BOOL)prefetch:(PushPrefetch *)prefetch
+finishWithResponse:(id<EMOobFetchMessageResponse>)response
+           error:(NSError *)error
+         manager:(id<EMOobMessageManager>)manager {
+    NSArray *waiters = nil;
+    @synchronized (_prefetches) {
+        // Long poll might have delivered the message meanwhile. Server will not return it again.
+        if (prefetch.finished) {
+            return NO;
+        }
+        prefetch.manager    = manager ?: prefetch.manager;
+        prefetch.response   = response;
+        prefetch.error      = error;
+        prefetch.finished   = YES;
+        waiters             = prefetch.waiters;
+        prefetch.waiters    = nil;
+    }
+    for (dispatch_block_t loopWaiter in waiters) {
+        loopWaiter();
+    }
+    
+    return YES;
+}
+
+- (BOOL)prefetchInsert:(PushPrefetch *)prefetch messageId:(NSString *)messageId {
+    PushPrefetch    *existing   = nil;
+    BOOL            missing     = NO;
+    @synchronized (_prefetches) {
+        existing = _prefetches[messageId];
+        if (!existing) {
+            _prefetches[messageId] = prefetch;
+            [_prefetchOrder addObject:messageId];
+            [self prefetchEvict];
+            return YES;
+        }
+        
+        // Message is no longer on server. Existing entry must keep it from now on.
+        existing.pinned |= prefetch.pinned;
+        missing         = prefetch.pinned && !existing.response.oobIncomingMessage;
+    }
+    
+    // Same message came by long poll while push prefetch was on the way or found nothing on server.
+    if (missing && ![self prefetch:existing finishWithResponse:prefetch.response error:nil manager:prefetch.manager]) {
+        @synchronized (_prefetches) {
+            existing.manager    = prefetch.manager;
+            existing.response   = prefetch.response;
+            existing.error      = nil;
+        }
+    }
+    
+    return NO;
+}
+
+- (void)prefetchEvict {
+    // Must be called from synchronized block. Oldest messages are least likely to be opened.
+    // Long polled ones are not on server any more. They are kept as long as inbox can keep their ids.
+    NSUInteger pinned   = 0;
+    NSUInteger unpinned = 0;
+    for (NSString *loopMessageId in [[_prefetchOrder reverseObjectEnumerator] allObjects]) {
+        PushPrefetch    *loopPrefetch   = _prefetches[loopMessageId];
+        NSUInteger      count           = loopPrefetch.pinned ? ++pinned : ++unpinned;
+        if (count > (loopPrefetch.pinned ? kInboxCapacity : kPrefetchCapacity)) {
+            [self prefetchDiscard:loopPrefetch];
+            [_prefetches removeObjectForKey:loopMessageId];
+            [_prefetchOrder removeObject:loopMessageId];
+        }
+    }
+}
+
+- (void)prefetchParse:(id<EMOobFetchMessageResponse>)response {
+    id<EMOobIncomingMessage> message = response.resultCode == EMOobResultCodeSuccess ? response.oobIncomingMessage : nil;
+    if (![message.messageType isEqualToString:EMOobIncomingMessageTypeTransactionSigning]) {
+        return;
+    }
+    
+    id<EMMspData> data = [self mspDataWithRequest:(id<EMOobTransactionSigningRequest>)message error:nil];
+    if (data) {
+        @synchronized (_parsedData) {
+            [_parsedData setObject:data forKey:message];
+        }
+    }
+}
+
+- (PushPrefetch *)prefetchTake:(NSString *)messageId {
+    @synchronized (_prefetches) {
+        PushPrefetch *retValue = _prefetches[messageId];
+        [_prefetches removeObjectForKey:messageId];
+        [_prefetchOrder removeObject:messageId];
+        return retValue;
+    }
+}
+
+- (void)prefetch:(PushPrefetch *)prefetch notify:(dispatch_block_t)block {
+    @synchronized (_prefetches) {
+        if (!prefetch.finished) {
+            [prefetch.waiters addObject:block];
+            return;
+        }
+    }
+    block();
+}
+
+- (void)prefetchDiscard:(PushPrefetch *)prefetch {
+    // Must be called from synchronized block. Do not keep server challenge of messages nobody will display.
+    id<EMOobIncomingMessage> message = prefetch.response.oobIncomingMessage;
+    @synchronized (_parsedData) {
+        id<EMMspData> data = [_parsedData objectForKey:message];
+        if (data.baseAlgo == EM_MSP_BASE_ALGO_OATH) {
+            [((id<EMMspOathData>)data).ocraServerChallenge.value wipe];
+        }
+        [_parsedData removeObjectForKey:message];
+    }
+}
+
+- (void)prefetchDiscardClientId:(NSString *)clientId {
+    @synchronized (_prefetches) {
+        for (NSString *loopMessageId in [_prefetchOrder copy]) {
+            PushPrefetch *loopPrefetch = _prefetches[loopMessageId];
+            if ([loopPrefetch.clientId isEqualToString:clientId]) {
+                [self prefetchDiscard:loopPrefetch];
+                [_prefetches removeObjectForKey:loopMessageId];
+                [_prefetchOrder removeObject:loopMessageId];
+            }
+        }
+    }
+}
+
+// MARK: - Long Poll
+
+- (void)setLongPollEnabled:(BOOL)longPollEnabled {
+    @synchronized (self) {
+        if (_longPollEnabled == longPollEnabled) {
+            return;
+        }
+        _longPollEnabled = longPollEnabled;
+    }
+    
+    if (longPollEnabled) {
+        [self longPollStart];
+    } else {
+        [self longPollStop];
+    }
+}
+
+- (void)longPollStart {
+    // Application state is available only on main thread.
+    if (![NSThread isMainThread]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self longPollStart];
+        });
+        return;
+    }
+    
+    // Polling makes sense only while app is active. Push notification will take care of the rest.
+    if (!_longPollEnabled || [UIApplication sharedApplication].applicationState == UIApplicationStateBackground) {
+        return;
+    }
+    
+    NSUInteger generation = 0;
+    @synchronized (self) {
+        generation          = ++_longPollGeneration;
+        _longPollTimeout    = kLongPollMinTimeout;
+        _longPollFailures   = 0;
+    }
+    [self longPollNext:generation];
+}
+
+- (void)longPollStop {
+    // Running request will finish, but loop will not continue.
+    @synchronized (self) {
+        _longPollGeneration++;
+    }
+}
+
+- (void)longPollNext:(NSUInteger)generation {
+    NSInteger timeout = 0;
+    @synchronized (self) {
+        if (generation != _longPollGeneration) {
+            return;
+        }
+        timeout = _longPollTimeout;
+    }
+    
+    // Nothing to poll without registered client id. Check again later.
+    NSArray<NSString *> *clientIds = self.clientIds.allValues;
+    if (!clientIds.count) {
+        [self longPollNext:generation after:kLongPollMaxTimeout];
+        return;
+    }
+    
+    // Every registered client is polled in parallel. Next round starts once all of them return.
+    dispatch_group_t    group       = dispatch_group_create();
+    __block BOOL        failed      = NO;
+    __block BOOL        delivered   = NO;
+    for (NSString *loopClientId in clientIds) {
+        id<EMOobMessageManager> manager = [self messageManagerWithClientId:loopClientId];
+        dispatch_group_enter(group);
+        [manager fetchWithTimeout:timeout completionHandler:^(id<EMOobFetchMessageResponse> aResponse, NSError *anError) {
+            BOOL success = !anError && aResponse.resultCode == EMOobResultCodeSuccess;
+            
+            // Message is already removed from server. Deliver it even if loop was stopped meanwhile.
+            if (success && aResponse.oobIncomingMessage) {
+                [self longPollDeliver:aResponse manager:manager clientId:loopClientId];
+            }
+            
+            @synchronized (group) {
+                failed      |= !success;
+                delivered   |= success && aResponse.oobIncomingMessage;
+            }
+            dispatch_group_leave(group);
+        }];
+    }
+    
+    dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+        NSTimeInterval delay = 0;
+        @synchronized (self) {
+            if (generation != self.longPollGeneration) {
+                return;
+            }
+            
+            if (failed) {
+                // Server or network issue. Back off with full jitter, so devices do not retry all at once.
+                self.longPollFailures++;
+                delay = MIN(kLongPollMaxBackoff, pow(2.0, self.longPollFailures));
+                delay = arc4random_uniform((uint32_t)(delay * 1000.0)) / 1000.0;
+            } else if (delivered) {
+                // Activity. More messages might follow soon.
+                self.longPollFailures   = 0;
+                self.longPollTimeout    = kLongPollMinTimeout;
+            } else {
+                // Idle. Hold requests on server longer to save round-trips.
+                self.longPollFailures   = 0;
+                self.longPollTimeout    = MIN(self.longPollTimeout * 2, kLongPollMaxTimeout);
+            }
+        }
+        [self longPollNext:generation after:delay];
+    });
+}
+
+- (void)longPollNext:(NSUInteger)generation after:(NSTimeInterval)delay {
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [self longPollNext:generation];
+    });
+}
+
+- (void)longPollDeliver:(id<EMOobFetchMessageResponse>)response
+                manager:(id<EMOobMessageManager>)manager
+               clientId:(NSString *)clientId {
+    // Feed the same pipeline as push notification, only with message already downloaded.
+    NSString        *messageId  = response.oobIncomingMessage.messageId;
+    PushPrefetch    *prefetch   = [PushPrefetch new];
+    prefetch.manager    = manager;
+    prefetch.clientId   = clientId;
+    prefetch.response   = response;
+    prefetch.finished   = YES;
+    prefetch.pinned     = YES;
+    
+    [self prefetchParse:response];
+    [self prefetchInsert:prefetch messageId:messageId];
+    [self deliveryRecord:messageId longPoll:YES];
+    
+    // Long poll returns messages in bursts as well. Store and announce them together with pushes.
+    [self burstAddMessageId:messageId clientId:clientId];
+}
+
+- (void)deliveryRecord:(NSString *)messageId longPoll:(BOOL)longPoll {
+    if (!messageId) {
+        return;
+    }
+    
+    // Compare how fast each channel delivers the same message.
+    @synchronized (_deliveries) {
+        NSArray         *first  = _deliveries[messageId];
+        CFTimeInterval  now     = CACurrentMediaTime();
+        if (!first) {
+            // Message delivered only by one channel would stay here forever.
+            if (_deliveries.count >= kInboxCapacity * 2) {
+                [_deliveries removeAllObjects];
+            }
+            _deliveries[messageId] = @[@(longPoll), @(now)];
+        } else if ([first[0] boolValue] != longPoll) {
+            if (longPoll) {
+                self.deliveredFirstByPushCount++;
+            } else {
+                self.deliveredFirstByLongPollCount++;
+            }
+            self.deliveryLeadTime += now - [first[1] doubleValue];
+            [_deliveries removeObjectForKey:messageId];
+        }
+    }
+}
+
+// MARK: - Outbox
+
+- (void)outboxDrain {
+    // Only one batch at a time. Next one follows once current is finished.
+    @synchronized (_outboxSending) {
+        if (_outboxDraining) {
+            return;
+        }
+        _outboxDraining = YES;
+    }
+    
+    dispatch_group_t            group   = dispatch_group_create();
+    __block NSUInteger          failed  = 0;
+    __block NSUInteger          started = 0;
+    for (MessageOutboxEntry *loopEntry in [_outbox peekEntries:kOutboxBatchSize]) {
+        dispatch_group_enter(group);
+        BOOL began = [self outboxBegin:loopEntry.messageId completionHandler:^(BOOL delivered, NSError *error) {
+            @synchronized (group) {
+                failed += delivered ? 0 : 1;
+            }
+            dispatch_group_leave(group);
+        }];
+        
+        // Response already on the way is only waited for.
+        if (began) {
+            started++;
+            [self outboxResend:loopEntry];
+        }
+    }
+    
+    dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+        @synchronized (self.outboxSending) {
+            self.outboxDraining = NO;
+        }
+        
+        if (failed) {
+            // Server is still not reachable.
+            self.outboxFailures++;
+            [self outboxDrainLater];
+        } else if (started) {
+            // Continue with next batch if there is any.
+            self.outboxFailures = 0;
+            [self outboxDrain];
+        }
+    });
+}
+
+- (void)outboxDrainLater {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (self.outboxScheduled) {
+            return;
+        }
+        self.outboxScheduled = YES;
+        
+        NSTimeInterval delay = MIN(kOutboxMinBackoff * pow(2.0, MIN(self.outboxFailures, 16)), kOutboxMaxBackoff);
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            self.outboxScheduled = NO;
+            [self outboxDrain];
+        });
+    });
+}
+
+- (void)outboxResend:(MessageOutboxEntry *)entry {
+    // Response can be created only from original request. Server keeps it until it's answered or expired.
+    id<EMOobMessageManager> manager = [self messageManagerWithClientId:entry.clientId];
+    [manager fetchWithMessageId:entry.messageId completionHandler:^(id<EMOobFetchMessageResponse> aResponse, NSError *anError) {
+        id<EMOobIncomingMessage> message = aResponse.oobIncomingMessage;
+        
+        // Server was not reached. Try again later.
+        if (anError || aResponse.resultCode != EMOobResultCodeSuccess) {
+            [self outboxEnd:entry.messageId delivered:NO error:anError];
+            return;
+        }
+        
+        // Request was already answered or it expired, or response left the queue meanwhile. There is nothing left to deliver.
+        if (![message.messageType isEqualToString:EMOobIncomingMessageTypeTransactionSigning] ||
+            ![self.outbox containsMessageId:entry.messageId]) {
+            [self.outbox removeMessageId:entry.messageId];
+            [self outboxEnd:entry.messageId delivered:YES error:nil];
+            return;
+        }
+        
+        EMOobTransactionSigningResponseValue type = entry.otp ? EMOobTransactionSigningResponseValueAccepted : EMOobTransactionSigningResponseValueRejected;
+        id<EMOobTransactionSigningResponse> response = [(id<EMOobTransactionSigningRequest>)message createWithResponse:type
+                                                                                                                   otp:[entry.otp copy]
+                                                                                                                  meta:nil];
+        [self outboxSend:response messageId:entry.messageId manager:manager];
+    }];
+}
+
+- (void)outboxSend:(id<EMOobTransactionSigningResponse>)response
+         messageId:(NSString *)messageId
+           manager:(id<EMOobMessageManager>)manager {
+    // Caller must own the sending slot of given message id.
+    [manager sendWithMessage:response completionHandler:^(id<EMOobMessageResponse> aResponse, NSError *anError) {
+        // Any server answer is final. Sending the same response again would not change it.
+        BOOL delivered = aResponse && !anError;
+        if (delivered) {
+            [self.outbox removeMessageId:messageId];
+        }
+        [self outboxEnd:messageId delivered:delivered error:anError];
+        
+        if (!delivered) {
+            [self outboxDrainLater];
+        } else if (self.outbox.count) {
+            [self outboxDrain];
+        }
+    }];
+}
+
+- (BOOL)outboxBegin:(NSString *)messageId completionHandler:(OutboxCompletion)completionHandler {
+    // Same response must never be on the way twice. Later callers only wait for result of the first one.
+    @synchronized (_outboxSending) {
+        if (!messageId) {
+            if (completionHandler) {
+                completionHandler(NO, nil);
+            }
+            return NO;
+        }
+        
+        NSMutableArray<OutboxCompletion> *waiting = _outboxSending[messageId];
+        BOOL retValue = waiting == nil;
+        if (retValue) {
+            waiting = [NSMutableArray new];
+            _outboxSending[messageId] = waiting;
+        }
+        if (completionHandler) {
+            [waiting addObject:completionHandler];
+        }
+        
+        return retValue;
+    }
+}
+
+- (void)outboxEnd:(NSString *)messageId delivered:(BOOL)delivered error:(NSError *)error {
+    // Must be called only by owner of the sending slot.
+    NSArray<OutboxCompletion> *waiting = nil;
+    @synchronized (_outboxSending) {
+        waiting = _outboxSending[messageId];
+        [_outboxSending removeObjectForKey:messageId];
+    }
+    
+    for (OutboxCompletion loopHandler in waiting) {
+        loopHandler(delivered, error);
+    }
+}
+
 // MARK: - Private Helpers
 
-- (void)registerCurrent:(NSString *)clientId completionHandler:(GenericCompletion)completionHandler
+- (id<EMOobMessageManager>)messageManagerWithClientId:(NSString *)clientId {
+    NSString *providerId = CFG_OOB_PROVIDER_ID();
+    
+    @synchronized (_managerCache) {
+        // Managers keep their own connection and crypto state. Reuse them as long as client is registered.
+        NSString                *key        = [self managerKey:@"Message" clientId:clientId providerId:providerId];
+        id<EMOobMessageManager> retValue    = key ? _managerCache[key] : nil;
+        if (retValue) {
+            self.managerCacheHitCount++;
+            return retValue;
+        }
+        
+        retValue = [_oobManager oobMessageManagerWithClientId:clientId providerId:providerId];
+        
+        // Remember owner, so responses can be resent with the same client later.
+        if (retValue && key) {
+            [self managerCacheAdd:retValue key:key clientId:clientId];
+            [_managerClientIds setObject:clientId forKey:retValue];
+        }
+        
+        return retValue;
+    }
+}
+
+- (id<EMOobNotificationManager>)notificationManagerWithClientId:(NSString *)clientId {
+    @synchronized (_managerCache) {
+        NSString                        *key        = [self managerKey:@"Notification" clientId:clientId providerId:nil];
+        id<EMOobNotificationManager>    retValue    = key ? _managerCache[key] : nil;
+        if (retValue) {
+            self.managerCacheHitCount++;
+            return retValue;
+        }
+        
+        retValue = [_oobManager oobNotificationManagerWithClientId:clientId];
+        
+        if (retValue && key) {
+            [self managerCacheAdd:retValue key:key clientId:clientId];
+        }
+        
+        return retValue;
+    }
+}
+
+- (NSString *)messageManagerClientId:(id<EMOobMessageManager>)manager {
+    @synchronized (_managerCache) {
+        return [_managerClientIds objectForKey:manager];
+    }
+}
+
+- (void)managerCacheAdd:(id)manager key:(NSString *)key clientId:(NSString *)clientId {
+    // Must be called from synchronized block. Keys are indexed by client, so they can be removed together.
+    _managerCache[key] = manager;
+    if (!_managerKeys[clientId]) {
+        _managerKeys[clientId] = [NSMutableArray new];
+    }
+    [_managerKeys[clientId] addObject:key];
+}
+
+- (void)managerCacheRemoveClientId:(NSString *)clientId {
+    // Client is gone. Its managers must not be used any more.
+    @synchronized (_managerCache) {
+        NSArray<NSString *> *removeKeys = clientId ? _managerKeys[clientId] : nil;
+        if (removeKeys) {
+            [_managerCache removeObjectsForKeys:removeKeys];
+            [_managerKeys removeObjectForKey:clientId];
+        }
+    }
+}
+
+- (NSString *)managerKey:(NSString *)type clientId:(NSString *)clientId providerId:(NSString *)providerId {
+    // Manager without client id is not bound to anything. Such ones are not cached.
+    if (!clientId) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@\t%@\t%@", type, clientId, providerId ?: @""];
+}
+
+- (id<EMMspData>)mspDataWithRequest:(id<EMOobTransactionSigningRequest>)request error:(NSError **)error {
+    id<EMMspParser> parser  = [[[EMMspService serviceWithModule:[EMMspModule mspModule]] mspFactory] createMspParser];
+    id<EMMspFrame>  frame   = [parser parse:request.mspFrame error:error];
+    
+    return frame ? [parser parseMspData:frame error:error] : nil;
+}
+
+- (void)registerCurrent:(NSString *)tokenName completionHandler:(GenericCompletion)completionHandler
 {
     // We don't have token from app? Nothing to do without it.
     if (!_currentPushToken) {
@@ -345,47 +1174,97 @@ typedef enum : NSInteger {
     }
 
     // We don't have any client id at all.
-    if ([self clientIdStateRead] == kUnregistered) {
+    NSString *clientId = tokenName ? [self clientIdRead:tokenName] : nil;
+    if (!clientId) {
         // This will probably happen when app will get push token without any enrolled token / client id.
         [self returnSuccessToHandler:completionHandler];
         return;
     }
 
     // Last registered token is same as current one.
-    if ([[self lastRegisteredTokenRead] isEqualToString:_currentPushToken]) {
+    if ([[self lastRegisteredTokenRead:tokenName] isEqualToString:_currentPushToken]) {
         [self returnSuccessToHandler:completionHandler];
         return;
     }
 
-    // Get current Client Id or use one provided from API to safe some time.
-    if (!clientId) {
-        clientId = [self clientIdRead];
-    }
-
-    // This should not happen. If client Id is registered, we should have it.
-    assert(clientId);
-    if (!clientId) {
-        [self returnErrorToHandler:completionHandler error:TRANSLATE(@"STRING_MESSAGING_MISSING_CLIENT_ID")];
-        return;
-    }
-
     // To avoid retention in block and still work.
     NSString *currentPushToken = [_currentPushToken copy];
     
+    // Only one registration per client id at a time. Others either wait for result or follow up once it's done.
+    if ([self registrationJoinToken:currentPushToken clientId:clientId completionHandler:completionHandler]) {
+        return;
+    }
+    
     // Now we have everything to register token to OOB it self.
     [self registerOOBClientId:clientId
                     pushToken:currentPushToken
             completionHandler:^(BOOL success, NSError *error) {
                 if (success) {
-                    [self lastRegisteredTokenWrite:currentPushToken];
-                }
-                if (completionHandler) {
-                    completionHandler(success, error);
+                    [self lastRegisteredTokenWrite:currentPushToken tokenName:tokenName];
                 }
+                [self registrationFinished:clientId tokenName:tokenName success:success error:error];
             }];
     
 }
 
+- (BOOL)registrationJoinToken:(NSString *)token clientId:(NSString *)clientId completionHandler:(GenericCompletion)completionHandler {
+    @synchronized (_registrations) {
+        PushRegistration *registration = _registrations[clientId];
+        
+        // Nothing is running. Caller will start registration.
+        if (!registration) {
+            registration            = [PushRegistration new];
+            registration.pushToken  = token;
+            registration.handlers   = [NSMutableArray new];
+            if (completionHandler) {
+                [registration.handlers addObject:completionHandler];
+            }
+            _registrations[clientId] = registration;
+            return NO;
+        }
+        
+        if ([registration.pushToken isEqualToString:token]) {
+            // Same registration is already on the way. Just wait for its result.
+            if (completionHandler) {
+                [registration.handlers addObject:completionHandler];
+            }
+        } else {
+            // Token changed meanwhile. All such callers share exactly one follow-up registration with latest token.
+            if (!registration.followUpHandlers) {
+                registration.followUpHandlers = [NSMutableArray new];
+            }
+            if (completionHandler) {
+                [registration.followUpHandlers addObject:completionHandler];
+            }
+        }
+        
+        return YES;
+    }
+}
+
+- (void)registrationFinished:(NSString *)clientId tokenName:(NSString *)tokenName success:(BOOL)success error:(NSError *)error {
+    PushRegistration *registration = nil;
+    
+    @synchronized (_registrations) {
+        registration = _registrations[clientId];
+        [_registrations removeObjectForKey:clientId];
+    }
+    
+    for (GenericCompletion loopHandler in registration.handlers) {
+        loopHandler(success, error);
+    }
+    
+    // Follow up with latest values. Nothing will be sent if they were registered already.
+    NSArray *followUp = registration.followUpHandlers;
+    if (followUp) {
+        [self registerCurrent:tokenName completionHandler:^(BOOL success, NSError *error) {
+            for (GenericCompletion loopHandler in followUp) {
+                loopHandler(success, error);
+            }
+        }];
+    }
+}
+
 - (void)returnSuccessToHandler:(GenericCompletion)completionHandler {
     if (completionHandler) {
         completionHandler(YES, nil);
@@ -406,7 +1285,7 @@ typedef enum : NSInteger {
           completionHandler:(GenericCompletion)completionHandler {
     assert(clientId && token && completionHandler);
 
-    id<EMOobNotificationManager> notifyManager = [_oobManager oobNotificationManagerWithClientId:clientId];
+    id<EMOobNotificationManager> notifyManager = [self notificationManagerWithClientId:clientId];
 
     NSArray <EMOobNotificationProfile *> *arrProfiles = @[[[EMOobNotificationProfile alloc] initWithChannel:CFG_OOB_CHANNEL() endPoint:token]];
     [notifyManager setNotificationProfiles:arrProfiles completionHandler:^(id<EMOobResponse> response, NSError *error) {
@@ -419,7 +1298,7 @@ typedef enum : NSInteger {
             completionHandler:(GenericCompletion)completionHandler {
     assert(clientId && completionHandler);
     
-    id<EMOobNotificationManager> notifyManager = [_oobManager oobNotificationManagerWithClientId:clientId];
+    id<EMOobNotificationManager> notifyManager = [self notificationManagerWithClientId:clientId];
     [notifyManager clearNotificationProfilesWithCompletionHandler:^(id<EMOobResponse> response, NSError *error) {
         BOOL success = !error && response && [response resultCode] == EMOobResultCodeSuccess;
         completionHandler(success, error);
@@ -428,22 +1307,20 @@ typedef enum : NSInteger {
 }
 
 // MARK: - Storage - Message Id
+
+// Single message id slot used by older versions. Replaced by inbox, kept only for migration.
 #define kStorageLastIncomminMessageId @"LastIncomminMessageId"
 
-- (BOOL)lastMessageIdWrite:(NSString *)messageId {
-    BOOL retValue = [CMain.sharedInstance.storageFast writeString:messageId forKey:kStorageLastIncomminMessageId];
-    if (retValue) {
-        [[NSNotificationCenter defaultCenter] postNotificationName:C_NOTIFICATION_ID_INCOMING_MESSAGE object:nil];
+- (void)incomingMessageIdMigrate {
+    NSString *messageId = [self.storageFast readStringForKey:kStorageLastIncomminMessageId];
+    if (messageId) {
+        [_inbox pushMessageId:messageId clientId:nil];
+        [self.storageFast removeValueForKey:kStorageLastIncomminMessageId];
     }
-    return retValue;
 }
 
-- (NSString *)lastMessageIdRead {
-    return [CMain.sharedInstance.storageFast readStringForKey:kStorageLastIncomminMessageId];
-}
-
-- (BOOL)lastMessageIdDelete {
-    BOOL retValue = [CMain.sharedInstance.storageFast removeValueForKey:kStorageLastIncomminMessageId];
+- (BOOL)incomingMessageIdDelete:(NSString *)messageId {
+    BOOL retValue = [_inbox removeMessageId:messageId];
     if (retValue) {
         [[NSNotificationCenter defaultCenter] postNotificationName:C_NOTIFICATION_ID_INCOMING_MESSAGE object:nil];
     }
@@ -454,62 +1331,145 @@ typedef enum : NSInteger {
 #define kStorageLastProvidedTokenId @"LastProvidedTokenId"
 
 - (BOOL)lastProvidedTokenWrite:(NSString *)token {
-    return [CMain.sharedInstance.storageFast writeString:token forKey:kStorageLastProvidedTokenId];
+    return [self.storageFast writeString:token forKey:kStorageLastProvidedTokenId];
 }
 
 - (NSString *)lastProvidedTokenRead {
-    return [CMain.sharedInstance.storageFast readStringForKey:kStorageLastProvidedTokenId];
+    return [self.storageFast readStringForKey:kStorageLastProvidedTokenId];
 }
 
 - (BOOL)lastProvidedTokenDelete {
-    return [CMain.sharedInstance.storageFast removeValueForKey:kStorageLastProvidedTokenId];
+    return [self.storageFast removeValueForKey:kStorageLastProvidedTokenId];
 }
 
 // MARK: - Storage - Last Registered Token
-#define kStorageLastRegistredTokenId @"LastRegistredTokenId"
 
-- (BOOL)lastRegisteredTokenWrite:(NSString *)token {
-    return [CMain.sharedInstance.storageFast writeString:token forKey:kStorageLastRegistredTokenId];
-}
+// Stored for each token separately. See keyWithName:tokenName:
+#define kStorageLastRegistredTokenId @"LastRegistredTokenId"
 
-- (NSString *)lastRegisteredTokenRead {
-    return [CMain.sharedInstance.storageFast readStringForKey:kStorageLastRegistredTokenId];
+- (BOOL)lastRegisteredTokenWrite:(NSString *)token tokenName:(NSString *)tokenName {
+    return [self.storageFast writeString:token forKey:[self keyWithName:kStorageLastRegistredTokenId tokenName:tokenName]];
 }
 
-- (BOOL)lastRegisteredTokenDelete {
-    return [CMain.sharedInstance.storageFast removeValueForKey:kStorageLastRegistredTokenId];
+- (NSString *)lastRegisteredTokenRead:(NSString *)tokenName {
+    return [self.storageFast readStringForKey:[self keyWithName:kStorageLastRegistredTokenId tokenName:tokenName]];
 }
 
 // MARK: - Storage - Client Id
 
-// Last registered OOB ClientId.
+// Registered OOB ClientIds of all tokens. JSON object with token name as key.
+#define kStorageKeyClientIds @"ClientIds"
+
+// Single ClientId and its state stored by older versions.
 #define kStorageKeyClientId @"ClientId"
+#define kStorageKeyClientIdStat @"ClientIdState"
 
-- (BOOL)clientIdWrite:(NSString *)clientId {
-    return [CMain.sharedInstance.storageSecure writeString:clientId forKey:kStorageKeyClientId];
+- (void)adoptLegacyClientIdWithTokenName:(NSString *)tokenName {
+    // Each store is migrated with single commit and each step checks what is left to do,
+    // so interrupted migration is simply finished with the next launch.
+    if (!tokenName) {
+        return;
+    }
+    
+    // Client id first. Legacy value is removed in the same commit it's adopted with.
+    NSString *clientId = [self.storageSecure readStringForKey:kStorageKeyClientId];
+    if (clientId.length) {
+        @synchronized (_registrations) {
+            NSMutableDictionary *clientIds = [self.clientIds mutableCopy];
+            if (!clientIds[tokenName]) {
+                clientIds[tokenName] = clientId;
+            }
+            if (![self clientIdsWrite:clientIds removeKeys:@[kStorageKeyClientId]]) {
+                return;
+            }
+        }
+    }
+    
+    // Registration state can follow only once client id is safely adopted.
+    NSString *registeredToken   = [self.storageFast readStringForKey:kStorageLastRegistredTokenId];
+    NSString *registeredKey     = [self keyWithName:kStorageLastRegistredTokenId tokenName:tokenName];
+    if (registeredToken || [self.storageFast readIntegerForKey:kStorageKeyClientIdStat]) {
+        NSDictionary *values = registeredToken && ![self.storageFast readStringForKey:registeredKey] ? @{registeredKey: registeredToken} : @{};
+        [self.storageFast commitValues:values removeKeys:@[kStorageLastRegistredTokenId, kStorageKeyClientIdStat]];
+    }
 }
 
-- (NSString *)clientIdRead {
-    return [CMain.sharedInstance.storageSecure readStringForKey:kStorageKeyClientId];
+- (BOOL)clientIdWrite:(NSString *)clientId tokenName:(NSString *)tokenName {
+    // Client id can't be stored without its token. Nil client id removes the value.
+    if (!tokenName) {
+        return NO;
+    }
+    
+    @synchronized (_registrations) {
+        NSMutableDictionary *clientIds = [self.clientIds mutableCopy];
+        clientIds[tokenName] = clientId;
+        return [self clientIdsWrite:clientIds removeKeys:nil];
+    }
 }
 
-- (BOOL)clientIdDelete {
-    return [CMain.sharedInstance.storageSecure removeValueForKey:kStorageKeyClientId];
+- (NSString *)clientIdRead:(NSString *)tokenName {
+    return tokenName ? self.clientIds[tokenName] : nil;
 }
 
-// MARK: - Storage - Client Id State
-#define kStorageKeyClientIdStat @"ClientIdState"
+- (NSString *)clientIdCurrent {
+    return [self clientIdRead:CMain.sharedInstance.managerToken.tokenDevice.token.name];
+}
+
+- (BOOL)clientIdDelete:(NSString *)tokenName {
+    return [self clientIdWrite:nil tokenName:tokenName];
+}
+
+- (void)clientIdsLoad {
+    NSData          *data       = [[self.storageSecure readStringForKey:kStorageKeyClientIds] dataUsingEncoding:NSUTF8StringEncoding];
+    NSDictionary    *clientIds  = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    [self clientIdsApply:[clientIds isKindOfClass:[NSDictionary class]] ? clientIds : @{}];
+}
 
-- (BOOL)clientIdStateWrite:(ClientIdState)clientIdState {
-    return [CMain.sharedInstance.storageFast writeInteger:clientIdState forKey:kStorageKeyClientIdStat];
+- (BOOL)clientIdsWrite:(NSDictionary<NSString *, NSString *> *)clientIds removeKeys:(NSArray<NSString *> *)keys {
+    NSData  *data       = [NSJSONSerialization dataWithJSONObject:clientIds options:0 error:nil];
+    BOOL    retValue    = data && [self.storageSecure commitValues:@{kStorageKeyClientIds: [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]}
+                                                      removeKeys:keys];
+    if (retValue) {
+        [self clientIdsApply:clientIds];
+    }
+    return retValue;
+}
+
+- (void)clientIdsApply:(NSDictionary<NSString *, NSString *> *)clientIds {
+    // Push routing index. Must be updated with each change of stored client ids.
+    NSMutableDictionary *routing = [NSMutableDictionary dictionaryWithCapacity:clientIds.count];
+    [clientIds enumerateKeysAndObjectsUsingBlock:^(NSString *tokenName, NSString *clientId, BOOL *stop) {
+        routing[clientId] = tokenName;
+    }];
+    self.clientIds  = clientIds;
+    self.routing    = routing;
 }
 
-- (ClientIdState)clientIdStateRead {
-    return [CMain.sharedInstance.storageFast readIntegerForKey:kStorageKeyClientIdStat];
+// MARK: - Storage - Registration
+
+- (BOOL)registrationDelete:(NSString *)tokenName {
+    // One commit per store. Client id goes first. If it can't be removed, client stays fully working.
+    NSString *clientId = [self clientIdRead:tokenName];
+    if (![self clientIdDelete:tokenName]) {
+        return NO;
+    }
+    
+    // Pending messages of removed client are no longer relevant.
+    if (clientId) {
+        [_inbox removeClientId:clientId];
+        [_outbox removeClientId:clientId];
+        [self prefetchDiscardClientId:clientId];
+        [self managerCacheRemoveClientId:clientId];
+    }
+    [[NSNotificationCenter defaultCenter] postNotificationName:C_NOTIFICATION_ID_INCOMING_MESSAGE object:nil];
+    
+    // Registered push token left behind alone is ignored without client id and overwritten by next registration.
+    return [self.storageFast commitValues:nil removeKeys:@[[self keyWithName:kStorageLastRegistredTokenId tokenName:tokenName]]];
 }
 
-- (BOOL)clientIdStateDelete {
-    return [CMain.sharedInstance.storageFast removeValueForKey:kStorageKeyClientIdStat];
+- (NSString *)keyWithName:(NSString *)name tokenName:(NSString *)tokenName {
+    // Values related to one token are stored under token specific keys.
+    return [NSString stringWithFormat:@"%@.%@", name, tokenName];
 }
 
 - (NSData *)dataFromHexString:(NSString *) string {
@@ -29,4 +29,35 @@
  */
 @interface SecureStorage : NSObject <StorageProtocol>
 
+/**
+ Create storage on top of sample app property storage.
+
+ @return New instance
+ */
+- (instancetype)init;
+
+/**
+ Create storage on top of property storage with given identifier. Useful for scratch data, which must not mix with app values.
+
+ @param identifier Identifier of property storage.
+ @return New instance
+ */
+- (instancetype)initWithIdentifier:(NSString *)identifier;
+
+/**
+ Create storage on top of property storage provided by given manager. Useful for tests with in-memory storage.
+
+ @param identifier Identifier of property storage.
+ @param manager Manager providing property storage.
+ @return New instance
+ */
+- (instancetype)initWithIdentifier:(NSString *)identifier manager:(id<EMSecureStorageManager>)manager NS_DESIGNATED_INITIALIZER;
+
+/**
+ Close and delete whole underlying property storage including all values.
+
+ @return YES if storage was deleted.
+ */
+- (BOOL)removeStorage;
+
 @end
@@ -27,9 +27,22 @@
 
 #define kSampleStorage @"SampleStorage"
 
+// Opened storage is kept for this time after last access.
+#define kIdleCloseDelay 5.0
+
+// Batch of changes is first stored as single value. Storing it is the commit point of the whole batch.
+#define kJournalKey     @"SecureStorageJournal"
+#define kJournalValues  @"values"
+#define kJournalRemove  @"remove"
+
 @interface SecureStorage()
 
-@property (nonatomic, strong) id<EMSecureStorageManager> manager;
+@property (nonatomic, strong) id<EMSecureStorageManager>    manager;
+@property (nonatomic, copy)   NSString                      *identifier;
+@property (nonatomic, strong) id<EMPropertyStorage>         storage;
+@property (nonatomic, strong) dispatch_source_t             idleTimer;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSData *> *keys;
+@property (nonatomic, strong) NSDictionary                  *journal;
 
 @end
 
@@ -37,78 +50,227 @@
 
 // MARK: - Life Cycle
 
-- (id)init {
+- (instancetype)init {
+    return [self initWithIdentifier:kSampleStorage];
+}
+
+- (instancetype)initWithIdentifier:(NSString *)identifier {
+    return [self initWithIdentifier:identifier manager:[[EMSecureStorageModule secureStorageModule] secureStorageManager]];
+}
+
+- (instancetype)initWithIdentifier:(NSString *)identifier manager:(id<EMSecureStorageManager>)manager {
     if (self = [super init]) {
-        self.manager = [[EMSecureStorageModule secureStorageModule] secureStorageManager];
+        self.manager    = manager;
+        self.identifier = identifier;
+        self.keys       = [NSMutableDictionary new];
+        
+        // One timer for the whole lifetime. Each access only moves its fire time.
+        __weak __typeof(self) weakSelf = self;
+        self.idleTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+        dispatch_source_set_timer(_idleTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_source_set_event_handler(_idleTimer, ^{
+            [weakSelf flush];
+        });
+        dispatch_resume(_idleTimer);
+        
+        // Do not leave storage opened while app is in background.
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(flush)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
     }
     
     return self;
 }
 
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    dispatch_source_cancel(_idleTimer);
+    [self flush];
+}
+
+// MARK: - Public API
+
+- (BOOL)removeStorage {
+    @synchronized (self) {
+        NSError *internalError = nil;
+        [self flush];
+        return [_manager deletePropertyStorageWithIdentifier:_identifier error:&internalError];
+    }
+}
+
 // MARK: - StorageProtocol
 
+- (void)flush {
+    // Storage is kept opened between calls and closed automatically after short idle time
+    // or when application goes to background.
+    @synchronized (self) {
+        NSError *internalError = nil;
+        [_storage close:&internalError];
+        _storage = nil;
+        _journal = nil;
+    }
+}
+
 - (BOOL)writeString:(NSString *)value forKey:(NSString *)key {
-    BOOL                    retValue    = NO;
-    NSError                 *error      = nil;
-    id<EMPropertyStorage>   storage     = [self getAndOpenStorage:&error];
+    return [self setProperty:[value secureString] forKey:key wipeValue:YES];
+}
+
+- (BOOL)writeInteger:(NSInteger)value forKey:(NSString *)key {
+    return [self writeInt64:value forKey:key];
+}
+
+- (BOOL)writeInt64:(int64_t)value forKey:(NSString *)key {
+    NSData *convertedValue = [NSData dataWithBytes:&value length:sizeof(int64_t)];
+    return [self setProperty:[convertedValue secureByteArray:YES] forKey:key wipeValue:YES];
+}
+
+- (BOOL)writeBool:(BOOL)value forKey:(NSString *)key {
+    uint8_t convertedValue = value ? 1 : 0;
+    return [self setProperty:[[NSData dataWithBytes:&convertedValue length:1] secureByteArray:YES] forKey:key wipeValue:YES];
+}
+
+- (BOOL)writeBytes:(NSData *)value forKey:(NSString *)key {
+    return [self setProperty:[value secureByteArray:NO] forKey:key wipeValue:YES];
+}
+
+- (BOOL)writeSecureBytes:(id<EMSecureByteArray>)value forKey:(NSString *)key {
+    return [self setProperty:value forKey:key wipeValue:NO];
+}
+
+- (NSString *)readStringForKey:(NSString *)key {
+    NSString                *retValue   = nil;
+    id<EMSecureByteArray>   value       = [self propertyForKey:key];
     
-    if (storage) {
-        retValue = [storage setProperty:[value secureString]
-                                 forKey:[key dataUsingEncoding:NSUTF8StringEncoding]
-                              wipeValue:YES
-                                  error:&error];
-        [storage close:&error];
+    // We want secure string instead of data.
+    if (value) {
+        retValue = [[NSString alloc] initWithData:value.dataValue encoding:NSUTF8StringEncoding];
+        [value wipe];
+    }
+
+    return retValue;
+}
+
+- (NSInteger)readIntegerForKey:(NSString *)key {
+    return (NSInteger)[self readInt64ForKey:key];
+}
+
+- (int64_t)readInt64ForKey:(NSString *)key {
+    int64_t                 retValue    = 0;
+    id<EMSecureByteArray>   value       = [self propertyForKey:key];
+    
+    // Values written by older versions are NSInteger sized. Read only what is stored.
+    if (value) {
+        NSData *data = value.dataValue;
+        [data getBytes:&retValue length:MIN(data.length, sizeof(int64_t))];
+        [value wipe];
     }
     
     return retValue;
 }
-- (BOOL)writeInteger:(NSInteger)value forKey:(NSString *)key {
+
+- (BOOL)readBoolForKey:(NSString *)key {
+    uint8_t                 retValue    = 0;
+    id<EMSecureByteArray>   value       = [self propertyForKey:key];
+    
+    if (value) {
+        [value.dataValue getBytes:&retValue length:1];
+        [value wipe];
+    }
+    
+    return retValue != 0;
+}
+
+- (NSData *)readBytesForKey:(NSString *)key {
+    NSData                  *retValue   = nil;
+    id<EMSecureByteArray>   value       = [self propertyForKey:key];
+    
+    if (value) {
+        retValue = [NSData dataWithData:value.dataValue];
+        [value wipe];
+    }
+    
+    return retValue;
+}
+
+- (id<EMSecureByteArray>)readSecureBytesForKey:(NSString *)key {
+    // Caller is responsible for wiping the value.
+    return [self propertyForKey:key];
+}
+
+- (BOOL)removeValueForKey:(NSString *)key {
     BOOL                    retValue        = NO;
     NSError                 *internalError  = nil;
-    id<EMPropertyStorage>   storage         = [self getAndOpenStorage:&internalError];
-    if (storage) {
-        NSData *convertedValue = [NSData dataWithBytes:&value length:sizeof(NSInteger)];
-        retValue = [storage setProperty:[convertedValue secureByteArray:YES]
-                                 forKey:[key dataUsingEncoding:NSUTF8StringEncoding]
-                              wipeValue:YES
-                                  error:&internalError];
-        [storage close:&internalError];
+    
+    @synchronized (self) {
+        id<EMPropertyStorage> storage = [self getAndOpenStorage:&internalError];
+        retValue = [storage removePropertyForKey:[self keyData:key] error:&internalError];
     }
     
     return retValue;
 }
 
-- (NSString *)readStringForKey:(NSString *)key {
-    NSString                *retValue       = nil;
-    id<EMSecureByteArray>   value           = nil;
+- (BOOL)commitValues:(NSDictionary<NSString *, id> *)values removeKeys:(NSArray<NSString *> *)keys {
     NSError                 *internalError  = nil;
-    id<EMPropertyStorage>   storage         = [self getAndOpenStorage:&internalError];
-    if (storage) {
-        value = [storage propertyForKey:[key dataUsingEncoding:NSUTF8StringEncoding] error:&internalError];
-        [storage close:&internalError];
+    NSDictionary            *journal        = @{kJournalValues: values ?: @{}, kJournalRemove: keys ?: @[]};
+    
+    // Unsupported value would fail in the middle of the batch. Refuse it before anything is stored.
+    for (id loopValue in values.allValues) {
+        if (![self secureValue:loopValue]) {
+            return NO;
+        }
+    }
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:journal
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:&internalError];
+    if (!data) {
+        return NO;
+    }
+    
+    @synchronized (self) {
+        // Storage with previous batch still pending is not available.
+        id<EMPropertyStorage> storage = [self getAndOpenStorage:&internalError];
+        if (!storage) {
+            return NO;
+        }
         
-        // We want secure string instead of data.
-        if (value) {
-            retValue = [[NSString alloc] initWithData:value.dataValue encoding:NSUTF8StringEncoding];
-            [value wipe];
+        // Nothing changed until journal is stored. Once it is, the whole batch is committed.
+        if (![storage setProperty:[data secureByteArray:YES] forKey:[self keyData:kJournalKey] wipeValue:YES error:&internalError]) {
+            return NO;
         }
+        
+        // Failure here leaves the journal in place. It's replayed before any other access to the storage.
+        _journal = journal;
+        [self applyJournal:storage error:&internalError];
     }
+    
+    return YES;
+}
+
+// MARK: - Private Helpers
 
+- (NSData *)keyData:(NSString *)key {
+    // Keys are mostly compile time constants. Encode each of them only once.
+    // Must be called from synchronized block.
+    NSData *retValue = _keys[key];
+    if (!retValue) {
+        retValue = [key dataUsingEncoding:NSUTF8StringEncoding];
+        _keys[key] = retValue;
+    }
+    
     return retValue;
 }
 
-- (NSInteger)readIntegerForKey:(NSString *)key {
-    NSInteger               retValue        = 0;
-    id<EMSecureByteArray>   value           = nil;
+- (BOOL)setProperty:(id<EMSecureByteArray>)value forKey:(NSString *)key wipeValue:(BOOL)wipeValue {
+    BOOL                    retValue        = NO;
     NSError                 *internalError  = nil;
-    id<EMPropertyStorage>   storage         = [self getAndOpenStorage:&internalError];
-    if (storage) {
-        value = [storage propertyForKey:[key dataUsingEncoding:NSUTF8StringEncoding] error:&internalError];
-        [storage close:&internalError];
-        
-        // We want secure string instead of data.
-        if (value) {
-            [value.dataValue getBytes:&retValue length:sizeof(NSInteger)];
+    
+    @synchronized (self) {
+        id<EMPropertyStorage> storage = [self getAndOpenStorage:&internalError];
+        if (storage) {
+            retValue = [storage setProperty:value forKey:[self keyData:key] wipeValue:wipeValue error:&internalError];
+        } else if (wipeValue) {
             [value wipe];
         }
     }
@@ -116,28 +278,115 @@
     return retValue;
 }
 
-- (BOOL)removeValueForKey:(NSString *)key {
-    BOOL                    retValue        = NO;
-    NSError                 *internalError  = nil;
-    id<EMPropertyStorage>   storage         = [self getAndOpenStorage:&internalError];
-    if (storage) {
-        retValue = [storage removePropertyForKey:[key dataUsingEncoding:NSUTF8StringEncoding] error:&internalError];
-        [storage close:&internalError];
+- (id<EMSecureByteArray>)propertyForKey:(NSString *)key {
+    NSError *internalError = nil;
+    
+    @synchronized (self) {
+        id<EMPropertyStorage> storage = [self getAndOpenStorage:&internalError];
+        return [storage propertyForKey:[self keyData:key] error:&internalError];
+    }
+}
+
+- (id<EMSecureByteArray>)secureValue:(id)value {
+    if ([value isKindOfClass:[NSString class]]) {
+        return [value secureString];
+    } else if ([value isKindOfClass:[NSNumber class]]) {
+        int64_t     integerValue    = [value longLongValue];
+        NSData      *convertedValue = [NSData dataWithBytes:&integerValue length:sizeof(int64_t)];
+        return [convertedValue secureByteArray:YES];
+    } else if ([value isKindOfClass:[NSData class]]) {
+        return [value secureByteArray:NO];
     }
     
-    return retValue;
+    return nil;
 }
 
-// MARK: - Private Helpers
+- (BOOL)removeKey:(NSData *)key storage:(id<EMPropertyStorage>)storage error:(NSError **)error {
+    // Removing value which is not there is fine. Replay might have removed it already.
+    if ([storage removePropertyForKey:key error:error]) {
+        return YES;
+    }
+    
+    id<EMSecureByteArray> value = [storage propertyForKey:key error:nil];
+    [value wipe];
+    return value == nil;
+}
 
-- (id<EMPropertyStorage>)getAndOpenStorage:(NSError **)error {
-    // Try to get common storage.
-    NSError                 *internalError  = nil;
-    id<EMPropertyStorage>   retValue        = [_manager propertyStorageWithIdentifier:kSampleStorage error:&internalError];
+- (BOOL)loadJournal:(id<EMPropertyStorage>)storage error:(NSError **)error {
+    // Must be called from synchronized block.
+    id<EMSecureByteArray> value = [storage propertyForKey:[self keyData:kJournalKey] error:nil];
+    if (value) {
+        _journal = [NSPropertyListSerialization propertyListWithData:value.dataValue
+                                                             options:NSPropertyListImmutable
+                                                              format:nil
+                                                               error:error];
+        [value wipe];
+    }
+    
+    // Unreadable journal can't be completed. Storage stays unavailable rather than half updated.
+    return !value || _journal;
+}
 
-    // Try to open given storage.
-    if (retValue && !internalError) {
-        [retValue open:&internalError];
+- (BOOL)applyJournal:(id<EMPropertyStorage>)storage error:(NSError **)error {
+    // Must be called from synchronized block. Replay is idempotent, so it's simply repeated after any failure.
+    if (!_journal) {
+        return YES;
+    }
+    
+    NSDictionary<NSString *, id> *values = _journal[kJournalValues];
+    for (NSString *loopKey in values) {
+        if (![storage setProperty:[self secureValue:values[loopKey]] forKey:[self keyData:loopKey] wipeValue:YES error:error]) {
+            return NO;
+        }
+    }
+    for (NSString *loopKey in _journal[kJournalRemove]) {
+        if (![self removeKey:[self keyData:loopKey] storage:storage error:error]) {
+            return NO;
+        }
+    }
+    if (![self removeKey:[self keyData:kJournalKey] storage:storage error:error]) {
+        return NO;
+    }
+    
+    _journal = nil;
+    return YES;
+}
+
+- (id<EMPropertyStorage>)getAndOpenStorage:(NSError **)error {
+    // Opening of encrypted storage is expensive. Keep it opened for a while and reuse it.
+    // Must be called from synchronized block.
+    NSError *internalError = nil;
+    if (!_storage) {
+        // Try to get common storage.
+        id<EMPropertyStorage> storage = [_manager propertyStorageWithIdentifier:_identifier error:&internalError];
+        
+        // Try to open given storage.
+        if (storage && !internalError) {
+            [storage open:&internalError];
+        }
+        
+        if (storage && !internalError) {
+            // Batch interrupted by crash is found on open.
+            if ([self loadJournal:storage error:&internalError]) {
+                _storage = storage;
+            } else {
+                [storage close:nil];
+            }
+        }
+    }
+    
+    // Complete committed batch before anyone can see the storage.
+    if (_storage && ![self applyJournal:_storage error:&internalError]) {
+        [self scheduleIdleClose];
+        if (error) {
+            *error = internalError;
+        }
+        return nil;
+    }
+    
+    // Postpone closing with each access.
+    if (_storage) {
+        [self scheduleIdleClose];
     }
 
     // Transfer possible error.
@@ -145,6 +394,15 @@
         *error = internalError;
     }
     
-    return retValue;
+    return _storage;
 }
+
+- (void)scheduleIdleClose {
+    // Fire once after idle delay. Later access simply postpones it again.
+    dispatch_source_set_timer(_idleTimer,
+                              dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kIdleCloseDelay * NSEC_PER_SEC)),
+                              DISPATCH_TIME_FOREVER,
+                              (uint64_t)(0.5 * NSEC_PER_SEC));
+}
+
 @end
@@ -0,0 +1,56 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+/**
+ Message subject with %key placeholders compiled into literal and placeholder segments.
+ Compiled templates are cached, so each localized subject is parsed only once.
+ */
+@interface SubjectTemplate : NSObject
+
+/**
+ Whenever template contains at least one placeholder.
+ */
+@property (nonatomic, assign, readonly) BOOL hasPlaceholders;
+
+/**
+ Get compiled template for given string. Compiled templates are cached.
+
+ @param string Localized subject with %key placeholders.
+ @return Compiled template.
+ */
++ (instancetype)templateWithString:(NSString *)string;
+
+/**
+ Replace all placeholders with given values in one pass.
+ Placeholder is everything between percent sign and next whitespace or percent sign.
+ Longest key matching start of placeholder is used, rest of it is kept. Placeholder without value is kept as it is.
+
+ @param values Values for placeholders.
+ @param replacedCount Number of replaced placeholders. Optional.
+ @return Rendered subject.
+ */
+- (NSString *)renderWithValues:(NSDictionary<NSString *, NSString *> *)values replacedCount:(NSUInteger *)replacedCount;
+
+@end
@@ -0,0 +1,152 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import "SubjectTemplate.h"
+
+#define kTemplateCacheLimit 64
+
+@interface SubjectTemplate()
+
+// Rendered as literals[0] + placeholders[0] + literals[1] + ... + literals[n].
+@property (nonatomic, strong) NSArray<NSString *>   *literals;
+@property (nonatomic, strong) NSArray<NSString *>   *placeholders;
+@property (nonatomic, assign) NSUInteger            literalsLength;
+
+@end
+
+@implementation SubjectTemplate
+
+// MARK: - Static Helpers
+
++ (instancetype)templateWithString:(NSString *)string {
+    static NSCache          *sCache = nil;
+    static dispatch_once_t  onceToken;
+    dispatch_once(&onceToken, ^{
+        sCache = [NSCache new];
+        sCache.countLimit = kTemplateCacheLimit;
+    });
+    
+    string = string ?: @"";
+    SubjectTemplate *retValue = [sCache objectForKey:string];
+    if (!retValue) {
+        retValue = [[SubjectTemplate alloc] initWithString:string];
+        [sCache setObject:retValue forKey:string];
+    }
+    
+    return retValue;
+}
+
+// MARK: - Life Cycle
+
+- (instancetype)initWithString:(NSString *)string {
+    if (self = [super init]) {
+        [self compileString:string];
+    }
+    
+    return self;
+}
+
+// MARK: - Public API
+
+- (BOOL)hasPlaceholders {
+    return _placeholders.count > 0;
+}
+
+- (NSString *)renderWithValues:(NSDictionary<NSString *, NSString *> *)values replacedCount:(NSUInteger *)replacedCount {
+    NSMutableString *retValue   = [NSMutableString stringWithCapacity:_literalsLength];
+    NSUInteger      replaced    = 0;
+    
+    [retValue appendString:_literals[0]];
+    for (NSUInteger index = 0; index < _placeholders.count; index++) {
+        NSString    *name   = _placeholders[index];
+        NSUInteger  length  = name.length;
+        
+        // Keep original behaviour of plain text replacement, where key might be only start of the name.
+        for (; length > 0; length--) {
+            NSString *value = values[length == name.length ? name : [name substringToIndex:length]];
+            if (value) {
+                [retValue appendString:value];
+                [retValue appendString:[name substringFromIndex:length]];
+                replaced++;
+                break;
+            }
+        }
+        if (!length) {
+            [retValue appendString:@"%"];
+            [retValue appendString:name];
+        }
+        
+        [retValue appendString:_literals[index + 1]];
+    }
+    
+    if (replacedCount) {
+        *replacedCount = replaced;
+    }
+    
+    return retValue;
+}
+
+// MARK: - Private Helpers
+
+- (void)compileString:(NSString *)string {
+    NSMutableArray  *literals       = [NSMutableArray new];
+    NSMutableArray  *placeholders   = [NSMutableArray new];
+    NSMutableString *literal        = [NSMutableString new];
+    NSCharacterSet  *nameEnd        = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSUInteger      position        = 0;
+    
+    while (position < string.length) {
+        NSRange marker = [string rangeOfString:@"%" options:NSLiteralSearch range:NSMakeRange(position, string.length - position)];
+        if (marker.location == NSNotFound) {
+            break;
+        }
+        
+        // Meta keys might contain any character, like dash, dot or non ASCII letters. Placeholder therefore
+        // takes everything up to whitespace or next percent sign. Actual key is matched while rendering.
+        NSUInteger end = NSMaxRange(marker);
+        while (end < string.length && [string characterAtIndex:end] != '%' && ![nameEnd characterIsMember:[string characterAtIndex:end]]) {
+            end++;
+        }
+        
+        [literal appendString:[string substringWithRange:NSMakeRange(position, marker.location - position)]];
+        if (end == NSMaxRange(marker)) {
+            // Just percent sign.
+            [literal appendString:@"%"];
+        } else {
+            [literals addObject:[literal copy]];
+            [placeholders addObject:[string substringWithRange:NSMakeRange(NSMaxRange(marker), end - NSMaxRange(marker))]];
+            [literal setString:@""];
+        }
+        position = end;
+    }
+    [literal appendString:[string substringFromIndex:position]];
+    [literals addObject:[literal copy]];
+    
+    self.literals       = literals;
+    self.placeholders   = placeholders;
+    self.literalsLength = string.length;
+}
+
+@end
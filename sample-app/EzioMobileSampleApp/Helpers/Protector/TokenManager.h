@@ -25,25 +25,57 @@
 
 #import "TokenDevice.h"
 
+extern NSString * const C_NOTIFICATION_ID_TOKEN_REMOVED;
+
 /**
  Class handling token life cycle.
+ Any number of tokens can be enrolled and selected through this class. Sample UI covers only the first one.
  */
 @interface TokenManager : NSObject
 
 /**
- Return curent enrolled token / device or nil in case we don't have one.
+ Return curent selected token / device or nil in case we don't have any.
  */
-@property (nonatomic, strong, readonly) TokenDevice *tokenDevice;
+@property (nonatomic, strong, readonly) TokenDevice                 *tokenDevice;
+
+/**
+ Names of all enrolled tokens. Tokens them self are loaded only once they are needed.
+ */
+@property (nonatomic, copy, readonly)   NSSet<NSString *>           *tokenNames;
 
-//
 /**
- Unregister from OOB and delete token from DB.
+ Return enrolled token / device with given name or nil in case we don't have such one.
+
+ @param tokenName Name of requested token
+ @return Token / device with given name
+ */
+- (TokenDevice *)tokenDeviceWithName:(NSString *)tokenName;
+
+/**
+ Make token with given name current one.
+
+ @param tokenName Name of token to be selected
+ @return YES if token does exist
+ */
+- (BOOL)selectTokenWithName:(NSString *)tokenName;
+
+/**
+ Unregister from OOB and delete current token from DB.
  Device must be online to performe such operation, because we will first try to unregister OOB.
  
  @param completionHandler Triggered once operation is finished
  */
 - (void)deleteTokenWithCompletionHandler:(GenericCompletion)completionHandler;
 
+/**
+ Unregister from OOB and delete token with given name from DB.
+ Device must be online to performe such operation, because we will first try to unregister OOB.
+
+ @param tokenName Name of token to be deleted
+ @param completionHandler Triggered once operation is finished
+ */
+- (void)deleteTokenWithName:(NSString *)tokenName completionHandler:(GenericCompletion)completionHandler;
+
 /**
  Register to OOB and provision token with given user id and registration code.
  
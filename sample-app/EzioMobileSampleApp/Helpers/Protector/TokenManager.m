@@ -25,39 +25,48 @@
 
 #import "TokenManager.h"
 
+NSString * const C_NOTIFICATION_ID_TOKEN_REMOVED = @"NotificationIdTokenRemoved";
+
 @interface TokenManager()
 
-@property (nonatomic, strong) id <EMOathTokenManager> oathManager;
+@property (nonatomic, strong) id <EMOathTokenManager>                           oathManager;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, TokenDevice *>    *tokenDevices;
 
 @end
 
 @implementation TokenManager
 
+// Name of token selected by user.
+#define kStorageKeySelectedToken @"SelectedTokenName"
+
 // MARK: - Life Cycle
 
 - (instancetype)init {
     NSError                 *error      = nil;
-    id<EMOathToken>         token       = nil;
     id <EMOathTokenManager> oathManager = [[EMOathService serviceWithModule:[EMOtpModule otpModule]] tokenManager:&error];
     
-    // Check if we have some enrolled token.
-    NSString *tokenName = oathManager ? [[oathManager tokenNames:&error] anyObject] : nil;
-    
-    // If there is no token saved, we can skip rest.
-    if (tokenName) {
-        // Try to get instance of saved token.
-        token = [oathManager tokenWithName:tokenName
-                     fingerprintCustomData:CFG_CUSTOM_FINGERPRINT_DATA()
-                                     error:&error];
-    }
+    // Check which tokens are enrolled. Tokens them self are loaded on demand, so launch does not depend on their count.
+    NSSet<NSString *> *tokenNames = oathManager ? [oathManager tokenNames:&error] : nil;
     
     // Create self only if everything is correct so far.
     if (!error && (self = [super init])) {
-        // Token might not be enrolled yet.
-        if (token) {
-            _tokenDevice = [TokenDevice tokenDeviceWithToken:token];
+        self.oathManager    = oathManager;
+        self.tokenDevices   = [NSMutableDictionary new];
+        _tokenNames         = [tokenNames copy] ?: [NSSet new];
+        
+        // Token might not be enrolled yet. Keep last selected one or any other.
+        NSString *selected = [CMain.sharedInstance.storageFast readStringForKey:kStorageKeySelectedToken];
+        if (![_tokenNames containsObject:selected]) {
+            selected = [_tokenNames anyObject];
+        }
+        if (selected) {
+            _tokenDevice = [self tokenDeviceWithName:selected];
+            
+            // Older versions did store client id without token name. It can belong only to the single enrolled one.
+            if (_tokenNames.count == 1) {
+                [CMain.sharedInstance.managerPush adoptLegacyClientIdWithTokenName:selected];
+            }
         }
-        self.oathManager = oathManager;
     }
     
     // Error in such case mean, that we have broken configuration or some internal state of SDK.
@@ -69,19 +78,58 @@
 
 // MARK: - Public API
 
+- (TokenDevice *)tokenDeviceWithName:(NSString *)tokenName {
+    if (!tokenName) {
+        return nil;
+    }
+    
+    @synchronized (_tokenDevices) {
+        TokenDevice *retValue = _tokenDevices[tokenName];
+        if (!retValue && [_tokenNames containsObject:tokenName]) {
+            // Try to get instance of saved token.
+            NSError         *error  = nil;
+            id<EMOathToken> token   = [_oathManager tokenWithName:tokenName
+                                            fingerprintCustomData:CFG_CUSTOM_FINGERPRINT_DATA()
+                                                            error:&error];
+            if (token) {
+                retValue                    = [TokenDevice tokenDeviceWithToken:token];
+                _tokenDevices[tokenName]    = retValue;
+            }
+        }
+        
+        return retValue;
+    }
+}
+
+- (BOOL)selectTokenWithName:(NSString *)tokenName {
+    TokenDevice *tokenDevice = [self tokenDeviceWithName:tokenName];
+    if (tokenDevice) {
+        _tokenDevice = tokenDevice;
+        [CMain.sharedInstance.storageFast writeString:tokenName forKey:kStorageKeySelectedToken];
+    }
+    
+    return tokenDevice != nil;
+}
+
 - (void)deleteTokenWithCompletionHandler:(GenericCompletion)completionHandler {
+    [self deleteTokenWithName:_tokenDevice.token.name completionHandler:completionHandler];
+}
+
+- (void)deleteTokenWithName:(NSString *)tokenName completionHandler:(GenericCompletion)completionHandler {
     // First we should unregister from oob and then delete token it self.
-    [CMain.sharedInstance.managerPush unregisterOOBWithCompletionHandler:^(BOOL success, NSError *error) {
+    [CMain.sharedInstance.managerPush unregisterOOBWithTokenName:tokenName completionHandler:^(BOOL success, NSError *error) {
         BOOL removed = NO;
         
         // In case of successful unregistering, we can try to delete token it self.
         if (success) {
-            removed = [self.oathManager removeToken:self.tokenDevice.token error:&error];
+            TokenDevice *tokenDevice = [self tokenDeviceWithName:tokenName];
+            removed = tokenDevice && [self.oathManager removeToken:tokenDevice.token error:&error];
         }
         
         // Remove stored reference
         if (removed) {
-            self->_tokenDevice = nil;
+            [self tokenDeviceRemove:tokenName];
+            [[NSNotificationCenter defaultCenter] postNotificationName:C_NOTIFICATION_ID_TOKEN_REMOVED object:tokenName];
         }
         
         // Notify listener.
@@ -154,10 +202,10 @@
                         extendedCompletionHandler:^(id<EMOathToken> token, NSDictionary *extensions, NSError *error) {
                             // Save client id only in case of successful registration.
                             if (token && !error) {
-                                [CMain.sharedInstance.managerPush registerClientId:clientId completionHandler:nil];
+                                [CMain.sharedInstance.managerPush registerClientId:clientId tokenName:token.name completionHandler:nil];
                                 
-                                // Store current token.
-                                self->_tokenDevice = [TokenDevice tokenDeviceWithToken:token];
+                                // Store new token and make it current one.
+                                [self tokenDeviceAdd:[TokenDevice tokenDeviceWithToken:token]];
                             }
                             
                             // Notify in UI thread.
@@ -177,4 +225,30 @@
     }
 }
 
+- (void)tokenDeviceAdd:(TokenDevice *)tokenDevice {
+    NSString *tokenName = tokenDevice.token.name;
+    @synchronized (_tokenDevices) {
+        _tokenDevices[tokenName]    = tokenDevice;
+        _tokenNames                 = [_tokenNames setByAddingObject:tokenName];
+    }
+    [self selectTokenWithName:tokenName];
+}
+
+- (void)tokenDeviceRemove:(NSString *)tokenName {
+    @synchronized (_tokenDevices) {
+        NSMutableSet *tokenNames = [_tokenNames mutableCopy];
+        [tokenNames removeObject:tokenName];
+        [_tokenDevices removeObjectForKey:tokenName];
+        _tokenNames = tokenNames;
+    }
+    
+    // Removed token was current one. Select any other remaining.
+    if ([_tokenDevice.token.name isEqualToString:tokenName]) {
+        _tokenDevice = nil;
+        if (![self selectTokenWithName:[_tokenNames anyObject]]) {
+            [CMain.sharedInstance.storageFast removeValueForKey:kStorageKeySelectedToken];
+        }
+    }
+}
+
 @end
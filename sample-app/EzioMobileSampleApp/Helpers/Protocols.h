@@ -91,6 +91,75 @@ typedef void (^OTPCompletion)(id<EMSecureString> otp, id<EMAuthInput> input, id<
  */
 - (NSInteger)readIntegerForKey:(NSString *)key;
 
+/**
+ Write 64 bit integer to storage. It will override existing key.
+
+ @param value Value we want to store.
+ @param key Key of value to be stored.
+ @return YES if storing was successful.
+ */
+- (BOOL)writeInt64:(int64_t)value forKey:(NSString *)key;
+
+/**
+ Get stored 64 bit integer value. Return 0 if given key does not exists.
+
+ @param key Key of stored value.
+ @return Stored value.
+ */
+- (int64_t)readInt64ForKey:(NSString *)key;
+
+/**
+ Write bool to storage. It will override existing key.
+
+ @param value Value we want to store.
+ @param key Key of value to be stored.
+ @return YES if storing was successful.
+ */
+- (BOOL)writeBool:(BOOL)value forKey:(NSString *)key;
+
+/**
+ Get stored bool value. Return NO if given key does not exists.
+
+ @param key Key of stored value.
+ @return Stored value.
+ */
+- (BOOL)readBoolForKey:(NSString *)key;
+
+/**
+ Write raw data to storage without any conversion. It will override existing key.
+
+ @param value Value we want to store.
+ @param key Key of value to be stored.
+ @return YES if storing was successful.
+ */
+- (BOOL)writeBytes:(NSData *)value forKey:(NSString *)key;
+
+/**
+ Get stored raw data. Return nil if given key does not exists.
+
+ @param key Key of stored value.
+ @return Stored value.
+ */
+- (NSData *)readBytesForKey:(NSString *)key;
+
+/**
+ Write secure byte array to storage. Value is not wiped, caller is still responsible for it.
+
+ @param value Value we want to store.
+ @param key Key of value to be stored.
+ @return YES if storing was successful.
+ */
+- (BOOL)writeSecureBytes:(id<EMSecureByteArray>)value forKey:(NSString *)key;
+
+/**
+ Get stored value as secure byte array. Return nil if given key does not exists.
+ Caller is responsible for wiping returned value.
+
+ @param key Key of stored value.
+ @return Stored value.
+ */
+- (id<EMSecureByteArray>)readSecureBytesForKey:(NSString *)key;
+
 /**
  Remove existing value from storage.
 
@@ -99,6 +168,22 @@ typedef void (^OTPCompletion)(id<EMSecureString> otp, id<EMAuthInput> input, id<
  */
 - (BOOL)removeValueForKey:(NSString *)key;
 
+/**
+ Write and remove multiple values at once. Either all changes are stored or none of them.
+ Storage may finish applying committed changes later, but before any other value is read or written.
+
+ @param values Values we want to store. Supported types are NSString, NSNumber stored as integer and NSData.
+ @param keys Keys of values to be removed.
+ @return YES if all changes were committed, NO if none of them was.
+ */
+- (BOOL)commitValues:(NSDictionary<NSString *, id> *)values removeKeys:(NSArray<NSString *> *)keys;
+
+/**
+ Storage might postpone persisting or keep resources opened to save time.
+ Calling this method will persist all pending changes and release resources right away.
+ */
+- (void)flush;
+
 @end
 
 
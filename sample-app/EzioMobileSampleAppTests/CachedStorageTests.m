@@ -0,0 +1,124 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "CachedStorage.h"
+#import "UserDefaults.h"
+
+#define kTestSuite  @"CachedStorageTests"
+#define kTestReads  100
+
+@interface CachedStorageTests : XCTestCase
+
+@property (nonatomic, strong) UserDefaults  *storage;
+@property (nonatomic, strong) CachedStorage *cache;
+
+@end
+
+@implementation CachedStorageTests
+
+// MARK: - Life Cycle
+
+- (void)setUp {
+    [super setUp];
+    
+    self.storage    = [[UserDefaults alloc] initWithSuiteName:kTestSuite];
+    [_storage removeSuite];
+    self.cache      = [[CachedStorage alloc] initWithStorage:_storage];
+}
+
+- (void)tearDown {
+    self.cache = nil;
+    [_storage removeSuite];
+    self.storage = nil;
+    
+    [super tearDown];
+}
+
+// MARK: - Tests
+
+- (void)testWriteThrough {
+    NSData *bytes = [@"bytes" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertTrue([_cache writeString:@"value" forKey:@"String"]);
+    XCTAssertTrue([_cache writeInt64:42 forKey:@"Integer"]);
+    XCTAssertTrue([_cache writeBytes:bytes forKey:@"Bytes"]);
+    XCTAssertTrue([_cache commitValues:@{@"Batch": @"batch"} removeKeys:@[@"Integer"]]);
+    
+    // Underlying storage has every write right away.
+    XCTAssertEqualObjects([_storage readStringForKey:@"String"], @"value");
+    XCTAssertEqualObjects([_storage readBytesForKey:@"Bytes"], bytes);
+    XCTAssertEqualObjects([_storage readStringForKey:@"Batch"], @"batch");
+    XCTAssertEqual([_storage readInt64ForKey:@"Integer"], 0);
+    
+    // Written values are served from memory without asking underlying storage.
+    XCTAssertEqualObjects([_cache readStringForKey:@"String"], @"value");
+    XCTAssertEqualObjects([_cache readBytesForKey:@"Bytes"], bytes);
+    XCTAssertEqualObjects([_cache readStringForKey:@"Batch"], @"batch");
+    XCTAssertEqual([_cache readInt64ForKey:@"Integer"], 0);
+    XCTAssertEqual(_cache.hitCount, 4);
+    XCTAssertEqual(_cache.missCount, 0);
+}
+
+- (void)testHitRate {
+    [_storage writeString:@"value" forKey:@"String"];
+    [_storage writeBytes:[@"bytes" dataUsingEncoding:NSUTF8StringEncoding] forKey:@"Bytes"];
+    
+    // Only the first read of each key, including missing one, goes to underlying storage.
+    for (NSInteger loopIndex = 0; loopIndex < kTestReads; loopIndex++) {
+        XCTAssertEqualObjects([_cache readStringForKey:@"String"], @"value");
+        XCTAssertNotNil([_cache readBytesForKey:@"Bytes"]);
+        XCTAssertNil([_cache readStringForKey:@"Missing"]);
+    }
+    XCTAssertEqual(_cache.missCount, 3);
+    XCTAssertEqual(_cache.hitCount, kTestReads * 3 - 3);
+    
+    // Invalidated value is read again.
+    [_cache invalidateKey:@"String"];
+    [_cache readStringForKey:@"String"];
+    XCTAssertEqual(_cache.missCount, 4);
+}
+
+- (void)testSecureBytes {
+    id<EMSecureByteArray> value = [[@"secret" dataUsingEncoding:NSUTF8StringEncoding] secureByteArray:NO];
+    XCTAssertTrue([_cache writeSecureBytes:value forKey:@"Secure"]);
+    [value wipe];
+    
+    // Caller wipes what it got. Cached value must survive both that and wipe of the written value.
+    id<EMSecureByteArray> first = [_cache readSecureBytesForKey:@"Secure"];
+    XCTAssertEqualObjects([[NSString alloc] initWithData:first.dataValue encoding:NSUTF8StringEncoding], @"secret");
+    [first wipe];
+    
+    id<EMSecureByteArray> second = [_cache readSecureBytesForKey:@"Secure"];
+    XCTAssertEqualObjects([[NSString alloc] initWithData:second.dataValue encoding:NSUTF8StringEncoding], @"secret");
+    [second wipe];
+    
+    XCTAssertEqual(_cache.hitCount, 2);
+    XCTAssertEqual(_cache.missCount, 0);
+}
+
+@end
@@ -0,0 +1,402 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "HttpManager.h"
+#import "HttpStubProtocol.h"
+
+// Batches sent in each measured round of throughput test.
+#define kBatchRounds 20
+
+// Bodies encoded in each measured round of encoding benchmark.
+#define kBodyRounds 10000
+
+// Timing ring buffer keeps this many most recent samples. Test sends more to wrap it around.
+#define kTimingCapacity 256
+#define kTimingRequests 300
+
+// Retry classification and backoff are private. Expose them for tests only.
+@interface HttpManager (Tests)
+
+- (BOOL)isRetryable:(NSURLResponse *)response error:(NSError *)error;
++ (NSTimeInterval)retryDelayCapForAttempt:(NSUInteger)attempt;
+- (NSData *)authBodyWithOtp:(NSString *)otp;
+- (NSData *)signBodyWithOtp:(NSString *)otp amount:(NSString *)amount beneficiary:(NSString *)beneficiary;
+
+@end
+
+@interface HttpManagerTests : XCTestCase
+
+@property (nonatomic, strong) HttpManager *manager;
+
+@end
+
+@implementation HttpManagerTests
+
+// MARK: - Private Helpers
+
+- (NSArray<HttpSignItem *> *)signItems:(NSUInteger)count round:(NSUInteger)round {
+    NSMutableArray<HttpSignItem *> *retValue = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger index = 0; index < count; index++) {
+        [retValue addObject:[HttpSignItem itemWithOtp:[NSString stringWithFormat:@"%08lu", (unsigned long)(round * count + index)]
+                                               amount:@"10.00"
+                                          beneficiary:@"Beneficiary"]];
+    }
+    
+    return retValue;
+}
+
+- (NSArray<HttpResult *> *)sendSignRequests:(NSArray<HttpSignItem *> *)items {
+    __block NSArray<HttpResult *>   *retValue   = nil;
+    XCTestExpectation               *done       = [self expectationWithDescription:@"Batch answered."];
+    [_manager sendSignRequests:items completionHandler:^(NSArray<HttpResult *> *results) {
+        retValue = results;
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    
+    return retValue;
+}
+
+- (void)measureBatchSize:(NSUInteger)size {
+    // Stand-in server accepts every transaction of the batch.
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        NSDictionary    *json   = [NSJSONSerialization JSONObjectWithData:body options:0 error:nil];
+        NSMutableArray  *items  = [NSMutableArray new];
+        for (NSUInteger index = 0; index < [json[@"input"][@"transactions"] count]; index++) {
+            [items addObject:@{@"code": @"Signature verification succeeded", @"message": @"OK"}];
+        }
+        return [NSJSONSerialization dataWithJSONObject:@{@"state": @{@"result": @{@"code": @"0", @"items": items}}} options:0 error:nil];
+    }];
+    
+    __block NSUInteger round = 0;
+    [self measureBlock:^{
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        for (NSUInteger loopRound = 0; loopRound < kBatchRounds; loopRound++, round++) {
+            NSArray<HttpResult *> *results = [self sendSignRequests:[self signItems:size round:round]];
+            XCTAssertEqual(results.count, size);
+            XCTAssertTrue([[results valueForKeyPath:@"@min.success"] boolValue]);
+        }
+        NSLog(@"Batch size %lu: %.0f items/s", (unsigned long)size, kBatchRounds * size / (CFAbsoluteTimeGetCurrent() - start));
+    }];
+}
+
+- (NSData *)legacyBodyWithOtp:(NSString *)otp {
+    // Body encoding replaced by templates. Kept as baseline of encoding benchmark.
+    NSDictionary    *json   = @{@"name": @"Auth_OTP", @"input": @{@"userId": _manager.userId, @"otp": otp}};
+    NSData          *data   = [NSJSONSerialization dataWithJSONObject:json options:0 error:nil];
+    NSString        *string = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+    string = [string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    string = [string stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]];
+    return [string dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (NSDictionary *)timingReport {
+    return [NSJSONSerialization JSONObjectWithData:[_manager timingReportJSON] options:0 error:nil];
+}
+
+- (void)waitForTimingCount:(NSUInteger)count endpoint:(NSString *)endpoint {
+    // Sample is stored once both completion and task metrics arrived. Metrics might come a bit later.
+    NSPredicate *stored = [NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+        return [[self timingReport][endpoint][@"count"] unsignedIntegerValue] == count;
+    }];
+    [self waitForExpectations:@[[[XCTNSPredicateExpectation alloc] initWithPredicate:stored object:nil]] timeout:5.0];
+}
+
+- (void)measureBodyEncoding:(NSData *(^)(NSString *otp))encode {
+    // Clock and memory metrics give time and bytes allocated of kBodyRounds requests.
+    [self measureWithMetrics:@[[XCTClockMetric new], [XCTMemoryMetric new]] block:^{
+        for (NSUInteger loopRound = 0; loopRound < kBodyRounds; loopRound++) {
+            @autoreleasepool {
+                XCTAssertNotNil(encode([NSString stringWithFormat:@"%08lu", (unsigned long)loopRound]));
+            }
+        }
+    }];
+}
+
+// MARK: - Life Cycle
+
+- (void)setUp {
+    [super setUp];
+    
+    self.manager = [[HttpManager alloc] initWithURL:@"https://localhost/tests"
+                                            headers:@{}
+                                      configuration:[HttpStubProtocol configuration]];
+    _manager.userId = @"tests";
+}
+
+- (void)tearDown {
+    [_manager invalidateSession];
+    self.manager = nil;
+    [HttpStubProtocol setResponder:nil];
+    
+    [super tearDown];
+}
+
+// MARK: - Tests
+
+- (void)testRetryNeverSent {
+    // Request provably never left the device. OTP could not be used yet.
+    for (NSNumber *loopCode in @[@(NSURLErrorCannotConnectToHost), @(NSURLErrorDNSLookupFailed), @(NSURLErrorCannotFindHost)]) {
+        NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:loopCode.integerValue userInfo:nil];
+        XCTAssertTrue([_manager isRetryable:nil error:error], @"Code %@ should be retried.", loopCode);
+    }
+}
+
+- (void)testNoRetryMaybeSent {
+    // Request might have reached server. Second verification of the same OTP would fail.
+    NSArray<NSNumber *> *codes = @[@(NSURLErrorTimedOut), @(NSURLErrorNetworkConnectionLost), @(NSURLErrorNotConnectedToInternet),
+                                   @(NSURLErrorSecureConnectionFailed), @(NSURLErrorBadServerResponse), @(NSURLErrorCancelled),
+                                   @(NSURLErrorUnknown)];
+    for (NSNumber *loopCode in codes) {
+        NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:loopCode.integerValue userInfo:nil];
+        XCTAssertFalse([_manager isRetryable:nil error:error], @"Code %@ must not be retried.", loopCode);
+    }
+}
+
+- (void)testNoRetryResponse {
+    // Any response means server did process the request, including server errors.
+    for (NSNumber *loopStatus in @[@200, @201, @400, @429, @500, @503]) {
+        NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:@"https://localhost/tests"]
+                                                                  statusCode:loopStatus.integerValue
+                                                                 HTTPVersion:@"HTTP/1.1"
+                                                                headerFields:nil];
+        XCTAssertFalse([_manager isRetryable:response error:nil], @"Status %@ must not be retried.", loopStatus);
+    }
+}
+
+- (void)testNoRetryOtherDomain {
+    // Same code in other domain has different meaning.
+    NSError *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:NSURLErrorCannotConnectToHost userInfo:nil];
+    XCTAssertFalse([_manager isRetryable:nil error:error]);
+    XCTAssertFalse([_manager isRetryable:nil error:nil]);
+}
+
+- (void)testRetryDelayCap {
+    // Exponential growth up to the maximum. Very high attempts must not overflow.
+    XCTAssertEqualWithAccuracy([HttpManager retryDelayCapForAttempt:0], 0.2, 1e-9);
+    XCTAssertEqualWithAccuracy([HttpManager retryDelayCapForAttempt:1], 0.4, 1e-9);
+    XCTAssertEqualWithAccuracy([HttpManager retryDelayCapForAttempt:3], 1.6, 1e-9);
+    for (NSNumber *loopAttempt in @[@4, @31, @32, @63, @64, @(NSUIntegerMax)]) {
+        XCTAssertEqualWithAccuracy([HttpManager retryDelayCapForAttempt:loopAttempt.unsignedIntegerValue], 2.0, 1e-9);
+    }
+}
+
+- (void)testRetryCount {
+    // Refused connection is retried until retry count is used up. Each attempt reaches the server stub.
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotConnectToHost userInfo:nil];
+        return nil;
+    }];
+    
+    XCTestExpectation *done = [self expectationWithDescription:@"Request failed."];
+    [_manager sendAuthRequest:@"12345678" completionHandler:^(BOOL success, NSString *message) {
+        XCTAssertFalse(success);
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual([HttpStubProtocol requestCount], _manager.maxRetryCount + 1);
+}
+
+- (void)testBatchItemVerdicts {
+    // Items carry sign verdict. Authentication success code is not a success here.
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        return [@"{\"state\":{\"result\":{\"code\":\"0\",\"message\":\"done\",\"items\":["
+                "{\"code\":\"Signature verification succeeded\",\"message\":\"a\"},"
+                "{\"code\":\"Signature verification failed\",\"message\":\"b\"},"
+                "{\"code\":\"0\",\"message\":\"c\"}]}}}" dataUsingEncoding:NSUTF8StringEncoding];
+    }];
+    
+    NSArray<HttpResult *> *results = [self sendSignRequests:[self signItems:3 round:0]];
+    XCTAssertEqual(results.count, 3);
+    XCTAssertTrue(results[0].success);
+    XCTAssertFalse(results[1].success);
+    XCTAssertFalse(results[2].success);
+    XCTAssertEqualObjects(results[1].message, @"b");
+}
+
+- (void)testBatchItemCountMismatch {
+    // Server must return verdict for each item. Otherwise whole batch fails.
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        return [@"{\"state\":{\"result\":{\"code\":\"0\",\"message\":\"short\",\"items\":["
+                "{\"code\":\"Signature verification succeeded\"}]}}}" dataUsingEncoding:NSUTF8StringEncoding];
+    }];
+    
+    NSArray<HttpResult *> *results = [self sendSignRequests:[self signItems:2 round:0]];
+    XCTAssertEqual(results.count, 2);
+    for (HttpResult *loopResult in results) {
+        XCTAssertFalse(loopResult.success);
+        XCTAssertEqualObjects(loopResult.message, @"short");
+    }
+}
+
+- (void)testAuthBody {
+    // Values are escaped, so any of them forms valid JSON with exactly the original content.
+    _manager.userId = @"user \"one\" \\ \u017elu\u0165ou\u010dk\u00fd";
+    NSData          *body   = [_manager authBodyWithOtp:@"123\n456\t\x01"];
+    NSDictionary    *json   = [NSJSONSerialization JSONObjectWithData:body options:0 error:nil];
+    XCTAssertEqualObjects(json, (@{@"name": @"Auth_OTP", @"input": @{@"userId": _manager.userId, @"otp": @"123\n456\t\x01"}}));
+    
+    // Same request as the one produced by serialization it replaced.
+    NSData *legacy = [self legacyBodyWithOtp:@"123\n456\t\x01"];
+    XCTAssertEqualObjects(json, [NSJSONSerialization JSONObjectWithData:legacy options:0 error:nil]);
+}
+
+- (void)testSignBodyOnWire {
+    __block NSData *sent = nil;
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        sent = body;
+        return [@"{\"state\":{\"result\":{\"code\":\"0\",\"message\":\"OK\"}}}" dataUsingEncoding:NSUTF8StringEncoding];
+    }];
+    
+    XCTestExpectation *done = [self expectationWithDescription:@"Request answered."];
+    [_manager sendSignRequest:@"12345678" amount:@"10.00" beneficiary:@"\"Quoted\" Ltd." completionHandler:^(BOOL success, NSString *message) {
+        XCTAssertTrue(success);
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    
+    // Server gets exactly the body encoder produced, with correct length.
+    NSDictionary *json = [NSJSONSerialization JSONObjectWithData:sent options:0 error:nil];
+    XCTAssertEqualObjects(json, (@{@"name": @"Sign_OTP", @"input": @{@"userId": @"tests", @"otp": @"12345678",
+                                   @"transactionData": @{@"amount": @"10.00", @"beneficiary": @"\"Quoted\" Ltd."}}}));
+    XCTAssertEqualObjects(sent, [_manager signBodyWithOtp:@"12345678" amount:@"10.00" beneficiary:@"\"Quoted\" Ltd."]);
+}
+
+- (void)testCoalescing {
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        return [@"{\"state\":{\"result\":{\"code\":\"0\",\"message\":\"OK\"}}}" dataUsingEncoding:NSUTF8StringEncoding];
+    }];
+    
+    // Double tap and retry of the same OTP join the first request. Different OTP goes on its own.
+    __block NSUInteger  answered    = 0;
+    XCTestExpectation   *done       = [self expectationWithDescription:@"All callers answered."];
+    done.expectedFulfillmentCount   = 4;
+    for (NSString *loopOtp in @[@"11111111", @"11111111", @"22222222", @"11111111"]) {
+        [_manager sendAuthRequest:loopOtp completionHandler:^(BOOL success, NSString *message) {
+            XCTAssertTrue(success);
+            XCTAssertEqualObjects(message, @"OK");
+            answered++;
+            [done fulfill];
+        }];
+    }
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual(answered, 4);
+    XCTAssertEqual(_manager.issuedRequestCount, 2);
+    XCTAssertEqual(_manager.coalescedRequestCount, 2);
+    XCTAssertEqual([HttpStubProtocol requestCount], 2);
+    
+    // Finished request is forgotten. Same OTP sent later is a new request.
+    XCTestExpectation *again = [self expectationWithDescription:@"Request answered."];
+    [_manager sendAuthRequest:@"11111111" completionHandler:^(BOOL success, NSString *message) {
+        [again fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual(_manager.issuedRequestCount, 3);
+    XCTAssertEqual(_manager.coalescedRequestCount, 2);
+}
+
+- (void)testTimingWrap {
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        return [@"{\"state\":{\"result\":{\"code\":\"0\",\"message\":\"OK\"}}}" dataUsingEncoding:NSUTF8StringEncoding];
+    }];
+    
+    XCTestExpectation *done = [self expectationWithDescription:@"All requests answered."];
+    done.expectedFulfillmentCount = kTimingRequests;
+    for (NSUInteger loopIndex = 0; loopIndex < kTimingRequests; loopIndex++) {
+        [_manager sendAuthRequest:[NSString stringWithFormat:@"%08lu", (unsigned long)loopIndex] completionHandler:^(BOOL success, NSString *message) {
+            [done fulfill];
+        }];
+    }
+    [self waitForExpectationsWithTimeout:10.0 handler:nil];
+    
+    // Ring buffer wrapped around. Only the most recent samples are left.
+    [self waitForTimingCount:kTimingCapacity endpoint:@"Auth_OTP"];
+    
+    // Endpoints are reported separately even though they share the buffer.
+    XCTestExpectation *answered = [self expectationWithDescription:@"Sign request answered."];
+    [_manager sendSignRequest:@"12345678" amount:@"10.00" beneficiary:@"Beneficiary" completionHandler:^(BOOL success, NSString *message) {
+        [answered fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    [self waitForTimingCount:1 endpoint:@"Sign_OTP"];
+    XCTAssertEqual([[self timingReport][@"Auth_OTP"][@"count"] unsignedIntegerValue], kTimingCapacity - 1);
+}
+
+- (void)testTimingReport {
+    [HttpStubProtocol setResponder:^NSData *(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error) {
+        return [@"{\"state\":{\"result\":{\"code\":\"0\",\"message\":\"OK\"}}}" dataUsingEncoding:NSUTF8StringEncoding];
+    }];
+    XCTAssertEqual([_manager timingPercentile:50 endpoint:HttpEndpointAuthOtp phase:HttpTimingPhaseTotal], 0, @"No samples yet.");
+    
+    XCTestExpectation *done = [self expectationWithDescription:@"All requests answered."];
+    done.expectedFulfillmentCount = 10;
+    for (NSUInteger loopIndex = 0; loopIndex < 10; loopIndex++) {
+        [_manager sendAuthRequest:[NSString stringWithFormat:@"%08lu", (unsigned long)loopIndex] completionHandler:^(BOOL success, NSString *message) {
+            [done fulfill];
+        }];
+    }
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    [self waitForTimingCount:10 endpoint:@"Auth_OTP"];
+    
+    // Every phase has all percentiles in milliseconds, in order. Total includes client side phases.
+    NSDictionary *report = [self timingReport][@"Auth_OTP"];
+    for (NSString *loopPhase in @[@"encode", @"dns", @"connect", @"tls", @"server", @"transfer", @"decode", @"total"]) {
+        NSDictionary *phase = report[loopPhase];
+        XCTAssertNotNil(phase, @"Phase %@ is missing.", loopPhase);
+        XCTAssertLessThanOrEqual([phase[@"p50"] doubleValue], [phase[@"p90"] doubleValue]);
+        XCTAssertLessThanOrEqual([phase[@"p90"] doubleValue], [phase[@"p99"] doubleValue]);
+    }
+    XCTAssertGreaterThanOrEqual([report[@"total"][@"p50"] doubleValue], [report[@"encode"][@"p50"] doubleValue]);
+    XCTAssertEqualWithAccuracy([_manager timingPercentile:99 endpoint:HttpEndpointAuthOtp phase:HttpTimingPhaseTotal] * 1000.,
+                               [report[@"total"][@"p99"] doubleValue], 1e-6);
+    XCTAssertEqualObjects([self timingReport][@"Sign_OTP"], @{});
+}
+
+- (void)testBodyEncodingLegacy {
+    [self measureBodyEncoding:^NSData *(NSString *otp) {
+        return [self legacyBodyWithOtp:otp];
+    }];
+}
+
+- (void)testBodyEncodingTemplate {
+    [self measureBodyEncoding:^NSData *(NSString *otp) {
+        return [self.manager authBodyWithOtp:otp];
+    }];
+}
+
+- (void)testBatchThroughput1 {
+    [self measureBatchSize:1];
+}
+
+- (void)testBatchThroughput10 {
+    [self measureBatchSize:10];
+}
+
+- (void)testBatchThroughput100 {
+    [self measureBatchSize:100];
+}
+
+@end
@@ -0,0 +1,49 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Stub of server answer. Returning error simulates transport failure.
+typedef NSData * _Nullable (^HttpStubResponder)(NSURLRequest *request, NSData *body, NSInteger *statusCode, NSError **error);
+
+/// Local stand-in server for HttpManager tests. Add it to protocol classes of session configuration.
+/// Requests are answered by responder on background queue. Without responder every request fails.
+@interface HttpStubProtocol : NSURLProtocol
+
+/// Session configuration routing all requests to the stub.
++ (NSURLSessionConfiguration *)configuration;
+
+/// Replace responder and clear request counter.
+/// @param responder Block answering requests.
++ (void)setResponder:(nullable HttpStubResponder)responder;
+
+/// Number of requests answered since last responder change.
++ (NSUInteger)requestCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
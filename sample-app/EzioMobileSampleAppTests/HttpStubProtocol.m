@@ -0,0 +1,120 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import "HttpStubProtocol.h"
+
+static HttpStubResponder    sResponder      = nil;
+static NSUInteger           sRequestCount   = 0;
+
+@implementation HttpStubProtocol
+
+// MARK: - Public API
+
++ (NSURLSessionConfiguration *)configuration {
+    NSURLSessionConfiguration *retValue = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    retValue.protocolClasses = @[[HttpStubProtocol class]];
+    return retValue;
+}
+
++ (void)setResponder:(HttpStubResponder)responder {
+    @synchronized (self) {
+        sResponder      = [responder copy];
+        sRequestCount   = 0;
+    }
+}
+
++ (NSUInteger)requestCount {
+    @synchronized (self) {
+        return sRequestCount;
+    }
+}
+
+// MARK: - NSURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return YES;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    HttpStubResponder responder = nil;
+    @synchronized ([HttpStubProtocol class]) {
+        responder = sResponder;
+        sRequestCount++;
+    }
+    
+    NSURLRequest    *request    = self.request;
+    NSData          *body       = [HttpStubProtocol bodyOfRequest:request];
+    NSInteger       statusCode  = 201;
+    NSError         *error      = nil;
+    NSData          *data       = responder ? responder(request, body, &statusCode, &error) : nil;
+    if (!responder) {
+        error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotConnectToHost userInfo:nil];
+    }
+    
+    if (error) {
+        [self.client URLProtocol:self didFailWithError:error];
+        return;
+    }
+    
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:request.URL
+                                                              statusCode:statusCode
+                                                             HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:@{@"Content-Type": @"application/json"}];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    if (data) {
+        [self.client URLProtocol:self didLoadData:data];
+    }
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading {
+    // Answer is delivered synchronously. Nothing to cancel.
+}
+
+// MARK: - Private Helpers
+
++ (NSData *)bodyOfRequest:(NSURLRequest *)request {
+    if (request.HTTPBody) {
+        return request.HTTPBody;
+    }
+    
+    // Session moves body to stream before it reaches protocol.
+    NSMutableData   *retValue   = [NSMutableData new];
+    NSInputStream   *stream     = request.HTTPBodyStream;
+    uint8_t         buffer[4096];
+    [stream open];
+    for (NSInteger read; (read = [stream read:buffer maxLength:sizeof(buffer)]) > 0;) {
+        [retValue appendBytes:buffer length:(NSUInteger)read];
+    }
+    [stream close];
+    
+    return retValue;
+}
+
+@end
@@ -0,0 +1,178 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "MessageInbox.h"
+#import "UserDefaults.h"
+
+#define kTestSuite      @"MessageInboxTests"
+#define kTestCapacity   4
+#define kTestLifetime   60.0
+
+@interface MessageInboxTests : XCTestCase
+
+@property (nonatomic, strong) UserDefaults *storage;
+
+@end
+
+@implementation MessageInboxTests
+
+// MARK: - Life Cycle
+
+- (void)setUp {
+    [super setUp];
+    
+    // Scratch suite, so tests never touch values of the app itself.
+    self.storage = [[UserDefaults alloc] initWithSuiteName:kTestSuite];
+    [_storage removeSuite];
+}
+
+- (void)tearDown {
+    [_storage removeSuite];
+    self.storage = nil;
+    
+    [super tearDown];
+}
+
+// MARK: - Tests
+
+- (void)testOldestFirst {
+    MessageInbox *inbox = [self inbox];
+    XCTAssertTrue([inbox pushMessageId:@"A" clientId:@"Client1"]);
+    XCTAssertTrue([inbox pushMessageId:@"B" clientId:nil]);
+    XCTAssertTrue([inbox pushMessageId:@"C" clientId:@"Client2"]);
+    XCTAssertEqual(inbox.count, 3);
+    
+    NSString *clientId = nil;
+    XCTAssertEqualObjects([inbox peekMessageId:&clientId], @"A");
+    XCTAssertEqualObjects(clientId, @"Client1");
+    XCTAssertEqualObjects([inbox peekMessageId:nil], @"A", @"Peek must not remove the id.");
+    
+    XCTAssertTrue([inbox removeMessageId:@"A"]);
+    XCTAssertEqualObjects([inbox peekMessageId:&clientId], @"B");
+    XCTAssertNil(clientId);
+    
+    // Removing from the middle keeps order of the rest.
+    XCTAssertTrue([inbox pushMessageId:@"D" clientId:nil]);
+    XCTAssertTrue([inbox removeMessageId:@"C"]);
+    XCTAssertFalse([inbox removeMessageId:@"C"]);
+    XCTAssertEqualObjects([self drain:inbox], (@[@"B", @"D"]));
+}
+
+- (void)testDuplicates {
+    MessageInbox *inbox = [self inbox];
+    XCTAssertTrue([inbox pushMessageId:@"A" clientId:nil]);
+    XCTAssertFalse([inbox pushMessageId:@"A" clientId:nil]);
+    XCTAssertFalse([inbox pushMessageId:@"A" clientId:@"Client1"]);
+    
+    // Duplicates within batch as well as already queued ones are skipped.
+    NSArray *stored = [inbox pushMessageIds:@[@"B", @"A", @"B", @"C"] clientIds:@[@"", @"", @"", @"Client1"]];
+    XCTAssertEqualObjects(stored, (@[@"B", @"C"]));
+    XCTAssertEqualObjects([inbox pushMessageIds:@[@"C", @"A"] clientIds:@[@"", @""]], @[]);
+    XCTAssertEqualObjects([self drain:inbox], (@[@"A", @"B", @"C"]));
+    
+    // Fetched id might be pushed again. It's a new message then.
+    XCTAssertTrue([inbox pushMessageId:@"A" clientId:nil]);
+}
+
+- (void)testCapacity {
+    MessageInbox *inbox = [self inbox];
+    for (NSString *loopId in @[@"A", @"B", @"C", @"D", @"E"]) {
+        XCTAssertTrue([inbox pushMessageId:loopId clientId:nil]);
+    }
+    XCTAssertEqual(inbox.count, kTestCapacity);
+    
+    // Batch bigger than capacity keeps only its newest part.
+    NSArray *stored = [inbox pushMessageIds:@[@"F", @"G", @"H", @"I", @"J", @"K"] clientIds:@[@"", @"", @"", @"", @"", @""]];
+    XCTAssertEqualObjects(stored, (@[@"H", @"I", @"J", @"K"]));
+    XCTAssertEqualObjects([self drain:inbox], (@[@"H", @"I", @"J", @"K"]));
+    
+    // Dropped id is not known any more.
+    XCTAssertTrue([inbox pushMessageId:@"A" clientId:nil]);
+}
+
+- (void)testReload {
+    MessageInbox *inbox = [self inbox];
+    [inbox pushMessageIds:@[@"A", @"B", @"C"] clientIds:@[@"Client1", @"", @"Client2"]];
+    [inbox removeMessageId:@"B"];
+    
+    // Queue survives restart in the same order and still knows queued ids.
+    inbox = [self inbox];
+    XCTAssertEqual(inbox.count, 2);
+    XCTAssertFalse([inbox pushMessageId:@"C" clientId:nil]);
+    XCTAssertTrue([inbox pushMessageId:@"D" clientId:nil]);
+    
+    NSString *clientId = nil;
+    XCTAssertEqualObjects([inbox peekMessageId:&clientId], @"A");
+    XCTAssertEqualObjects(clientId, @"Client1");
+    
+    inbox = [self inbox];
+    XCTAssertEqualObjects([self drain:inbox], (@[@"A", @"C", @"D"]));
+    XCTAssertEqual([self inbox].count, 0);
+}
+
+- (void)testRemoveClientId {
+    MessageInbox *inbox = [self inbox];
+    [inbox pushMessageIds:@[@"A", @"B", @"C", @"D"] clientIds:@[@"Client1", @"Client2", @"Client1", @""]];
+    
+    [inbox removeClientId:@"Client1"];
+    XCTAssertEqualObjects([self drain:[self inbox]], (@[@"B", @"D"]));
+    
+    inbox = [self inbox];
+    [inbox pushMessageIds:@[@"A", @"B"] clientIds:@[@"Client1", @"Client2"]];
+    [inbox removeAll];
+    XCTAssertEqual(inbox.count, 0);
+    XCTAssertEqual([self inbox].count, 0);
+}
+
+- (void)testExpiry {
+    MessageInbox *inbox = [[MessageInbox alloc] initWithStorage:_storage capacity:kTestCapacity timeToLive:0];
+    XCTAssertTrue([inbox pushMessageId:@"A" clientId:nil]);
+    XCTAssertEqual(inbox.count, 0);
+    XCTAssertNil([inbox peekMessageId:nil]);
+    
+    // Expired id is forgotten, so it can be queued again.
+    inbox = [self inbox];
+    XCTAssertTrue([inbox pushMessageId:@"A" clientId:nil]);
+    XCTAssertEqual(inbox.count, 1);
+}
+
+// MARK: - Private Helpers
+
+- (MessageInbox *)inbox {
+    return [[MessageInbox alloc] initWithStorage:_storage capacity:kTestCapacity timeToLive:kTestLifetime];
+}
+
+- (NSArray<NSString *> *)drain:(MessageInbox *)inbox {
+    NSMutableArray<NSString *> *retValue = [NSMutableArray new];
+    for (NSString *messageId = [inbox peekMessageId:nil]; messageId; messageId = [inbox peekMessageId:nil]) {
+        [retValue addObject:messageId];
+        [inbox removeMessageId:messageId];
+    }
+    
+    return retValue;
+}
+
+@end
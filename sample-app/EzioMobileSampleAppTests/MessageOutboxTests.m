@@ -0,0 +1,211 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "MessageOutbox.h"
+#import "UserDefaults.h"
+
+#define kTestSuite      @"MessageOutboxTests"
+#define kTestCapacity   3
+#define kTestLifetime   60.0
+
+// Storage layout of the outbox. Checked directly to make sure OTP never ends up in the queue value.
+#define kTestQueueKey   @"Outbox"
+#define kTestOtpKey     @"OutboxOtp%ld"
+
+@interface MessageOutboxTests : XCTestCase
+
+@property (nonatomic, strong) UserDefaults *storage;
+
+@end
+
+@implementation MessageOutboxTests
+
+// MARK: - Life Cycle
+
+- (void)setUp {
+    [super setUp];
+    
+    // Scratch suite, so tests never touch values of the app itself.
+    self.storage = [[UserDefaults alloc] initWithSuiteName:kTestSuite];
+    [_storage removeSuite];
+}
+
+- (void)tearDown {
+    [_storage removeSuite];
+    self.storage = nil;
+    
+    [super tearDown];
+}
+
+// MARK: - Tests
+
+- (void)testOldestFirst {
+    MessageOutbox *outbox = [self outbox];
+    XCTAssertTrue([outbox pushMessageId:@"A" clientId:@"Client1" otp:[@"111111" secureString]]);
+    XCTAssertTrue([outbox pushMessageId:@"B" clientId:@"Client2" otp:nil]);
+    XCTAssertTrue([outbox pushMessageId:@"C" clientId:@"Client1" otp:[@"333333" secureString]]);
+    XCTAssertEqual(outbox.count, 3);
+    
+    NSArray<MessageOutboxEntry *> *entries = [outbox peekEntries:2];
+    XCTAssertEqualObjects([self messageIds:entries], (@[@"A", @"B"]));
+    XCTAssertEqualObjects(entries[0].clientId, @"Client1");
+    XCTAssertEqualObjects(entries[0].otp.stringValue, @"111111");
+    XCTAssertNil(entries[1].otp, @"Rejected request has no OTP.");
+    
+    XCTAssertTrue([outbox containsMessageId:@"B"]);
+    XCTAssertTrue([outbox removeMessageId:@"B"]);
+    XCTAssertFalse([outbox containsMessageId:@"B"]);
+    XCTAssertFalse([outbox removeMessageId:@"B"]);
+    XCTAssertEqualObjects([self messageIds:[outbox peekEntries:10]], (@[@"A", @"C"]));
+}
+
+- (void)testSameMessageId {
+    MessageOutbox *outbox = [self outbox];
+    XCTAssertTrue([outbox pushMessageId:@"A" clientId:@"Client1" otp:[@"111111" secureString]]);
+    XCTAssertTrue([outbox pushMessageId:@"B" clientId:@"Client1" otp:nil]);
+    
+    // Latest reaction replaces the queued one. Message id is queued only once.
+    XCTAssertTrue([outbox pushMessageId:@"A" clientId:@"Client1" otp:[@"222222" secureString]]);
+    XCTAssertEqual(outbox.count, 2);
+    
+    NSArray<MessageOutboxEntry *> *entries = [outbox peekEntries:10];
+    XCTAssertEqualObjects([self messageIds:entries], (@[@"B", @"A"]));
+    XCTAssertEqualObjects(entries[1].otp.stringValue, @"222222");
+    
+    // Approve changed to reject releases the OTP.
+    XCTAssertTrue([outbox pushMessageId:@"A" clientId:@"Client1" otp:nil]);
+    XCTAssertNil([outbox peekEntries:10].lastObject.otp);
+    XCTAssertEqualObjects([self storedOtps], @[]);
+}
+
+- (void)testCapacity {
+    MessageOutbox *outbox = [self outbox];
+    for (NSString *loopId in @[@"A", @"B", @"C", @"D"]) {
+        XCTAssertTrue([outbox pushMessageId:loopId clientId:nil otp:[loopId secureString]]);
+    }
+    XCTAssertEqualObjects([self messageIds:[outbox peekEntries:10]], (@[@"B", @"C", @"D"]));
+    
+    // Slot of dropped response is reused, none is left behind.
+    XCTAssertEqualObjects([[self storedOtps] sortedArrayUsingSelector:@selector(compare:)], (@[@"B", @"C", @"D"]));
+}
+
+- (void)testReload {
+    MessageOutbox *outbox = [self outbox];
+    [outbox pushMessageId:@"A" clientId:@"Client1" otp:[@"111111" secureString]];
+    [outbox pushMessageId:@"B" clientId:@"Client2" otp:nil];
+    [outbox pushMessageId:@"C" clientId:nil otp:[@"333333" secureString]];
+    [outbox removeMessageId:@"A"];
+    
+    // Queue survives restart in the same order together with OTP values.
+    NSArray<MessageOutboxEntry *> *entries = [[self outbox] peekEntries:10];
+    XCTAssertEqualObjects([self messageIds:entries], (@[@"B", @"C"]));
+    XCTAssertEqualObjects(entries[0].clientId, @"Client2");
+    XCTAssertNil(entries[0].otp);
+    XCTAssertNil(entries[1].clientId);
+    XCTAssertEqualObjects(entries[1].otp.stringValue, @"333333");
+}
+
+- (void)testOtpStorage {
+    MessageOutbox *outbox = [self outbox];
+    [outbox pushMessageId:@"A" clientId:@"Client1" otp:[@"111111" secureString]];
+    [outbox pushMessageId:@"B" clientId:@"Client1" otp:[@"222222" secureString]];
+    
+    // OTP values are kept only as secure values of their own.
+    NSString *queue = [_storage readStringForKey:kTestQueueKey];
+    XCTAssertNotNil(queue);
+    XCTAssertFalse([queue containsString:@"111111"]);
+    XCTAssertFalse([queue containsString:@"222222"]);
+    XCTAssertEqualObjects([[self storedOtps] sortedArrayUsingSelector:@selector(compare:)], (@[@"111111", @"222222"]));
+    
+    // Delivered response takes its OTP with it.
+    [outbox removeMessageId:@"A"];
+    XCTAssertEqualObjects([self storedOtps], @[@"222222"]);
+    
+    [outbox removeAll];
+    XCTAssertEqualObjects([self storedOtps], @[]);
+    XCTAssertNil([_storage readStringForKey:kTestQueueKey]);
+}
+
+- (void)testMissingOtp {
+    MessageOutbox *outbox = [self outbox];
+    [outbox pushMessageId:@"A" clientId:nil otp:[@"111111" secureString]];
+    [outbox pushMessageId:@"B" clientId:nil otp:nil];
+    
+    // Approved response without its OTP would be delivered as rejected one. It must be dropped instead.
+    for (NSUInteger slot = 0; slot < kTestCapacity; slot++) {
+        [_storage removeValueForKey:[NSString stringWithFormat:kTestOtpKey, (long)slot]];
+    }
+    XCTAssertEqualObjects([self messageIds:[[self outbox] peekEntries:10]], @[@"B"]);
+    
+    // Leftover OTP not referenced by the queue is removed on load.
+    [_storage writeBytes:[@"999999" dataUsingEncoding:NSUTF8StringEncoding] forKey:[NSString stringWithFormat:kTestOtpKey, (long)kTestCapacity - 1]];
+    XCTAssertEqual([self outbox].count, 1);
+    XCTAssertEqualObjects([self storedOtps], @[]);
+}
+
+- (void)testRemoveClientId {
+    MessageOutbox *outbox = [self outbox];
+    [outbox pushMessageId:@"A" clientId:@"Client1" otp:[@"111111" secureString]];
+    [outbox pushMessageId:@"B" clientId:@"Client2" otp:nil];
+    [outbox pushMessageId:@"C" clientId:@"Client1" otp:nil];
+    
+    [outbox removeClientId:@"Client1"];
+    XCTAssertEqualObjects([self messageIds:[[self outbox] peekEntries:10]], @[@"B"]);
+    XCTAssertEqualObjects([self storedOtps], @[]);
+}
+
+- (void)testExpiry {
+    MessageOutbox *outbox = [[MessageOutbox alloc] initWithStorage:_storage capacity:kTestCapacity timeToLive:0];
+    XCTAssertTrue([outbox pushMessageId:@"A" clientId:nil otp:[@"111111" secureString]]);
+    XCTAssertEqual(outbox.count, 0);
+    XCTAssertFalse([outbox containsMessageId:@"A"]);
+    XCTAssertEqualObjects([self storedOtps], @[]);
+    XCTAssertEqual([self outbox].count, 0);
+}
+
+// MARK: - Private Helpers
+
+- (MessageOutbox *)outbox {
+    return [[MessageOutbox alloc] initWithStorage:_storage capacity:kTestCapacity timeToLive:kTestLifetime];
+}
+
+- (NSArray<NSString *> *)messageIds:(NSArray<MessageOutboxEntry *> *)entries {
+    return [entries valueForKey:@"messageId"];
+}
+
+- (NSArray<NSString *> *)storedOtps {
+    NSMutableArray<NSString *> *retValue = [NSMutableArray new];
+    for (NSUInteger slot = 0; slot < kTestCapacity; slot++) {
+        NSData *value = [_storage readBytesForKey:[NSString stringWithFormat:kTestOtpKey, (long)slot]];
+        if (value) {
+            [retValue addObject:[[NSString alloc] initWithData:value encoding:NSUTF8StringEncoding]];
+        }
+    }
+    
+    return retValue;
+}
+
+@end
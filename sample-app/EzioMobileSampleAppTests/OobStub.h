@@ -0,0 +1,92 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Message type without any handling in PushManager. Fetching it costs nothing but the round trip.
+extern NSString * const OobStubMessageTypePlain;
+
+/// Local stand-in OOB server for PushManager tests. Pass it as OOB manager of the push manager.
+/// Every call is answered asynchronously on main queue and counted. Fetched messages stay on server until they are answered.
+@interface OobStubManager : NSObject <EMOobManager>
+
+/// NO simulates lost connection. All calls fail with error.
+@property (atomic, assign)              BOOL            reachable;
+
+/// Delay of every answer. Stands for network round trip.
+@property (atomic, assign)              NSTimeInterval  latency;
+
+/// Delay of empty long poll answer. Stands for request held on server.
+@property (atomic, assign)              NSTimeInterval  pollDelay;
+
+/// YES keeps notification profile calls on the way until releaseProfiles is called.
+@property (atomic, assign)              BOOL            holdProfiles;
+
+/// Number of message and notification managers created.
+@property (atomic, assign, readonly)    NSUInteger      managerCount;
+
+/// Number of fetchWithMessageId round trips.
+@property (atomic, assign, readonly)    NSUInteger      fetchCount;
+
+/// Number of fetchWithTimeout round trips.
+@property (atomic, assign, readonly)    NSUInteger      pollCount;
+
+/// Number of responses sent.
+@property (atomic, assign, readonly)    NSUInteger      sendCount;
+
+/// Number of setNotificationProfiles round trips.
+@property (atomic, assign, readonly)    NSUInteger      profileCount;
+
+/// Number of clearNotificationProfiles round trips.
+@property (atomic, assign, readonly)    NSUInteger      clearCount;
+
+/// Ids of messages answered by client, in order of arrival.
+@property (atomic, copy, readonly)      NSArray<NSString *> *sentMessageIds;
+
+/// Add message waiting on server for given client.
+/// @param messageId Message id delivered to client by push.
+/// @param type Message type. Either OobStubMessageTypePlain or EMOobIncomingMessageTypeTransactionSigning.
+/// @param clientId Client id of recipient.
+- (void)addMessageId:(NSString *)messageId type:(NSString *)type clientId:(NSString *)clientId;
+
+/// Same as addMessageId:type:clientId:, but message is also returned by next long poll of the client.
+/// @param messageId Message id.
+/// @param type Message type.
+/// @param clientId Client id of recipient.
+- (void)addPolledMessageId:(NSString *)messageId type:(NSString *)type clientId:(NSString *)clientId;
+
+/// Message waiting on server, as client would get it by fetch.
+/// @param messageId Message id.
+/// @return Message or nil if there is no such message.
+- (nullable id<EMOobTransactionSigningRequest>)messageWithId:(NSString *)messageId;
+
+/// Finish all held notification profile calls successfully.
+- (void)releaseProfiles;
+
+@end
+
+NS_ASSUME_NONNULL_END
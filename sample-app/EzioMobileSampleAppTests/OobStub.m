@@ -0,0 +1,304 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import "OobStub.h"
+
+NSString * const OobStubMessageTypePlain = @"OobStubPlain";
+
+// MARK: - Messages
+
+/**
+ Message waiting on server. Signing response created from it carries only the message id.
+ */
+@interface OobStubMessage : NSObject <EMOobTransactionSigningRequest, EMOobTransactionSigningResponse>
+
+@property (nonatomic, copy)     NSString    *messageId;
+@property (nonatomic, copy)     NSString    *messageType;
+@property (nonatomic, copy)     NSString    *clientId;
+
+@end
+
+@implementation OobStubMessage
+
+- (id<EMOobTransactionSigningResponse>)createWithResponse:(EMOobTransactionSigningResponseValue)response
+                                                      otp:(id<EMSecureString>)otp
+                                                     meta:(NSDictionary *)meta {
+    OobStubMessage *retValue = [OobStubMessage new];
+    retValue.messageId  = _messageId;
+    retValue.clientId   = _clientId;
+    return retValue;
+}
+
+@end
+
+/**
+ Successful answer of any call. Fetch answers carry message if there is one.
+ */
+@interface OobStubResponse : NSObject <EMOobFetchMessageResponse, EMOobMessageResponse>
+
+@property (nonatomic, strong)   id<EMOobIncomingMessage>    oobIncomingMessage;
+
+@end
+
+@implementation OobStubResponse
+
+- (EMOobResultCode)resultCode {
+    return EMOobResultCodeSuccess;
+}
+
+@end
+
+// MARK: - Managers
+
+@interface OobStubManager()
+
+@property (atomic, assign, readwrite)   NSUInteger  managerCount;
+@property (atomic, assign, readwrite)   NSUInteger  fetchCount;
+@property (atomic, assign, readwrite)   NSUInteger  pollCount;
+@property (atomic, assign, readwrite)   NSUInteger  sendCount;
+@property (atomic, assign, readwrite)   NSUInteger  profileCount;
+@property (atomic, assign, readwrite)   NSUInteger  clearCount;
+@property (nonatomic, strong)           NSMutableArray<NSString *>                          *sent;
+@property (nonatomic, strong)           NSMutableDictionary<NSString *, OobStubMessage *>   *messages;
+@property (nonatomic, strong)           NSMutableArray<OobStubMessage *>                    *polled;
+@property (nonatomic, strong)           NSMutableArray<dispatch_block_t>                    *heldProfiles;
+
+- (void)fetchMessageId:(NSString *)messageId completionHandler:(void (^)(id<EMOobFetchMessageResponse>, NSError *))completionHandler;
+- (void)pollClientId:(NSString *)clientId completionHandler:(void (^)(id<EMOobFetchMessageResponse>, NSError *))completionHandler;
+- (void)sendMessage:(OobStubMessage *)message completionHandler:(void (^)(id<EMOobMessageResponse>, NSError *))completionHandler;
+- (void)setProfilesWithCompletionHandler:(void (^)(id<EMOobResponse>, NSError *))completionHandler;
+- (void)clearProfilesWithCompletionHandler:(void (^)(id<EMOobResponse>, NSError *))completionHandler;
+
+@end
+
+@interface OobStubMessageManager : NSObject <EMOobMessageManager>
+
+@property (nonatomic, weak)     OobStubManager  *server;
+@property (nonatomic, copy)     NSString        *clientId;
+
+@end
+
+@implementation OobStubMessageManager
+
+- (void)fetchWithMessageId:(NSString *)messageId
+         completionHandler:(void (^)(id<EMOobFetchMessageResponse>, NSError *))completionHandler {
+    [_server fetchMessageId:messageId completionHandler:completionHandler];
+}
+
+- (void)fetchWithTimeout:(NSInteger)timeout
+       completionHandler:(void (^)(id<EMOobFetchMessageResponse>, NSError *))completionHandler {
+    [_server pollClientId:_clientId completionHandler:completionHandler];
+}
+
+- (void)sendWithMessage:(id<EMOobMessage>)message
+      completionHandler:(void (^)(id<EMOobMessageResponse>, NSError *))completionHandler {
+    [_server sendMessage:(OobStubMessage *)message completionHandler:completionHandler];
+}
+
+@end
+
+@interface OobStubNotificationManager : NSObject <EMOobNotificationManager>
+
+@property (nonatomic, weak)     OobStubManager  *server;
+
+@end
+
+@implementation OobStubNotificationManager
+
+- (void)setNotificationProfiles:(NSArray<EMOobNotificationProfile *> *)profiles
+              completionHandler:(void (^)(id<EMOobResponse>, NSError *))completionHandler {
+    [_server setProfilesWithCompletionHandler:completionHandler];
+}
+
+- (void)clearNotificationProfilesWithCompletionHandler:(void (^)(id<EMOobResponse>, NSError *))completionHandler {
+    [_server clearProfilesWithCompletionHandler:completionHandler];
+}
+
+@end
+
+@implementation OobStubManager
+
+// MARK: - Life Cycle
+
+- (id)init {
+    if (self = [super init]) {
+        self.reachable      = YES;
+        self.pollDelay      = 0.05;
+        self.sent           = [NSMutableArray new];
+        self.messages       = [NSMutableDictionary new];
+        self.polled         = [NSMutableArray new];
+        self.heldProfiles   = [NSMutableArray new];
+    }
+    
+    return self;
+}
+
+// MARK: - Public API
+
+- (NSArray<NSString *> *)sentMessageIds {
+    @synchronized (self) {
+        return [_sent copy];
+    }
+}
+
+- (void)addMessageId:(NSString *)messageId type:(NSString *)type clientId:(NSString *)clientId {
+    OobStubMessage *message = [OobStubMessage new];
+    message.messageId   = messageId;
+    message.messageType = type;
+    message.clientId    = clientId;
+    
+    @synchronized (self) {
+        _messages[messageId] = message;
+    }
+}
+
+- (void)addPolledMessageId:(NSString *)messageId type:(NSString *)type clientId:(NSString *)clientId {
+    [self addMessageId:messageId type:type clientId:clientId];
+    
+    @synchronized (self) {
+        [_polled addObject:_messages[messageId]];
+    }
+}
+
+- (id<EMOobTransactionSigningRequest>)messageWithId:(NSString *)messageId {
+    @synchronized (self) {
+        return _messages[messageId];
+    }
+}
+
+- (void)releaseProfiles {
+    NSArray<dispatch_block_t> *held = nil;
+    @synchronized (self) {
+        held = [_heldProfiles copy];
+        [_heldProfiles removeAllObjects];
+    }
+    
+    for (dispatch_block_t loopBlock in held) {
+        dispatch_async(dispatch_get_main_queue(), loopBlock);
+    }
+}
+
+// MARK: - EMOobManager
+
+- (id<EMOobMessageManager>)oobMessageManagerWithClientId:(NSString *)clientId providerId:(NSString *)providerId {
+    self.managerCount++;
+    
+    OobStubMessageManager *retValue = [OobStubMessageManager new];
+    retValue.server     = self;
+    retValue.clientId   = clientId;
+    return retValue;
+}
+
+- (id<EMOobNotificationManager>)oobNotificationManagerWithClientId:(NSString *)clientId {
+    self.managerCount++;
+    
+    OobStubNotificationManager *retValue = [OobStubNotificationManager new];
+    retValue.server = self;
+    return retValue;
+}
+
+// MARK: - Server
+
+- (void)fetchMessageId:(NSString *)messageId completionHandler:(void (^)(id<EMOobFetchMessageResponse>, NSError *))completionHandler {
+    @synchronized (self) {
+        _fetchCount++;
+    }
+    
+    // Message is looked up once request reaches server. It might be taken by long poll meanwhile.
+    [self answerAfter:0 completionHandler:completionHandler response:^OobStubResponse *{
+        OobStubResponse *retValue = [OobStubResponse new];
+        @synchronized (self) {
+            retValue.oobIncomingMessage = self.messages[messageId];
+        }
+        return retValue;
+    }];
+}
+
+- (void)pollClientId:(NSString *)clientId completionHandler:(void (^)(id<EMOobFetchMessageResponse>, NSError *))completionHandler {
+    // Polled message is handed over to client and removed from server.
+    OobStubResponse *response = [OobStubResponse new];
+    @synchronized (self) {
+        _pollCount++;
+        for (OobStubMessage *loopMessage in _polled) {
+            if (self.reachable && [loopMessage.clientId isEqualToString:clientId]) {
+                response.oobIncomingMessage = loopMessage;
+                [_polled removeObject:loopMessage];
+                [_messages removeObjectForKey:loopMessage.messageId];
+                break;
+            }
+        }
+    }
+    [self answerAfter:response.oobIncomingMessage ? 0 : self.pollDelay completionHandler:completionHandler response:^OobStubResponse *{
+        return response;
+    }];
+}
+
+- (void)sendMessage:(OobStubMessage *)message completionHandler:(void (^)(id<EMOobMessageResponse>, NSError *))completionHandler {
+    // Answered message is done on server.
+    @synchronized (self) {
+        _sendCount++;
+        if (self.reachable) {
+            [_sent addObject:message.messageId];
+            [_messages removeObjectForKey:message.messageId];
+        }
+    }
+    [self answerAfter:0 completionHandler:completionHandler response:nil];
+}
+
+- (void)setProfilesWithCompletionHandler:(void (^)(id<EMOobResponse>, NSError *))completionHandler {
+    @synchronized (self) {
+        _profileCount++;
+        if (self.holdProfiles) {
+            [_heldProfiles addObject:^{
+                completionHandler([OobStubResponse new], nil);
+            }];
+            return;
+        }
+    }
+    [self answerAfter:0 completionHandler:completionHandler response:nil];
+}
+
+- (void)clearProfilesWithCompletionHandler:(void (^)(id<EMOobResponse>, NSError *))completionHandler {
+    @synchronized (self) {
+        _clearCount++;
+    }
+    [self answerAfter:0 completionHandler:completionHandler response:nil];
+}
+
+// MARK: - Private Helpers
+
+- (void)answerAfter:(NSTimeInterval)delay
+  completionHandler:(void (^)(id, NSError *))completionHandler
+           response:(OobStubResponse *(^)(void))response {
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)((self.latency + delay) * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        if (self.reachable) {
+            completionHandler(response ? response() : [OobStubResponse new], nil);
+        } else {
+            completionHandler(nil, [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil]);
+        }
+    });
+}
+
+@end
@@ -0,0 +1,637 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "PushManager.h"
+#import "MessageOutbox.h"
+#import "UserDefaults.h"
+#import "OobStub.h"
+
+#define kTestSuiteFast      @"PushManagerTestsFast"
+#define kTestSuiteSecure    @"PushManagerTestsSecure"
+#define kTestSuiteJournal   @"PushManagerTestsJournal"
+#define kTestPushToken      @"PushToken1"
+#define kTestPushTokenNew   @"PushToken2"
+#define kTestTokenName      @"Token1"
+#define kTestClientId       @"Client1"
+#define kTestTokenNameOther @"Token2"
+#define kTestClientIdOther  @"Client2"
+#define kTestTimeout        10.0
+
+// Pushes replayed in burst test. Inbox keeps only this many most recent ones.
+#define kTestBurst          1000
+#define kTestInboxCapacity  64
+
+// Pushes in UI reload test. More than prefetch capacity.
+#define kTestReloadBurst    100
+#define kTestPrefetchCapacity 8
+
+// Round trip of stand-in server in fetch timing test.
+#define kTestLatency        0.1
+
+// More than prefetch capacity, so long polled messages would be evicted without pinning.
+#define kTestPolled         10
+
+// Callers racing for the same registration.
+#define kTestRegistrations  50
+
+// Synthetic payloads handled in each measured round of routing benchmark, spread over several tokens.
+#define kTestPayloads       10000
+#define kTestTokens         8
+
+// Signing flow starts from approval dialog. Expose its end and the outbox for tests only.
+@interface PushManager (Tests)
+
+@property (nonatomic, strong) MessageOutbox *outbox;
+
+- (id<EMOobMessageManager>)messageManagerWithClientId:(NSString *)clientId;
+- (id<EMOobNotificationManager>)notificationManagerWithClientId:(NSString *)clientId;
+- (void)processTransactionSigningRequest:(id<EMOobTransactionSigningRequest>)request
+                       oobMessageManager:(id<EMOobMessageManager>)oobMessageManager
+                                 handler:(BaseViewController *)handler
+                                     otp:(id<EMSecureString>)otp;
+- (void)outboxDrain;
+
+@end
+
+/**
+ Scratch storage which can be told to refuse commits.
+ */
+@interface FailingUserDefaults : UserDefaults
+
+@property (atomic, assign) BOOL failCommits;
+
+@end
+
+@implementation FailingUserDefaults
+
+- (BOOL)commitValues:(NSDictionary<NSString *, id> *)values removeKeys:(NSArray<NSString *> *)keys {
+    return !self.failCommits && [super commitValues:values removeKeys:keys];
+}
+
+@end
+
+@interface PushManagerTests : XCTestCase
+
+@property (nonatomic, strong) OobStubManager    *server;
+@property (nonatomic, strong) PushManager       *manager;
+@property (nonatomic, strong) NSArray<FailingUserDefaults *> *storages;
+
+@end
+
+@implementation PushManagerTests
+
+// MARK: - Life Cycle
+
+- (void)setUp {
+    [super setUp];
+    
+    // Scratch suites, so tests never touch values of the app itself.
+    self.storages = @[[[FailingUserDefaults alloc] initWithSuiteName:kTestSuiteFast],
+                      [[FailingUserDefaults alloc] initWithSuiteName:kTestSuiteSecure],
+                      [[FailingUserDefaults alloc] initWithSuiteName:kTestSuiteJournal]];
+    for (UserDefaults *loopStorage in _storages) {
+        [loopStorage removeSuite];
+    }
+    
+    self.server     = [OobStubManager new];
+    self.manager    = [self newManager];
+}
+
+- (void)tearDown {
+    _manager.longPollEnabled = NO;
+    self.manager    = nil;
+    self.server     = nil;
+    for (UserDefaults *loopStorage in _storages) {
+        [loopStorage removeSuite];
+    }
+    self.storages   = nil;
+    
+    [super tearDown];
+}
+
+// MARK: - Private Helpers
+
+- (PushManager *)newManager {
+    return [[PushManager alloc] initWithOobManager:_server
+                                       storageFast:_storages[0]
+                                     storageSecure:_storages[1]
+                                    storageJournal:_storages[2]];
+}
+
+- (void)waitUntil:(BOOL (^)(void))condition description:(NSString *)description {
+    NSPredicate *predicate = [NSPredicate predicateWithBlock:^BOOL(id object, NSDictionary *bindings) {
+        return condition();
+    }];
+    XCTNSPredicateExpectation *expectation = [[XCTNSPredicateExpectation alloc] initWithPredicate:predicate object:nil];
+    expectation.expectationDescription = description;
+    [self waitForExpectations:@[expectation] timeout:kTestTimeout];
+}
+
+- (void)registerClientId:(NSString *)clientId tokenName:(NSString *)tokenName {
+    XCTestExpectation *done = [self expectationWithDescription:@"Client registered."];
+    [_manager registerToken:kTestPushToken completionHandler:^(BOOL success, NSError *error) {
+        [self.manager registerClientId:clientId tokenName:tokenName completionHandler:^(BOOL success, NSError *error) {
+            XCTAssertTrue(success);
+            [done fulfill];
+        }];
+    }];
+    [self waitForExpectationsWithTimeout:kTestTimeout handler:nil];
+}
+
+- (void)unregisterTokenName:(NSString *)tokenName {
+    XCTestExpectation *done = [self expectationWithDescription:@"Client unregistered."];
+    [_manager unregisterOOBWithTokenName:tokenName completionHandler:^(BOOL success, NSError *error) {
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kTestTimeout handler:nil];
+}
+
+- (void)pushAndWait:(NSString *)messageId clientId:(NSString *)clientId {
+    [_manager processIncomingPush:[self pushWithMessageId:messageId clientId:clientId]];
+    [self waitUntil:^BOOL{
+        return self.manager.isIncomingMessageInQueue;
+    } description:@"Push stored."];
+}
+
+- (void)answerMessageId:(NSString *)messageId {
+    [_server addMessageId:messageId type:EMOobIncomingMessageTypeTransactionSigning clientId:kTestClientId];
+    [_manager processTransactionSigningRequest:[_server messageWithId:messageId]
+                             oobMessageManager:[_manager messageManagerWithClientId:kTestClientId]
+                                       handler:nil
+                                           otp:[@"123456" secureString]];
+}
+
+- (NSDictionary *)pushWithMessageId:(NSString *)messageId clientId:(NSString *)clientId {
+    return @{@"com.gemalto.msm": @{@"clientId": clientId, @"messageId": messageId}};
+}
+
+- (void)waitForDelay:(NSTimeInterval)delay {
+    XCTestExpectation *passed = [self expectationWithDescription:@"Delay passed."];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [passed fulfill];
+    });
+    [self waitForExpectationsWithTimeout:delay + kTestTimeout handler:nil];
+}
+
+- (void)fetchAndWaitForReadyCount:(NSUInteger)count {
+    [_manager fetchMessagesWithHandler:nil];
+    [self waitUntil:^BOOL{
+        return self.manager.readyPrefetchedCount + self.manager.readyOnDemandCount == count;
+    } description:@"Message ready."];
+}
+
+- (NSString *)messageIdAtIndex:(NSUInteger)index {
+    return [NSString stringWithFormat:@"Message%04lu", (unsigned long)index];
+}
+
+// MARK: - Tests
+
+- (void)testBurstReplay {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    
+    for (NSUInteger index = 0; index < kTestBurst; index++) {
+        [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:index] clientId:kTestClientId]];
+    }
+    [self waitUntil:^BOOL{
+        return self.manager.isIncomingMessageInQueue;
+    } description:@"Burst stored."];
+    
+    // Server has none of them any more. Each queued id costs exactly one round trip, in order, without any blind long fetch.
+    [_manager fetchMessagesWithHandler:nil];
+    [self waitUntil:^BOOL{
+        return !self.manager.isIncomingMessageInQueue && self.server.fetchCount == kTestInboxCapacity;
+    } description:@"Inbox drained."];
+    
+    XCTAssertEqual(_server.fetchCount, kTestInboxCapacity);
+    XCTAssertEqual(_server.pollCount, 0);
+}
+
+- (void)testInboxSurvivesRestart {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:0] clientId:kTestClientId]];
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:1] clientId:kTestClientId]];
+    [self waitUntil:^BOOL{
+        return self.manager.isIncomingMessageInQueue;
+    } description:@"Burst stored."];
+    
+    // Pending ids are loaded from storage with next launch and drained without server side search.
+    self.manager = [self newManager];
+    XCTAssertTrue(_manager.isIncomingMessageInQueue);
+    NSUInteger fetchCount = _server.fetchCount;
+    [_manager fetchMessagesWithHandler:nil];
+    [self waitUntil:^BOOL{
+        return !self.manager.isIncomingMessageInQueue;
+    } description:@"Inbox drained."];
+    XCTAssertEqual(_server.fetchCount - fetchCount, 2);
+    XCTAssertEqual(_server.pollCount, 0);
+}
+
+- (void)testFetchTiming {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    _server.latency = kTestLatency;
+    
+    // Push arrives well before user opens the message. It's downloaded meanwhile.
+    NSString *messageId = [self messageIdAtIndex:0];
+    [_server addMessageId:messageId type:OobStubMessageTypePlain clientId:kTestClientId];
+    [_manager processIncomingPush:[self pushWithMessageId:messageId clientId:kTestClientId]];
+    [self waitForDelay:kTestLatency * 5];
+    [self fetchAndWaitForReadyCount:1];
+    XCTAssertEqual(_manager.readyPrefetchedCount, 1);
+    XCTAssertLessThan(_manager.readyPrefetchedTime, kTestLatency);
+    
+    // Nothing prefetched after restart. User waits for the round trip.
+    messageId = [self messageIdAtIndex:1];
+    [_server addMessageId:messageId type:OobStubMessageTypePlain clientId:kTestClientId];
+    [_manager processIncomingPush:[self pushWithMessageId:messageId clientId:kTestClientId]];
+    [self waitUntil:^BOOL{
+        return self.manager.isIncomingMessageInQueue;
+    } description:@"Push stored."];
+    self.manager = [self newManager];
+    [self fetchAndWaitForReadyCount:1];
+    XCTAssertEqual(_manager.readyOnDemandCount, 1);
+    XCTAssertGreaterThanOrEqual(_manager.readyOnDemandTime, kTestLatency);
+    XCTAssertEqual(_manager.readyPrefetchedCount, 0);
+}
+
+- (void)testLongPollPinned {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    for (NSUInteger index = 0; index < kTestPolled; index++) {
+        [_server addPolledMessageId:[self messageIdAtIndex:index] type:OobStubMessageTypePlain clientId:kTestClientId];
+    }
+    
+    // Long poll takes all messages off the server.
+    _manager.longPollEnabled = YES;
+    [self waitUntil:^BOOL{
+        return self.server.pollCount > kTestPolled;
+    } description:@"Messages polled."];
+    _manager.longPollEnabled = NO;
+    [self waitForDelay:kTestLatency * 5];
+    
+    // Late pushes of the same messages.
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:0] clientId:kTestClientId]];
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:1] clientId:kTestClientId]];
+    XCTAssertEqual(_manager.deliveredFirstByLongPollCount, 2);
+    XCTAssertEqual(_manager.deliveredFirstByPushCount, 0);
+    
+    // None of them can be fetched again. All must be still kept by the manager.
+    for (NSUInteger index = 0; index < kTestPolled; index++) {
+        [self fetchAndWaitForReadyCount:index + 1];
+    }
+    XCTAssertEqual(_manager.readyPrefetchedCount, kTestPolled);
+    XCTAssertEqual(_server.fetchCount, 0);
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+}
+
+- (void)testLongPollAfterPush {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    _server.latency = kTestLatency * 5;
+    
+    // Long poll takes message off the server while prefetch started by push is on the way, so prefetch finds nothing.
+    NSString *messageId = [self messageIdAtIndex:0];
+    [_server addPolledMessageId:messageId type:OobStubMessageTypePlain clientId:kTestClientId];
+    [_manager processIncomingPush:[self pushWithMessageId:messageId clientId:kTestClientId]];
+    [self waitForDelay:kTestLatency * 4];
+    XCTAssertEqual(_server.fetchCount, 1);
+    _manager.longPollEnabled = YES;
+    [self waitUntil:^BOOL{
+        return self.manager.deliveredFirstByPushCount == 1;
+    } description:@"Message polled."];
+    _manager.longPollEnabled = NO;
+    XCTAssertGreaterThanOrEqual(_manager.deliveryLeadTime, kTestLatency * 5);
+    
+    // Message delivered by long poll replaces the empty prefetch result.
+    [self fetchAndWaitForReadyCount:1];
+    XCTAssertEqual(_manager.readyPrefetchedCount, 1);
+    XCTAssertEqual(_server.fetchCount, 1);
+}
+
+- (void)testLongPollStartOffMainThread {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    
+    // Application state is checked on main thread, whichever thread enables the loop.
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+        self.manager.longPollEnabled = YES;
+    });
+    [self waitUntil:^BOOL{
+        return self.server.pollCount > 0;
+    } description:@"Long poll started."];
+}
+
+- (void)testRegistrationSingleFlight {
+    // Push token without any client id is just stored.
+    XCTestExpectation *stored = [self expectationWithDescription:@"Token stored."];
+    [_manager registerToken:kTestPushToken completionHandler:^(BOOL success, NSError *error) {
+        [stored fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:kTestTimeout handler:nil];
+    XCTAssertEqual(_server.profileCount, 0);
+    
+    // Server keeps the first registration on the way until test lets it go.
+    _server.holdProfiles = YES;
+    XCTestExpectation *first = [self expectationWithDescription:@"First registration finished."];
+    first.expectedFulfillmentCount = kTestRegistrations + 1;
+    [_manager registerClientId:kTestClientId tokenName:kTestTokenName completionHandler:^(BOOL success, NSError *error) {
+        XCTAssertTrue(success);
+        [first fulfill];
+    }];
+    
+    // Same token from any thread only joins it.
+    dispatch_apply(kTestRegistrations, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t index) {
+        [self.manager registerToken:kTestPushToken completionHandler:^(BOOL success, NSError *error) {
+            XCTAssertTrue(success);
+            [first fulfill];
+        }];
+    });
+    XCTAssertEqual(_server.profileCount, 1);
+    
+    // Changed token queues exactly one follow-up, shared by all callers.
+    XCTestExpectation *followUp = [self expectationWithDescription:@"Follow-up registration finished."];
+    followUp.expectedFulfillmentCount = 2;
+    for (NSUInteger index = 0; index < 2; index++) {
+        [_manager registerToken:kTestPushTokenNew completionHandler:^(BOOL success, NSError *error) {
+            XCTAssertTrue(success);
+            [followUp fulfill];
+        }];
+    }
+    XCTAssertEqual(_server.profileCount, 1);
+    XCTAssertFalse(_manager.isPushTokenRegistered);
+    
+    [_server releaseProfiles];
+    [self waitForExpectations:@[first] timeout:kTestTimeout];
+    [self waitUntil:^BOOL{
+        return self.server.profileCount == 2;
+    } description:@"Follow-up sent."];
+    
+    [_server releaseProfiles];
+    [self waitForExpectations:@[followUp] timeout:kTestTimeout];
+    XCTAssertEqual(_server.profileCount, 2);
+    XCTAssertTrue(_manager.isPushTokenRegistered);
+    XCTAssertEqualObjects(_manager.currentPushToken, kTestPushTokenNew);
+}
+
+- (void)testPushRouting {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    
+    // Unknown client and foreign message types are ignored right away.
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:0] clientId:@"Unknown"]];
+    [_manager processIncomingPush:@{@"aps": @{@"alert": @"Hello"}}];
+    [self waitForDelay:kTestLatency * 5];
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+    
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:1] clientId:kTestClientId]];
+    [self waitUntil:^BOOL{
+        return self.manager.isIncomingMessageInQueue;
+    } description:@"Push stored."];
+    
+    // Routing follows unregistration right away.
+    [self unregisterTokenName:kTestTokenName];
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:2] clientId:kTestClientId]];
+    [self waitForDelay:kTestLatency * 5];
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+}
+
+- (void)testPushRoutingPerformance {
+    NSMutableArray<NSDictionary *> *payloads = [NSMutableArray arrayWithCapacity:kTestPayloads];
+    for (NSUInteger index = 0; index < kTestTokens; index++) {
+        [self registerClientId:[NSString stringWithFormat:@"Client%lu", (unsigned long)index]
+                     tokenName:[NSString stringWithFormat:@"Token%lu", (unsigned long)index]];
+    }
+    for (NSUInteger index = 0; index < kTestPayloads; index++) {
+        [payloads addObject:[self pushWithMessageId:[self messageIdAtIndex:index]
+                                           clientId:[NSString stringWithFormat:@"Client%lu", (unsigned long)(index % kTestTokens)]]];
+    }
+    
+    // Routing is in-memory lookup. Storage is touched only once per burst, after the measured part.
+    [self measureBlock:^{
+        for (NSDictionary *loopPayload in payloads) {
+            [self.manager processIncomingPush:loopPayload];
+        }
+    }];
+    
+    [self waitUntil:^BOOL{
+        return self.manager.isIncomingMessageInQueue;
+    } description:@"Burst stored."];
+}
+
+- (void)testMultiToken {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    [self registerClientId:kTestClientIdOther tokenName:kTestTokenNameOther];
+    XCTAssertTrue(_manager.isPushTokenRegistered);
+    
+    // Registration state is kept for each token separately.
+    XCTAssertEqualObjects([_storages[0] readStringForKey:@"LastRegistredTokenId.Token1"], kTestPushToken);
+    XCTAssertEqualObjects([_storages[0] readStringForKey:@"LastRegistredTokenId.Token2"], kTestPushToken);
+    
+    // Removing one token leaves messages and routing of the other one untouched.
+    [self pushAndWait:[self messageIdAtIndex:0] clientId:kTestClientIdOther];
+    [self unregisterTokenName:kTestTokenName];
+    XCTAssertTrue(_manager.isIncomingMessageInQueue);
+    XCTAssertNil([_storages[0] readStringForKey:@"LastRegistredTokenId.Token1"]);
+    XCTAssertTrue(_manager.isPushTokenRegistered);
+    
+    [self unregisterTokenName:kTestTokenNameOther];
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+    XCTAssertEqual(_server.clearCount, 2);
+}
+
+- (void)testRegistrationDeleteFailure {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    [self pushAndWait:[self messageIdAtIndex:0] clientId:kTestClientId];
+    
+    // Client id can't be removed. Client and its pending messages stay as they were.
+    _storages[1].failCommits = YES;
+    [self unregisterTokenName:kTestTokenName];
+    XCTAssertTrue(_manager.isIncomingMessageInQueue);
+    XCTAssertTrue(_manager.isPushTokenRegistered);
+    
+    _storages[1].failCommits = NO;
+    [self unregisterTokenName:kTestTokenName];
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+    XCTAssertFalse(_manager.isPushTokenRegistered);
+}
+
+- (void)testMissingTokenName {
+    XCTestExpectation *done = [self expectationWithDescription:@"Registration finished."];
+    [_manager registerToken:kTestPushToken completionHandler:^(BOOL success, NSError *error) {
+        [self.manager registerClientId:kTestClientId tokenName:nil completionHandler:^(BOOL success, NSError *error) {
+            [done fulfill];
+        }];
+    }];
+    [self waitForExpectationsWithTimeout:kTestTimeout handler:nil];
+    [_manager adoptLegacyClientIdWithTokenName:nil];
+    
+    // Nothing was stored without token name.
+    XCTAssertEqual(_server.profileCount, 0);
+    XCTAssertFalse(_manager.isPushTokenRegistered);
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:0] clientId:kTestClientId]];
+    [self waitForDelay:kTestLatency * 5];
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+}
+
+- (void)testLegacyAdoption {
+    // Values stored by versions with single client id.
+    [_storages[1] writeString:kTestClientId forKey:@"ClientId"];
+    [_storages[0] writeString:kTestPushToken forKey:@"LastRegistredTokenId"];
+    self.manager = [self newManager];
+    
+    [_manager adoptLegacyClientIdWithTokenName:kTestTokenName];
+    XCTAssertNil([_storages[1] readStringForKey:@"ClientId"]);
+    XCTAssertNil([_storages[0] readStringForKey:@"LastRegistredTokenId"]);
+    XCTAssertEqualObjects([_storages[0] readStringForKey:@"LastRegistredTokenId.Token1"], kTestPushToken);
+    XCTAssertTrue(_manager.isPushTokenRegistered);
+    [self pushAndWait:[self messageIdAtIndex:0] clientId:kTestClientId];
+    
+    // Empty legacy value is not adopted.
+    [_storages[1] writeString:@"" forKey:@"ClientId"];
+    [_manager adoptLegacyClientIdWithTokenName:kTestTokenNameOther];
+    [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:1] clientId:@""]];
+    [self unregisterTokenName:kTestTokenName];
+    [self waitForDelay:kTestLatency * 5];
+    XCTAssertFalse(_manager.isIncomingMessageInQueue);
+}
+
+- (void)testOutboxResend {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    
+    // Connection is lost while user approves. Response stays queued.
+    NSString *messageId = [self messageIdAtIndex:0];
+    _server.reachable = NO;
+    [self answerMessageId:messageId];
+    [self waitUntil:^BOOL{
+        return self.server.sendCount == 1;
+    } description:@"Send failed."];
+    [self waitForDelay:kTestLatency];
+    XCTAssertTrue([_manager.outbox containsMessageId:messageId]);
+    
+    // Connection is back. Response is rebuilt from original request and delivered exactly once.
+    _server.reachable = YES;
+    [_manager outboxDrain];
+    [_manager outboxDrain];
+    [self waitUntil:^BOOL{
+        return self.manager.outbox.count == 0;
+    } description:@"Outbox drained."];
+    [_manager outboxDrain];
+    [self waitForDelay:kTestLatency];
+    XCTAssertEqualObjects(_server.sentMessageIds, @[messageId]);
+    XCTAssertEqual(_server.sendCount, 2);
+}
+
+- (void)testOutboxDuplicate {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    
+    // Same reaction while the first one is on the way only waits for its result.
+    NSString *messageId = [self messageIdAtIndex:0];
+    [self answerMessageId:messageId];
+    [self answerMessageId:messageId];
+    [_manager outboxDrain];
+    [self waitUntil:^BOOL{
+        return self.manager.outbox.count == 0;
+    } description:@"Response delivered."];
+    [self waitForDelay:kTestLatency];
+    XCTAssertEqualObjects(_server.sentMessageIds, @[messageId]);
+    XCTAssertEqual(_server.sendCount, 1);
+}
+
+- (void)testOutboxUnregister {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    _server.reachable = NO;
+    [self answerMessageId:[self messageIdAtIndex:0]];
+    [self waitUntil:^BOOL{
+        return self.server.sendCount == 1;
+    } description:@"Send failed."];
+    
+    // Responses of removed client are dropped with it.
+    _server.reachable = YES;
+    [self unregisterTokenName:kTestTokenName];
+    XCTAssertEqual(_manager.outbox.count, 0);
+    [_manager outboxDrain];
+    [self waitForDelay:kTestLatency];
+    XCTAssertEqual(_server.sendCount, 1);
+}
+
+- (void)testBurstReloadCount {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    
+    // Every notification means one reload of all listening screens.
+    __block NSUInteger  reloads     = 0;
+    id                  observer    = [[NSNotificationCenter defaultCenter] addObserverForName:C_NOTIFICATION_ID_INCOMING_MESSAGE
+                                                                                        object:nil
+                                                                                         queue:nil
+                                                                                    usingBlock:^(NSNotification *note) {
+        reloads++;
+    }];
+    
+    for (NSUInteger index = 0; index < kTestReloadBurst; index++) {
+        [_manager processIncomingPush:[self pushWithMessageId:[self messageIdAtIndex:index] clientId:kTestClientId]];
+    }
+    [self waitForDelay:kTestLatency * 5];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    
+    // Single reload and single write for whole burst. Oldest messages are ready before user gets to them.
+    XCTAssertEqual(reloads, 1);
+    XCTAssertEqual(_manager.burstPushCount, kTestReloadBurst);
+    XCTAssertEqual(_manager.burstFlushCount, 1);
+    XCTAssertEqual(_server.fetchCount, kTestPrefetchCapacity);
+}
+
+- (void)testManagerCache {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    [self registerClientId:kTestClientIdOther tokenName:kTestTokenNameOther];
+    NSUInteger created  = _server.managerCount;
+    NSUInteger hits     = _manager.managerCacheHitCount;
+    
+    // Each client has its own managers. Those are created once and reused.
+    id<EMOobMessageManager> manager         = [_manager messageManagerWithClientId:kTestClientId];
+    id<EMOobMessageManager> managerOther    = [_manager messageManagerWithClientId:kTestClientIdOther];
+    XCTAssertNotEqual(manager, managerOther);
+    XCTAssertEqual([_manager messageManagerWithClientId:kTestClientId], manager);
+    XCTAssertEqual([_manager messageManagerWithClientId:kTestClientIdOther], managerOther);
+    XCTAssertEqual(_server.managerCount - created, 2);
+    XCTAssertEqual(_manager.managerCacheHitCount - hits, 2);
+    
+    // Unregistered client loses exactly its own managers.
+    [self unregisterTokenName:kTestTokenName];
+    created = _server.managerCount;
+    XCTAssertNotEqual([_manager messageManagerWithClientId:kTestClientId], manager);
+    XCTAssertEqual([_manager messageManagerWithClientId:kTestClientIdOther], managerOther);
+    [_manager notificationManagerWithClientId:kTestClientIdOther];
+    XCTAssertEqual(_server.managerCount - created, 1);
+}
+
+- (void)testManagerCachePerformance {
+    [self registerClientId:kTestClientId tokenName:kTestTokenName];
+    
+    // Cost of getting manager for each call once it's cached.
+    [self measureBlock:^{
+        for (NSUInteger index = 0; index < kTestPayloads; index++) {
+            [self.manager messageManagerWithClientId:kTestClientId];
+        }
+    }];
+    XCTAssertGreaterThanOrEqual(_manager.managerCacheHitCount, kTestPayloads * 10 - 1);
+}
+
+@end
@@ -0,0 +1,370 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "SecureStorage.h"
+
+#define kTestIdentifier @"SecureStorageTests"
+
+// Storage layout of the batch journal. Checked directly to see interrupted batch.
+#define kTestJournalKey @"SecureStorageJournal"
+
+// Writes of in-memory storage never fail.
+#define kNoFailure      -1
+
+// Mixed operations of open handle benchmark.
+#define kTestOperations 10000
+
+/**
+ In-memory property storage. Fails every write once given number of writes succeeded.
+ */
+@interface MockPropertyStorage : NSObject
+
+@property (nonatomic, strong) NSMutableDictionary<NSData *, NSData *>   *values;
+@property (nonatomic, assign) NSInteger                                 failAfter;
+@property (nonatomic, assign) NSInteger                                 writes;
+@property (nonatomic, assign) NSInteger                                 opens;
+
+@end
+
+@implementation MockPropertyStorage
+
+- (instancetype)init {
+    if (self = [super init]) {
+        self.values     = [NSMutableDictionary new];
+        self.failAfter  = kNoFailure;
+    }
+    
+    return self;
+}
+
+- (BOOL)open:(NSError **)error {
+    _opens++;
+    return YES;
+}
+
+- (BOOL)close:(NSError **)error {
+    return YES;
+}
+
+- (BOOL)setProperty:(id<EMSecureByteArray>)value forKey:(NSData *)key wipeValue:(BOOL)wipeValue error:(NSError **)error {
+    BOOL retValue = [self allowWrite:error];
+    if (retValue) {
+        _values[key] = [value.dataValue copy];
+    }
+    if (wipeValue) {
+        [value wipe];
+    }
+    
+    return retValue;
+}
+
+- (id<EMSecureByteArray>)propertyForKey:(NSData *)key error:(NSError **)error {
+    return [_values[key] secureByteArray:NO];
+}
+
+- (BOOL)removePropertyForKey:(NSData *)key error:(NSError **)error {
+    if (!_values[key] || ![self allowWrite:error]) {
+        return NO;
+    }
+    
+    [_values removeObjectForKey:key];
+    return YES;
+}
+
+- (BOOL)allowWrite:(NSError **)error {
+    if (_failAfter != kNoFailure && _writes >= _failAfter) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EIO userInfo:nil];
+        }
+        return NO;
+    }
+    
+    _writes++;
+    return YES;
+}
+
+@end
+
+/**
+ Manager handing out the one in-memory storage.
+ */
+@interface MockStorageManager : NSObject
+
+@property (nonatomic, strong) MockPropertyStorage *storage;
+
+@end
+
+@implementation MockStorageManager
+
+- (id<EMPropertyStorage>)propertyStorageWithIdentifier:(NSString *)identifier error:(NSError **)error {
+    return (id<EMPropertyStorage>)_storage;
+}
+
+- (BOOL)deletePropertyStorageWithIdentifier:(NSString *)identifier error:(NSError **)error {
+    [_storage.values removeAllObjects];
+    return YES;
+}
+
+@end
+
+@interface SecureStorageTests : XCTestCase
+
+@property (nonatomic, strong) MockStorageManager    *manager;
+@property (nonatomic, strong) MockPropertyStorage   *mock;
+
+@end
+
+@implementation SecureStorageTests
+
+// MARK: - Life Cycle
+
+- (void)setUp {
+    [super setUp];
+    
+    self.mock               = [MockPropertyStorage new];
+    self.manager            = [MockStorageManager new];
+    self.manager.storage    = _mock;
+    
+    // Each test starts with A and C stored.
+    SecureStorage *storage = [self storage];
+    XCTAssertTrue([storage writeString:@"old" forKey:@"A"]);
+    XCTAssertTrue([storage writeString:@"old" forKey:@"C"]);
+    _mock.writes = 0;
+}
+
+- (void)tearDown {
+    self.manager    = nil;
+    self.mock       = nil;
+    
+    [super tearDown];
+}
+
+// MARK: - Tests
+
+- (void)testCommit {
+    SecureStorage *storage = [self storage];
+    XCTAssertTrue([storage commitValues:@{@"A": @"new", @"B": @42} removeKeys:@[@"C", @"Missing"]]);
+    
+    XCTAssertEqualObjects([storage readStringForKey:@"A"], @"new");
+    XCTAssertEqual([storage readInt64ForKey:@"B"], 42);
+    XCTAssertNil([storage readStringForKey:@"C"]);
+    XCTAssertNil([self rawValueForKey:kTestJournalKey]);
+}
+
+- (void)testUnsupportedValue {
+    // Whole batch is refused before anything is written.
+    XCTAssertFalse([[self storage] commitValues:@{@"A": @"new", @"B": @[]} removeKeys:@[@"C"]]);
+    XCTAssertEqual(_mock.writes, 0);
+    XCTAssertEqualObjects([self rawValueForKey:@"A"], @"old");
+}
+
+- (void)testJournalFailure {
+    NSDictionary *original = [_mock.values copy];
+    
+    // Failed commit point leaves every value as it was.
+    _mock.failAfter = 0;
+    XCTAssertFalse([[self storage] commitValues:@{@"A": @"new", @"B": @"new"} removeKeys:@[@"C"]]);
+    XCTAssertEqualObjects(_mock.values, original);
+    
+    _mock.failAfter = kNoFailure;
+    SecureStorage *storage = [self storage];
+    XCTAssertEqualObjects([storage readStringForKey:@"A"], @"old");
+    XCTAssertNil([storage readStringForKey:@"B"]);
+    XCTAssertEqualObjects([storage readStringForKey:@"C"], @"old");
+}
+
+- (void)testInterruptedBatch {
+    // Journal and first change are stored, rest of the batch fails.
+    _mock.failAfter = 2;
+    SecureStorage *storage = [self storage];
+    XCTAssertTrue([storage commitValues:@{@"A": @"new", @"B": @"new"} removeKeys:@[@"C"]]);
+    XCTAssertNotNil([self rawValueForKey:kTestJournalKey]);
+    
+    // Half applied batch is never visible. Storage refuses access until the batch is completed.
+    XCTAssertNil([storage readStringForKey:@"A"]);
+    XCTAssertNil([storage readStringForKey:@"C"]);
+    XCTAssertFalse([storage writeString:@"other" forKey:@"B"]);
+    XCTAssertFalse([storage commitValues:@{@"B": @"other"} removeKeys:nil]);
+    
+    // First access after failure went away completes the batch.
+    _mock.failAfter = kNoFailure;
+    XCTAssertEqualObjects([storage readStringForKey:@"A"], @"new");
+    XCTAssertEqualObjects([storage readStringForKey:@"B"], @"new");
+    XCTAssertNil([storage readStringForKey:@"C"]);
+    XCTAssertNil([self rawValueForKey:kTestJournalKey]);
+}
+
+- (void)testCrashRecovery {
+    // Batch interrupted right after commit point, as if app was killed.
+    _mock.failAfter = 1;
+    XCTAssertTrue([[self storage] commitValues:@{@"A": @"new", @"B": @"new"} removeKeys:@[@"C"]]);
+    XCTAssertEqualObjects([self rawValueForKey:@"A"], @"old");
+    XCTAssertEqualObjects([self rawValueForKey:@"C"], @"old");
+    
+    // Next instance finds the journal when storage is opened.
+    _mock.failAfter = kNoFailure;
+    SecureStorage *storage = [self storage];
+    XCTAssertEqualObjects([storage readStringForKey:@"A"], @"new");
+    XCTAssertEqualObjects([storage readStringForKey:@"B"], @"new");
+    XCTAssertNil([storage readStringForKey:@"C"]);
+    XCTAssertNil([self rawValueForKey:kTestJournalKey]);
+}
+
+- (void)testOpenHandleReuse {
+    // Storage is opened once and kept for all following operations.
+    SecureStorage *storage = [self storage];
+    _mock.opens = 0;
+    [self runMixedOperations:storage flushEach:NO];
+    XCTAssertEqual(_mock.opens, 1);
+    
+    // Flush closes it. Next access opens it again.
+    [storage flush];
+    XCTAssertEqualObjects([storage readStringForKey:@"A"], @"old");
+    XCTAssertEqual(_mock.opens, 2);
+}
+
+- (void)testMixedOperationsOpenPerCall {
+    // Baseline. Storage opened and closed around each operation.
+    SecureStorage *storage = [self storage];
+    [self measureBlock:^{
+        [self runMixedOperations:storage flushEach:YES];
+    }];
+}
+
+- (void)testMixedOperationsOpenHandle {
+    SecureStorage *storage = [self storage];
+    [self measureBlock:^{
+        [self runMixedOperations:storage flushEach:NO];
+    }];
+}
+
+- (void)testTypedValues {
+    SecureStorage   *storage    = [self storage];
+    NSData          *bytes      = [NSData dataWithBytes:"\x00\x01\xff" length:3];
+    
+    XCTAssertTrue([storage writeInt64:INT64_MIN forKey:@"Min"]);
+    XCTAssertTrue([storage writeInt64:INT64_MAX forKey:@"Max"]);
+    XCTAssertTrue([storage writeBool:YES forKey:@"Bool"]);
+    XCTAssertTrue([storage writeBytes:bytes forKey:@"Bytes"]);
+    XCTAssertTrue([storage writeSecureBytes:[bytes secureByteArray:NO] forKey:@"Secure"]);
+    
+    XCTAssertEqual([storage readInt64ForKey:@"Min"], INT64_MIN);
+    XCTAssertEqual([storage readInt64ForKey:@"Max"], INT64_MAX);
+    XCTAssertTrue([storage readBoolForKey:@"Bool"]);
+    XCTAssertFalse([storage readBoolForKey:@"Missing"]);
+    XCTAssertEqualObjects([storage readBytesForKey:@"Bytes"], bytes);
+    
+    id<EMSecureByteArray> secure = [storage readSecureBytesForKey:@"Secure"];
+    XCTAssertEqualObjects(secure.dataValue, bytes);
+    [secure wipe];
+    
+    // Integer stored by older version with shorter size is read as it is.
+    int32_t legacy = 42;
+    _mock.values[[@"Legacy" dataUsingEncoding:NSUTF8StringEncoding]] = [NSData dataWithBytes:&legacy length:sizeof(legacy)];
+    XCTAssertEqual([storage readInt64ForKey:@"Legacy"], 42);
+    XCTAssertEqual([storage readIntegerForKey:@"Legacy"], 42);
+}
+
+- (void)testTypedString {
+    [self measureType:^(SecureStorage *storage, NSString *key) {
+        [storage writeString:key forKey:key];
+        [storage readStringForKey:key];
+    }];
+}
+
+- (void)testTypedInt64 {
+    [self measureType:^(SecureStorage *storage, NSString *key) {
+        [storage writeInt64:key.hash forKey:key];
+        [storage readInt64ForKey:key];
+    }];
+}
+
+- (void)testTypedBool {
+    [self measureType:^(SecureStorage *storage, NSString *key) {
+        [storage writeBool:key.hash % 2 forKey:key];
+        [storage readBoolForKey:key];
+    }];
+}
+
+- (void)testTypedBytes {
+    NSData *value = [NSMutableData dataWithLength:32];
+    [self measureType:^(SecureStorage *storage, NSString *key) {
+        [storage writeBytes:value forKey:key];
+        [storage readBytesForKey:key];
+    }];
+}
+
+- (void)testTypedSecureBytes {
+    NSData *value = [NSMutableData dataWithLength:32];
+    [self measureType:^(SecureStorage *storage, NSString *key) {
+        [storage writeSecureBytes:[value secureByteArray:NO] forKey:key];
+        [[storage readSecureBytesForKey:key] wipe];
+    }];
+}
+
+// MARK: - Private Helpers
+
+- (void)measureType:(void (^)(SecureStorage *storage, NSString *key))operation {
+    // Keys are constants in the app. Same few keys are used over and over, so they are interned after the first use.
+    SecureStorage               *storage    = [self storage];
+    NSArray<NSString *>         *keys       = @[@"Key0", @"Key1", @"Key2", @"Key3"];
+    [self measureBlock:^{
+        for (NSUInteger loopIndex = 0; loopIndex < kTestOperations; loopIndex++) {
+            operation(storage, keys[loopIndex % keys.count]);
+        }
+    }];
+}
+
+- (void)runMixedOperations:(SecureStorage *)storage flushEach:(BOOL)flushEach {
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger loopIndex = 0; loopIndex < kTestOperations; loopIndex++) {
+        NSString *key = [NSString stringWithFormat:@"Key%lu", (unsigned long)(loopIndex % 16)];
+        switch (loopIndex % 4) {
+            case 0:  [storage writeString:key forKey:key]; break;
+            case 1:  [storage readStringForKey:key]; break;
+            case 2:  [storage readIntegerForKey:key]; break;
+            default: [storage removeValueForKey:key]; break;
+        }
+        if (flushEach) {
+            [storage flush];
+        }
+    }
+    NSLog(@"%@: %.0f ops/s", flushEach ? @"Open per call" : @"Open handle", kTestOperations / (CFAbsoluteTimeGetCurrent() - start));
+}
+
+- (SecureStorage *)storage {
+    return [[SecureStorage alloc] initWithIdentifier:kTestIdentifier manager:(id<EMSecureStorageManager>)_manager];
+}
+
+- (NSString *)rawValueForKey:(NSString *)key {
+    NSData *value = _mock.values[[key dataUsingEncoding:NSUTF8StringEncoding]];
+    return value ? [[NSString alloc] initWithData:value encoding:NSUTF8StringEncoding] : nil;
+}
+
+@end
@@ -0,0 +1,103 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "SubjectTemplate.h"
+
+@interface SubjectTemplateTests : XCTestCase
+
+@end
+
+@implementation SubjectTemplateTests
+
+// MARK: - Tests
+
+- (void)testPlainText {
+    SubjectTemplate *subject = [SubjectTemplate templateWithString:@"Approve login"];
+    XCTAssertFalse(subject.hasPlaceholders);
+    XCTAssertEqualObjects([self render:subject values:@{@"amount": @"10"} replaced:0], @"Approve login");
+    
+    // Lone percent sign is not a placeholder.
+    subject = [SubjectTemplate templateWithString:@"Save 10 % today, 20%"];
+    XCTAssertFalse(subject.hasPlaceholders);
+    XCTAssertEqualObjects([self render:subject values:@{@"": @"x"} replaced:0], @"Save 10 % today, 20%");
+    
+    XCTAssertEqualObjects([self render:[SubjectTemplate templateWithString:nil] values:@{} replaced:0], @"");
+}
+
+- (void)testReplace {
+    SubjectTemplate *subject = [SubjectTemplate templateWithString:@"Pay %amount to %beneficiary\nnow"];
+    XCTAssertTrue(subject.hasPlaceholders);
+    XCTAssertEqualObjects([self render:subject values:@{@"amount": @"10 EUR", @"beneficiary": @"Alice"} replaced:2],
+                          @"Pay 10 EUR to Alice\nnow");
+    
+    // Placeholders next to each other and at both ends.
+    subject = [SubjectTemplate templateWithString:@"%a%b %a"];
+    XCTAssertEqualObjects([self render:subject values:@{@"a": @"1", @"b": @"2"} replaced:3], @"12 1");
+}
+
+- (void)testKeyCharacters {
+    // Meta keys are not limited to letters and digits.
+    SubjectTemplate *subject = [SubjectTemplate templateWithString:@"%tx-id, %account.number, %částka, %金额"];
+    NSDictionary    *values  = @{@"tx-id": @"1", @"account.number": @"2", @"částka": @"3", @"金额": @"4"};
+    XCTAssertEqualObjects([self render:subject values:values replaced:4], @"1, 2, 3, 4");
+}
+
+- (void)testKeyPrefix {
+    // Placeholder runs up to whitespace. Longest matching key wins and rest of placeholder is kept.
+    SubjectTemplate *subject = [SubjectTemplate templateWithString:@"Total: %amount, fee %amountFee."];
+    XCTAssertEqualObjects([self render:subject values:@{@"amount": @"10"} replaced:2], @"Total: 10, fee 10Fee.");
+    XCTAssertEqualObjects([self render:subject values:@{@"amount": @"10", @"amountFee": @"1"} replaced:2], @"Total: 10, fee 1.");
+    XCTAssertEqualObjects([self render:subject values:@{@"am": @"x", @"amount,": @"10"} replaced:2], @"Total: 10 fee xountFee.");
+}
+
+- (void)testMissingValue {
+    SubjectTemplate *subject = [SubjectTemplate templateWithString:@"Pay %amount to %beneficiary"];
+    XCTAssertEqualObjects([self render:subject values:@{@"amount": @"10"} replaced:1], @"Pay 10 to %beneficiary");
+    XCTAssertEqualObjects([self render:subject values:@{} replaced:0], @"Pay %amount to %beneficiary");
+    XCTAssertEqualObjects([self render:subject values:nil replaced:0], @"Pay %amount to %beneficiary");
+}
+
+- (void)testCache {
+    NSString *string = [NSString stringWithFormat:@"Cached %@ %%key", [NSUUID UUID].UUIDString];
+    XCTAssertEqual([SubjectTemplate templateWithString:string], [SubjectTemplate templateWithString:[string mutableCopy]]);
+    
+    // Compiled template does not depend on values it was rendered with.
+    SubjectTemplate *subject = [SubjectTemplate templateWithString:string];
+    [subject renderWithValues:@{@"key": @"first"} replacedCount:nil];
+    XCTAssertTrue([[subject renderWithValues:@{@"key": @"second"} replacedCount:nil] hasSuffix:@" second"]);
+}
+
+// MARK: - Private Helpers
+
+- (NSString *)render:(SubjectTemplate *)subject values:(NSDictionary *)values replaced:(NSUInteger)replaced {
+    NSUInteger  count       = NSNotFound;
+    NSString    *retValue   = [subject renderWithValues:values replacedCount:&count];
+    XCTAssertEqual(count, replaced, @"Unexpected number of replaced placeholders in: %@", retValue);
+    
+    return retValue;
+}
+
+@end
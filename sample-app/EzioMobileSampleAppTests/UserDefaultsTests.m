@@ -0,0 +1,117 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#import <XCTest/XCTest.h>
+#import "UserDefaults.h"
+
+#define kTestSuite      @"UserDefaultsTests"
+#define kTestBurst      1000
+#define kTestWriters    200
+
+// Longer than flush window of the storage.
+#define kTestFlushWait  1.5
+
+@interface UserDefaultsTests : XCTestCase
+
+@property (nonatomic, strong) UserDefaults *storage;
+
+@end
+
+@implementation UserDefaultsTests
+
+// MARK: - Life Cycle
+
+- (void)setUp {
+    [super setUp];
+    
+    self.storage = [[UserDefaults alloc] initWithSuiteName:kTestSuite];
+    [_storage removeSuite];
+}
+
+- (void)tearDown {
+    [_storage removeSuite];
+    self.storage = nil;
+    
+    [super tearDown];
+}
+
+// MARK: - Tests
+
+- (void)testBurstFlushCount {
+    NSUInteger flushCount = _storage.flushCount;
+    for (NSInteger loopIndex = 0; loopIndex < kTestBurst; loopIndex++) {
+        XCTAssertTrue([_storage writeInteger:loopIndex forKey:[NSString stringWithFormat:@"Key%ld", (long)loopIndex]]);
+    }
+    
+    // Writes are readable right away, but nothing is persisted yet.
+    XCTAssertEqual([_storage readIntegerForKey:@"Key999"], 999);
+    XCTAssertEqual(_storage.flushCount, flushCount);
+    
+    // Whole burst is persisted with single flush.
+    XCTestExpectation *flushed = [self expectationWithDescription:@"Flush window passed"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kTestFlushWait * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [flushed fulfill];
+    });
+    [self waitForExpectationsWithTimeout:kTestFlushWait * 4 handler:nil];
+    XCTAssertEqual(_storage.flushCount, flushCount + 1);
+}
+
+- (void)testCommit {
+    [_storage writeString:@"old" forKey:@"A"];
+    [_storage writeString:@"old" forKey:@"C"];
+    
+    NSUInteger flushCount = _storage.flushCount;
+    XCTAssertTrue([_storage commitValues:@{@"A": @"new", @"B": @42} removeKeys:@[@"C"]]);
+    XCTAssertEqual(_storage.flushCount, flushCount + 1, @"Batch is persisted right away.");
+    
+    XCTAssertEqualObjects([_storage readStringForKey:@"A"], @"new");
+    XCTAssertEqual([_storage readInt64ForKey:@"B"], 42);
+    XCTAssertNil([_storage readStringForKey:@"C"]);
+}
+
+- (void)testConcurrentWriters {
+    UserDefaults    *other  = [[UserDefaults alloc] initWithSuiteName:kTestSuite];
+    NSUserDefaults  *direct = [[NSUserDefaults alloc] initWithSuiteName:kTestSuite];
+    
+    // Batches of two instances and plain user defaults writes run together. Batch touches only its own keys,
+    // so none of the writes can be lost.
+    dispatch_apply(kTestWriters, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t index) {
+        NSString *key = [NSString stringWithFormat:@"Key%zu", index];
+        switch (index % 3) {
+            case 0:  [self.storage commitValues:@{key: @(index)} removeKeys:nil]; break;
+            case 1:  [other commitValues:@{key: @(index)} removeKeys:nil]; break;
+            default: [direct setObject:@(index) forKey:key]; break;
+        }
+    });
+    
+    for (NSInteger loopIndex = 0; loopIndex < kTestWriters; loopIndex++) {
+        XCTAssertEqual([_storage readInt64ForKey:[NSString stringWithFormat:@"Key%ld", (long)loopIndex]], loopIndex);
+    }
+}
+
+@end
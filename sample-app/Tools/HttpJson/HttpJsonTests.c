@@ -0,0 +1,246 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// Linux checks of portable JSON request templates and response scanner used by HttpManager.
+// Usage: httpjson_tests
+
+#include "HttpJson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        return 1; \
+    } \
+} while (0)
+
+static const char * const kResultPath[] = { "state", "result" };
+
+static HttpJsonScanner TestScanner(const char *json) {
+    return HttpJsonScannerMake(json, strlen(json));
+}
+
+// Returns 1 when key holds string literal (including quotes) equal to expected one. NULL expects no string.
+static int TestString(HttpJsonScanner scanner, const char *key, const char *expected) {
+    const char  *literal    = NULL;
+    size_t      length      = 0;
+    if (!HttpJsonFindString(scanner, key, &literal, &length)) {
+        return expected == NULL;
+    }
+    
+    return expected && length == strlen(expected) && !memcmp(literal, expected, length);
+}
+
+// MARK: - Tests
+
+static int TestResultPath(void) {
+    HttpJsonScanner scanner = TestScanner(" { \"state\" : { \"result\" : { \"code\" : \"0\", \"message\" : \"OK\" } } } ");
+    CHECK(HttpJsonFindPath(&scanner, kResultPath, 2));
+    CHECK(TestString(scanner, "code", "\"0\""));
+    CHECK(TestString(scanner, "message", "\"OK\""));
+    CHECK(TestString(scanner, "missing", NULL));
+    return 0;
+}
+
+static int TestSkipBlobs(void) {
+    // Keys before the path hold nested containers, numbers, literals and strings with structural characters.
+    HttpJsonScanner scanner = TestScanner("{\"audit\":{\"trail\":[1,2.5e3,-4,true,null,{\"a\":\"}]{[\"}],\"note\":\"say \\\"hi\\\" \\\\\"},"
+                                          "\"risk\":[[],{},\"x\"],\"count\":42,\"flag\":false,"
+                                          "\"state\":{\"id\":\"result\",\"result\":{\"code\":\"0\"}}}");
+    CHECK(HttpJsonFindPath(&scanner, kResultPath, 2));
+    CHECK(TestString(scanner, "code", "\"0\""));
+    return 0;
+}
+
+static int TestEscapedValue(void) {
+    HttpJsonScanner scanner = TestScanner("{\"message\":\"line\\nbreak \\\"quoted\\\"\",\"code\":\"1\"}");
+    
+    // Value is returned raw. Decoding is up to the caller.
+    CHECK(TestString(scanner, "message", "\"line\\nbreak \\\"quoted\\\"\""));
+    CHECK(TestString(scanner, "code", "\"1\""));
+    return 0;
+}
+
+static int TestNotString(void) {
+    HttpJsonScanner scanner = TestScanner("{\"code\":0,\"message\":null,\"items\":[]}");
+    CHECK(TestString(scanner, "code", NULL));
+    CHECK(TestString(scanner, "message", NULL));
+    CHECK(TestString(scanner, "items", NULL));
+    return 0;
+}
+
+static int TestKeyPrefix(void) {
+    // Key must match whole, not just its start.
+    HttpJsonScanner scanner = TestScanner("{\"codes\":\"x\",\"cod\":\"y\",\"code\":\"z\"}");
+    CHECK(TestString(scanner, "code", "\"z\""));
+    return 0;
+}
+
+static int TestItems(void) {
+    // Same walk as batch response processing in HttpManager.
+    HttpJsonScanner scanner = TestScanner("{\"state\":{\"result\":{\"message\":\"done\",\"items\":["
+                                          "{\"code\":\"0\",\"message\":\"a\"} , {\"extra\":[1],\"code\":\"5\"},{\"message\":\"c\"}]}}}");
+    const char      *expected[] = { "\"0\"", "\"5\"", NULL };
+    size_t          count       = 0;
+    
+    CHECK(HttpJsonFindPath(&scanner, kResultPath, 2));
+    CHECK(TestString(scanner, "message", "\"done\""));
+    CHECK(HttpJsonFindKey(&scanner, "items"));
+    CHECK(HttpJsonExpect(&scanner, '['));
+    do {
+        CHECK(count < 3);
+        CHECK(TestString(scanner, "code", expected[count]));
+        count++;
+    } while (HttpJsonSkipValue(&scanner) && HttpJsonExpect(&scanner, ','));
+    CHECK(HttpJsonExpect(&scanner, ']'));
+    CHECK(count == 3);
+    return 0;
+}
+
+static int TestMalformed(void) {
+    static const char * const inputs[] = {
+        "",
+        "[]",
+        "{}",
+        "{\"state\":",
+        "{\"state\":{\"result\":{\"code\":\"0",
+        "{\"state\" {\"result\":{}}}",
+        "{\"other\":{\"x\":[1,2}, \"state\":{\"result\":{}}",
+        "{\"other\":\"unterminated, \"state\":{\"result\":{}}}"
+    };
+    
+    for (size_t loopIndex = 0; loopIndex < sizeof(inputs) / sizeof(inputs[0]); loopIndex++) {
+        HttpJsonScanner scanner = TestScanner(inputs[loopIndex]);
+        if (HttpJsonFindPath(&scanner, kResultPath, 2)) {
+            CHECK(TestString(scanner, "code", NULL));
+        }
+    }
+    
+    // Scanner must stay within given length even if there is valid JSON right behind it.
+    const char      *json       = "{\"code\":\"0\"}";
+    HttpJsonScanner scanner     = HttpJsonScannerMake(json, strlen(json) - 3);
+    CHECK(TestString(scanner, "code", NULL));
+    return 0;
+}
+
+static int TestSkipValue(void) {
+    HttpJsonScanner scanner = TestScanner("  123 , \"a,b\" , {\"x\":[1,{}]} , true]");
+    CHECK(HttpJsonSkipValue(&scanner));
+    CHECK(HttpJsonExpect(&scanner, ','));
+    CHECK(HttpJsonSkipValue(&scanner));
+    CHECK(HttpJsonExpect(&scanner, ','));
+    CHECK(HttpJsonSkipValue(&scanner));
+    CHECK(HttpJsonExpect(&scanner, ','));
+    CHECK(HttpJsonSkipValue(&scanner));
+    CHECK(!HttpJsonSkipValue(&scanner));
+    CHECK(HttpJsonExpect(&scanner, ']'));
+    return 0;
+}
+
+static int TestEscape(void) {
+    static const struct {
+        const char *value;
+        const char *expected;
+    } cases[] = {
+        { "",                   "" },
+        { "12345678",           "12345678" },
+        { "say \"hi\"",         "say \\\"hi\\\"" },
+        { "back\\slash",        "back\\\\slash" },
+        { "line\nfeed\r\ttab",  "line\\nfeed\\r\\ttab" },
+        { "\x01" "bell\x07\x1f", "\\u0001bell\\u0007\\u001f" },
+        { "\xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88 / </>", "\xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88 / </>" }
+    };
+    
+    for (size_t loopIndex = 0; loopIndex < sizeof(cases) / sizeof(cases[0]); loopIndex++) {
+        // Length is computed first, then the value is written right into place. Nothing may be written behind it.
+        char    target[64];
+        size_t  length = HttpJsonEscape(cases[loopIndex].value, NULL);
+        memset(target, '#', sizeof(target));
+        CHECK(length == strlen(cases[loopIndex].expected));
+        CHECK(HttpJsonEscape(cases[loopIndex].value, target) == length);
+        CHECK(!memcmp(target, cases[loopIndex].expected, length));
+        CHECK(target[length] == '#');
+    }
+    return 0;
+}
+
+static int TestTemplate(void) {
+    // Same assembly as HttpManager request body. Escaped values between literals form valid request.
+    const char  *values[]   = { "user \"one\"", "123\n456" };
+    const char  *expected   = "{\"name\":\"Auth_OTP\",\"input\":{\"userId\":\"user \\\"one\\\"\",\"otp\":\"123\\n456\"}}";
+    char        body[128];
+    size_t      length      = 0;
+    
+    for (size_t loopIndex = 0; loopIndex < 3; loopIndex++) {
+        memcpy(body + length, kHttpJsonAuthOtp[loopIndex].bytes, kHttpJsonAuthOtp[loopIndex].length);
+        length += kHttpJsonAuthOtp[loopIndex].length;
+        if (loopIndex < 2) {
+            length += HttpJsonEscape(values[loopIndex], body + length);
+        }
+    }
+    CHECK(length == strlen(expected));
+    CHECK(!memcmp(body, expected, length));
+    
+    // Response scanner reads the same values back.
+    HttpJsonScanner scanner = HttpJsonScannerMake(body, length);
+    CHECK(HttpJsonFindKey(&scanner, "input"));
+    CHECK(TestString(scanner, "otp", "\"123\\n456\""));
+    return 0;
+}
+
+// MARK: - Runner
+
+typedef struct {
+    const char  *name;
+    int         (*run)(void);
+} TestCase;
+
+static const TestCase kTests[] = {
+    { "ResultPath",     TestResultPath },
+    { "SkipBlobs",      TestSkipBlobs },
+    { "EscapedValue",   TestEscapedValue },
+    { "NotString",      TestNotString },
+    { "KeyPrefix",      TestKeyPrefix },
+    { "Items",          TestItems },
+    { "Malformed",      TestMalformed },
+    { "SkipValue",      TestSkipValue },
+    { "Escape",         TestEscape },
+    { "Template",       TestTemplate }
+};
+
+int main(void) {
+    int failures = 0;
+    
+    for (size_t loopIndex = 0; loopIndex < sizeof(kTests) / sizeof(kTests[0]); loopIndex++) {
+        int failed = kTests[loopIndex].run();
+        printf("%-16s %s\n", kTests[loopIndex].name, failed ? "FAILED" : "OK");
+        failures += failed;
+    }
+    
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,753 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// Headless load generator of Auth_OTP / Sign_OTP / Sign_OTP_Batch protocol used by HttpManager.
+// Request bodies are written from the same templates and responses read with the same scanner as in the app.
+// Usage: loadgen [options], see loadgen --help.
+
+#include "HttpJson.h"
+#include "LoadGenHttp.h"
+#include "LoadGenServer.h"
+#include "LoadGenTls.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Latency histogram has 8 linear sub-buckets for each power of two microseconds.
+// Relative error of any bucket is below 12.5 %, whole 64-bit range fits to fixed array.
+#define kHistogramSubBits       3
+#define kHistogramSubBuckets    (1u << kHistogramSubBits)
+#define kHistogramBuckets       ((64 - kHistogramSubBits + 1) * kHistogramSubBuckets)
+#define kHistogramBarWidth      40
+
+#define kNanosPerSecond         1000000000ull
+
+typedef enum {
+    LoadGenEndpointAuthOtp,
+    LoadGenEndpointSignOtp,
+    LoadGenEndpointSignOtpBatch,
+    LoadGenEndpointCount
+} LoadGenEndpoint;
+
+typedef enum {
+    // Connection could not be opened.
+    LoadGenErrorConnect,
+    // Connection broke while request was sent or response received.
+    LoadGenErrorTransport,
+    // Server answered with other status than 201.
+    LoadGenErrorStatus,
+    // Response does not contain result object.
+    LoadGenErrorMalformed,
+    // Server refused OTP. Valid answer, but not a successful verification.
+    LoadGenErrorRejected,
+    LoadGenErrorCount
+} LoadGenError;
+
+static const char * const kEndpointNames[]  = { "Auth_OTP", "Sign_OTP", "Sign_OTP_Batch" };
+static const char * const kErrorNames[]     = { "connect", "transport", "status", "malformed", "rejected" };
+
+// Same success codes HttpManager compares results with. Batch items carry sign verdict.
+static const char kAuthSuccess[] = "\"0\"";
+static const char kSignSuccess[] = "\"Signature verification succeeded\"";
+
+typedef struct {
+    const char  *host;
+    const char  *port;
+    const char  *path;
+    const char  *userPrefix;
+    unsigned    users;
+    double      rate;
+    uint64_t    requests;
+    double      duration;
+    double      signRatio;
+    unsigned    batch;
+    unsigned    serverDelay;
+    double      rejectRatio;
+    bool        tls;
+    bool        reconnect;
+    bool        compareReconnect;
+    bool        failOnError;
+} LoadGenOptions;
+
+typedef struct {
+    uint64_t    count;
+    uint64_t    sum;
+    uint64_t    max;
+    uint64_t    buckets[kHistogramBuckets];
+} LoadGenHistogram;
+
+typedef struct {
+    uint64_t    count;
+    uint64_t    success;
+    uint64_t    items;
+    uint64_t    itemSuccess;
+    uint64_t            errors[LoadGenErrorCount];
+    // Whole request, from scheduled start to last byte of response.
+    LoadGenHistogram    latency;
+    // From scheduled start to first byte of response, including connection setup.
+    LoadGenHistogram    firstByte;
+} LoadGenStats;
+
+typedef struct {
+    const LoadGenOptions    *options;
+    struct addrinfo         *address;
+    LoadGenTlsContext       *tls;
+    uint64_t                start;
+    uint64_t                deadline;
+    _Atomic(uint64_t)       ticket;
+} LoadGenRun;
+
+typedef struct {
+    LoadGenRun      *run;
+    pthread_t       thread;
+    unsigned        index;
+    uint64_t        random;
+    uint64_t        connections;
+    LoadGenStats    stats[LoadGenEndpointCount];
+} LoadGenUser;
+
+// MARK: - Helpers
+
+static uint64_t LoadGenNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * kNanosPerSecond + (uint64_t)now.tv_nsec;
+}
+
+static void LoadGenSleepUntil(uint64_t time) {
+    struct timespec until = { (time_t)(time / kNanosPerSecond), (long)(time % kNanosPerSecond) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+    }
+}
+
+static uint64_t LoadGenRandom(uint64_t *state) {
+    // xorshift64*. Good enough for OTP digits and endpoint mix, and deterministic for given user.
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ull;
+}
+
+static size_t LoadGenBucket(uint64_t micros) {
+    if (micros < kHistogramSubBuckets) {
+        return (size_t)micros;
+    }
+    
+    unsigned msb = 63u - (unsigned)__builtin_clzll(micros);
+    return (msb - kHistogramSubBits + 1) * kHistogramSubBuckets + ((micros >> (msb - kHistogramSubBits)) & (kHistogramSubBuckets - 1));
+}
+
+static uint64_t LoadGenBucketLimit(size_t bucket) {
+    // Highest value which still falls to given bucket.
+    if (bucket < kHistogramSubBuckets) {
+        return bucket;
+    }
+    
+    unsigned shift = (unsigned)(bucket / kHistogramSubBuckets) - 1;
+    return (((uint64_t)(kHistogramSubBuckets + bucket % kHistogramSubBuckets) << shift) - 1) + (1ull << shift);
+}
+
+static void LoadGenHistogramRecord(LoadGenHistogram *histogram, uint64_t micros) {
+    histogram->count++;
+    histogram->sum += micros;
+    histogram->max  = micros > histogram->max ? micros : histogram->max;
+    histogram->buckets[LoadGenBucket(micros)]++;
+}
+
+static void LoadGenHistogramAdd(LoadGenHistogram *target, const LoadGenHistogram *source) {
+    target->count  += source->count;
+    target->sum    += source->sum;
+    target->max     = source->max > target->max ? source->max : target->max;
+    for (size_t loopBucket = 0; loopBucket < kHistogramBuckets; loopBucket++) {
+        target->buckets[loopBucket] += source->buckets[loopBucket];
+    }
+}
+
+static double LoadGenPercentile(const LoadGenHistogram *histogram, double percentile) {
+    if (!histogram->count) {
+        return 0;
+    }
+    
+    // Nearest rank method, same as timing report of HttpManager. Value is upper bound of the bucket, but never above maximum.
+    uint64_t rank   = (uint64_t)((percentile / 100.) * (double)histogram->count + 0.999999);
+    uint64_t seen   = 0;
+    for (size_t loopBucket = 0; loopBucket < kHistogramBuckets; loopBucket++) {
+        seen += histogram->buckets[loopBucket];
+        if (seen >= rank) {
+            uint64_t limit = LoadGenBucketLimit(loopBucket);
+            return (double)(limit < histogram->max ? limit : histogram->max) / 1000.;
+        }
+    }
+    
+    return (double)histogram->max / 1000.;
+}
+
+static double LoadGenMean(const LoadGenHistogram *histogram) {
+    return histogram->count ? (double)histogram->sum / (double)histogram->count / 1000. : 0;
+}
+
+static void LoadGenStatsAdd(LoadGenStats *target, const LoadGenStats *source) {
+    target->count       += source->count;
+    target->success     += source->success;
+    target->items       += source->items;
+    target->itemSuccess += source->itemSuccess;
+    for (size_t loopError = 0; loopError < LoadGenErrorCount; loopError++) {
+        target->errors[loopError] += source->errors[loopError];
+    }
+    LoadGenHistogramAdd(&target->latency, &source->latency);
+    LoadGenHistogramAdd(&target->firstByte, &source->firstByte);
+}
+
+// MARK: - Requests
+
+static int LoadGenAppendValue(LoadGenBuffer *body, const char *value) {
+    // Escaped right into the buffer, same as HttpManager does with request body.
+    size_t  length = HttpJsonEscape(value, NULL);
+    int     result = LoadGenBufferReserve(body, length);
+    if (!result) {
+        HttpJsonEscape(value, body->bytes + body->length);
+        body->length += length;
+    }
+    
+    return result;
+}
+
+static int LoadGenAppendLiteral(LoadGenBuffer *body, HttpJsonLiteral literal) {
+    return LoadGenBufferAppend(body, literal.bytes, literal.length);
+}
+
+static void LoadGenTransaction(LoadGenUser *user, char *otp, char *amount, char *beneficiary) {
+    uint64_t cents = LoadGenRandom(&user->random) % 1000000u;
+    snprintf(otp, 16, "%08" PRIu64, LoadGenRandom(&user->random) % 100000000u);
+    snprintf(amount, 32, "%" PRIu64 ".%02" PRIu64, cents / 100, cents % 100);
+    snprintf(beneficiary, 32, "Beneficiary %" PRIu64, LoadGenRandom(&user->random) % 1000u);
+}
+
+static int LoadGenEncode(LoadGenUser *user, LoadGenEndpoint endpoint, LoadGenBuffer *body) {
+    char userId[64];
+    char otp[16];
+    char amount[32];
+    char beneficiary[32];
+    
+    snprintf(userId, sizeof(userId), "%s%u", user->run->options->userPrefix, user->index);
+    LoadGenTransaction(user, otp, amount, beneficiary);
+    
+    body->length = 0;
+    if (endpoint == LoadGenEndpointAuthOtp) {
+        return LoadGenAppendLiteral(body, kHttpJsonAuthOtp[0]) ||
+               LoadGenAppendValue(body, userId) ||
+               LoadGenAppendLiteral(body, kHttpJsonAuthOtp[1]) ||
+               LoadGenAppendValue(body, otp) ||
+               LoadGenAppendLiteral(body, kHttpJsonAuthOtp[2]) ? ENOMEM : 0;
+    }
+    
+    if (endpoint == LoadGenEndpointSignOtp) {
+        return LoadGenAppendLiteral(body, kHttpJsonSignOtp[0]) ||
+               LoadGenAppendValue(body, userId) ||
+               LoadGenAppendLiteral(body, kHttpJsonSignOtp[1]) ||
+               LoadGenAppendValue(body, otp) ||
+               LoadGenAppendLiteral(body, kHttpJsonSignOtp[2]) ||
+               LoadGenAppendValue(body, amount) ||
+               LoadGenAppendLiteral(body, kHttpJsonSignOtp[3]) ||
+               LoadGenAppendValue(body, beneficiary) ||
+               LoadGenAppendLiteral(body, kHttpJsonSignOtp[4]) ? ENOMEM : 0;
+    }
+    
+    // Same item order as sendSignRequests: in HttpManager.
+    int result = LoadGenAppendLiteral(body, kHttpJsonSignOtpBatch[0]) ||
+                 LoadGenAppendValue(body, userId) ||
+                 LoadGenAppendLiteral(body, kHttpJsonSignOtpBatch[1]);
+    for (unsigned index = 0; index < user->run->options->batch && !result; index++) {
+        if (index) {
+            LoadGenTransaction(user, otp, amount, beneficiary);
+        }
+        result = LoadGenAppendLiteral(body, kHttpJsonSignOtpBatch[index ? 3 : 2]) ||
+                 LoadGenAppendValue(body, otp) ||
+                 LoadGenAppendLiteral(body, kHttpJsonSignOtpBatch[4]) ||
+                 LoadGenAppendValue(body, amount) ||
+                 LoadGenAppendLiteral(body, kHttpJsonSignOtpBatch[5]) ||
+                 LoadGenAppendValue(body, beneficiary) ||
+                 LoadGenAppendLiteral(body, kHttpJsonSignOtpBatch[6]);
+    }
+    
+    return result || LoadGenAppendLiteral(body, kHttpJsonSignOtpBatch[7]) ? ENOMEM : 0;
+}
+
+static bool LoadGenIsCode(HttpJsonScanner scanner, const char *expected, size_t expectedLength) {
+    const char  *literal    = NULL;
+    size_t      length      = 0;
+    return HttpJsonFindString(scanner, "code", &literal, &length) && length == expectedLength && !memcmp(literal, expected, length);
+}
+
+static LoadGenError LoadGenClassify(const LoadGenHttpMessage *response, unsigned batch, LoadGenStats *stats, bool *success) {
+    // Same checks as HttpManager processResponse: status 201, result object and its code.
+    *success = false;
+    if (response->headLength < 12 || memcmp(response->head + 9, "201", 3)) {
+        return LoadGenErrorStatus;
+    }
+    
+    HttpJsonScanner scanner = HttpJsonScannerMake(response->body, response->bodyLength);
+    if (!HttpJsonFindPath(&scanner, kHttpJsonResultPath, 2)) {
+        return LoadGenErrorMalformed;
+    }
+    if (!batch) {
+        const char  *literal    = NULL;
+        size_t      length      = 0;
+        if (!HttpJsonFindString(scanner, "code", &literal, &length)) {
+            return LoadGenErrorMalformed;
+        }
+        *success = length == sizeof(kAuthSuccess) - 1 && !memcmp(literal, kAuthSuccess, length);
+        return LoadGenErrorRejected;
+    }
+    
+    // Same walk as processBatchResponse. Server must return verdict for each item.
+    unsigned count      = 0;
+    unsigned succeeded  = 0;
+    if (HttpJsonFindKey(&scanner, "items") && HttpJsonExpect(&scanner, '[')) {
+        HttpJsonScanner empty = scanner;
+        if (HttpJsonExpect(&empty, ']')) {
+            scanner = empty;
+        } else {
+            do {
+                succeeded += LoadGenIsCode(scanner, kSignSuccess, sizeof(kSignSuccess) - 1);
+                count++;
+            } while (HttpJsonSkipValue(&scanner) && HttpJsonExpect(&scanner, ','));
+            if (!HttpJsonExpect(&scanner, ']')) {
+                count = 0;
+            }
+        }
+    }
+    if (count != batch) {
+        return LoadGenErrorMalformed;
+    }
+    
+    stats->items        += count;
+    stats->itemSuccess  += succeeded;
+    *success             = succeeded == count;
+    return LoadGenErrorRejected;
+}
+
+static int LoadGenConnect(const LoadGenRun *run, LoadGenStream *stream) {
+    int fd = socket(run->address->ai_family, run->address->ai_socktype, run->address->ai_protocol);
+    if (fd < 0) {
+        return errno;
+    }
+    if (connect(fd, run->address->ai_addr, run->address->ai_addrlen)) {
+        int result = errno;
+        close(fd);
+        return result;
+    }
+    
+    int enabled = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+    
+    stream->fd  = fd;
+    stream->tls = NULL;
+    int result = run->tls ? LoadGenTlsConnect(run->tls, stream) : 0;
+    if (result) {
+        close(fd);
+        stream->fd = -1;
+    }
+    
+    return result;
+}
+
+static void LoadGenDisconnect(LoadGenStream *stream) {
+    if (stream->fd >= 0) {
+        LoadGenTlsClose(stream);
+        close(stream->fd);
+        stream->fd = -1;
+    }
+}
+
+// MARK: - Virtual users
+
+static void *LoadGenUserRun(void *context) {
+    LoadGenUser             *user       = context;
+    LoadGenRun              *run        = user->run;
+    const LoadGenOptions    *options    = run->options;
+    LoadGenBuffer           body        = { 0 };
+    LoadGenBuffer           request     = { 0 };
+    LoadGenBuffer           response    = { 0 };
+    LoadGenStream           stream      = { -1, NULL };
+    
+    for (;;) {
+        // Requests are scheduled globally at fixed rate and taken by whichever user is free.
+        uint64_t ticket     = atomic_fetch_add(&run->ticket, 1);
+        uint64_t scheduled  = run->start + (options->rate > 0 ? (uint64_t)((double)ticket * kNanosPerSecond / options->rate) : 0);
+        if ((options->requests && ticket >= options->requests) || (run->deadline && (scheduled > run->deadline || LoadGenNow() > run->deadline))) {
+            break;
+        }
+        LoadGenSleepUntil(scheduled);
+        
+        // With fixed rate, latency is measured from the time request should have been sent.
+        // Otherwise slow server would delay next requests and hide its own slowness.
+        uint64_t        begin       = options->rate > 0 ? scheduled : LoadGenNow();
+        uint64_t        firstByte   = 0;
+        bool            sign        = (LoadGenRandom(&user->random) % 1000u) < options->signRatio * 1000.;
+        LoadGenEndpoint endpoint    = !sign ? LoadGenEndpointAuthOtp : options->batch ? LoadGenEndpointSignOtpBatch : LoadGenEndpointSignOtp;
+        LoadGenStats    *stats      = &user->stats[endpoint];
+        LoadGenError    error       = LoadGenErrorTransport;
+        bool            success     = false;
+        
+        request.length = 0;
+        if (LoadGenEncode(user, endpoint, &body) ||
+            LoadGenBufferFormat(&request, "POST %s HTTP/1.1\r\nHost: %s:%s\r\nContent-Type: application/json\r\n"
+                                "Content-Length: %zu\r\nIdempotency-Key: %u-%" PRIu64 "\r\n\r\n",
+                                options->path, options->host, options->port, body.length, user->index, ticket) ||
+            LoadGenBufferAppend(&request, body.bytes, body.length)) {
+            fprintf(stderr, "Out of memory.\n");
+            break;
+        }
+        
+        // Connection is kept alive between requests, same as shared session of HttpManager.
+        // Handshake is part of measured time, so reconnecting shows what fresh session per request costs.
+        if (stream.fd < 0) {
+            if (LoadGenConnect(run, &stream)) {
+                error = LoadGenErrorConnect;
+            } else {
+                user->connections++;
+            }
+        }
+        if (stream.fd >= 0) {
+            LoadGenHttpMessage message;
+            if (!LoadGenHttpWrite(&stream, &request) && !LoadGenHttpWait(&stream) &&
+                (firstByte = LoadGenNow()) && !LoadGenHttpRead(&stream, &response, &message)) {
+                error = LoadGenClassify(&message, endpoint == LoadGenEndpointSignOtpBatch ? options->batch : 0, stats, &success);
+                LoadGenHttpConsume(&response, &message);
+            } else {
+                LoadGenDisconnect(&stream);
+                response.length = 0;
+            }
+        }
+        if (options->reconnect) {
+            LoadGenDisconnect(&stream);
+        }
+        
+        stats->count++;
+        LoadGenHistogramRecord(&stats->latency, (LoadGenNow() - begin) / 1000u);
+        if (firstByte) {
+            LoadGenHistogramRecord(&stats->firstByte, (firstByte - begin) / 1000u);
+        }
+        if (success) {
+            stats->success++;
+        } else {
+            stats->errors[error]++;
+        }
+    }
+    
+    LoadGenDisconnect(&stream);
+    LoadGenBufferFree(&body);
+    LoadGenBufferFree(&request);
+    LoadGenBufferFree(&response);
+    return NULL;
+}
+
+// MARK: - Report
+
+static void LoadGenPrintHistogram(const LoadGenHistogram *histogram) {
+    // Sub-buckets are merged to one row per power of two, so histogram fits to the screen.
+    uint64_t    rows[64 - kHistogramSubBits + 1]    = { 0 };
+    uint64_t    largest                             = 0;
+    size_t      first                               = sizeof(rows) / sizeof(rows[0]);
+    size_t      last                                = 0;
+    for (size_t loopBucket = 0; loopBucket < kHistogramBuckets; loopBucket++) {
+        size_t row = loopBucket / kHistogramSubBuckets;
+        rows[row] += histogram->buckets[loopBucket];
+        if (histogram->buckets[loopBucket]) {
+            first   = row < first ? row : first;
+            last    = row > last ? row : last;
+        }
+    }
+    for (size_t loopRow = first; loopRow <= last; loopRow++) {
+        largest = rows[loopRow] > largest ? rows[loopRow] : largest;
+    }
+    
+    for (size_t loopRow = first; loopRow <= last && largest; loopRow++) {
+        double  limit   = (double)LoadGenBucketLimit(loopRow * kHistogramSubBuckets + kHistogramSubBuckets - 1) / 1000.;
+        int     width   = (int)(rows[loopRow] * kHistogramBarWidth / largest);
+        printf("    <= %10.3f ms %10" PRIu64 " |%.*s\n", limit, rows[loopRow], width, "########################################");
+    }
+}
+
+static void LoadGenPrintTiming(const char *name, const LoadGenHistogram *histogram) {
+    printf("  %s ms: mean %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n", name, LoadGenMean(histogram),
+           LoadGenPercentile(histogram, 50), LoadGenPercentile(histogram, 90), LoadGenPercentile(histogram, 99),
+           (double)histogram->max / 1000.);
+}
+
+static bool LoadGenReport(const LoadGenUser *users, unsigned count, double elapsed, const LoadGenOptions *options, LoadGenStats *total) {
+    bool        failed      = false;
+    uint64_t    connections = 0;
+    for (unsigned loopUser = 0; loopUser < count; loopUser++) {
+        connections += users[loopUser].connections;
+    }
+    
+    printf("users %u, rate %s, %s, %s, connections %" PRIu64 ", elapsed %.3f s\n", count, options->rate > 0 ? "fixed" : "unlimited",
+           options->tls ? "https" : "http", options->reconnect ? "new connection per request" : "keep-alive", connections, elapsed);
+    for (LoadGenEndpoint loopEndpoint = 0; loopEndpoint < LoadGenEndpointCount; loopEndpoint++) {
+        LoadGenStats stats = { 0 };
+        for (unsigned loopUser = 0; loopUser < count; loopUser++) {
+            LoadGenStatsAdd(&stats, &users[loopUser].stats[loopEndpoint]);
+        }
+        LoadGenStatsAdd(total, &stats);
+        if (!stats.count) {
+            continue;
+        }
+        
+        printf("\n%s\n", kEndpointNames[loopEndpoint]);
+        printf("  requests %" PRIu64 ", succeeded %" PRIu64 ", throughput %.1f req/s\n",
+               stats.count, stats.success, elapsed > 0 ? (double)stats.count / elapsed : 0);
+        if (loopEndpoint == LoadGenEndpointSignOtpBatch) {
+            printf("  batch size %u, items %" PRIu64 ", succeeded %" PRIu64 ", throughput %.1f items/s\n",
+                   options->batch, stats.items, stats.itemSuccess, elapsed > 0 ? (double)stats.items / elapsed : 0);
+        }
+        LoadGenPrintTiming("latency", &stats.latency);
+        LoadGenPrintTiming("time to first byte", &stats.firstByte);
+        printf("  errors:");
+        for (LoadGenError loopError = 0; loopError < LoadGenErrorCount; loopError++) {
+            printf(" %s %" PRIu64 "%s", kErrorNames[loopError], stats.errors[loopError], loopError + 1 < LoadGenErrorCount ? "," : "\n");
+        }
+        LoadGenPrintHistogram(&stats.latency);
+        
+        // Rejected OTP is valid answer of the server. Anything else means protocol or network issue.
+        for (LoadGenError loopError = 0; loopError < LoadGenErrorRejected; loopError++) {
+            failed |= stats.errors[loopError] > 0;
+        }
+    }
+    
+    return !failed;
+}
+
+static void LoadGenReportReuse(const LoadGenStats *fresh, const LoadGenStats *reused) {
+    static const double percentiles[] = { 50, 90, 99 };
+    
+    printf("\ntime to first byte ms    new connection    keep-alive         saved\n");
+    printf("  mean              %16.3f %13.3f %13.3f\n", LoadGenMean(&fresh->firstByte), LoadGenMean(&reused->firstByte),
+           LoadGenMean(&fresh->firstByte) - LoadGenMean(&reused->firstByte));
+    for (size_t loopIndex = 0; loopIndex < sizeof(percentiles) / sizeof(percentiles[0]); loopIndex++) {
+        double freshValue   = LoadGenPercentile(&fresh->firstByte, percentiles[loopIndex]);
+        double reusedValue  = LoadGenPercentile(&reused->firstByte, percentiles[loopIndex]);
+        printf("  p%-16.0f %16.3f %13.3f %13.3f\n", percentiles[loopIndex], freshValue, reusedValue, freshValue - reusedValue);
+    }
+}
+
+// MARK: - Main
+
+static void LoadGenUsage(FILE *file) {
+    fprintf(file,
+            "Usage: loadgen [options]\n"
+            "  --users N           concurrent virtual users, each with own keep-alive connection (default 8)\n"
+            "  --rate R            total requests per second, 0 sends as fast as possible (default 0)\n"
+            "  --requests N        total number of requests, 0 means no limit (default 1000)\n"
+            "  --duration S        stop after S seconds, 0 means no limit (default 0)\n"
+            "  --sign-ratio X      share of Sign_OTP requests, rest is Auth_OTP (default 0.5)\n"
+            "  --batch N           send Sign_OTP as Sign_OTP_Batch with N transactions, 0 disables (default 0)\n"
+            "  --tls               use HTTPS, certificates are not verified (stand-in server uses self-signed one)\n"
+            "  --reconnect         open new connection for each request instead of keeping it alive\n"
+            "  --compare-reconnect run the load with new connection per request and then with keep-alive,\n"
+            "                      and report time to first byte saved by connection reuse\n"
+            "  --target HOST:PORT  server to load instead of local stand-in\n"
+            "  --path PATH         request path (default /)\n"
+            "  --user-prefix S     user id prefix, user index is appended (default loadgen-)\n"
+            "  --server-delay US   stand-in server think time in microseconds (default 0)\n"
+            "  --reject-ratio X    share of OTPs rejected by stand-in server (default 0)\n"
+            "  --fail-on-error     exit with failure if any request failed for other reason than rejected OTP\n");
+}
+
+static bool LoadGenParse(int argc, char *argv[], LoadGenOptions *options, char **target) {
+    static const struct option kOptions[] = {
+        { "users",              required_argument,  NULL, 'u' },
+        { "rate",               required_argument,  NULL, 'r' },
+        { "requests",           required_argument,  NULL, 'n' },
+        { "duration",           required_argument,  NULL, 'd' },
+        { "sign-ratio",         required_argument,  NULL, 's' },
+        { "batch",              required_argument,  NULL, 'b' },
+        { "tls",                no_argument,        NULL, 'T' },
+        { "reconnect",          no_argument,        NULL, 'c' },
+        { "compare-reconnect",  no_argument,        NULL, 'C' },
+        { "target",             required_argument,  NULL, 't' },
+        { "path",               required_argument,  NULL, 'p' },
+        { "user-prefix",        required_argument,  NULL, 'i' },
+        { "server-delay",       required_argument,  NULL, 'D' },
+        { "reject-ratio",       required_argument,  NULL, 'R' },
+        { "fail-on-error",      no_argument,        NULL, 'f' },
+        { "help",               no_argument,        NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    
+    for (int option; (option = getopt_long(argc, argv, "h", kOptions, NULL)) != -1;) {
+        switch (option) {
+            case 'u': options->users            = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'r': options->rate             = strtod(optarg, NULL); break;
+            case 'n': options->requests         = strtoull(optarg, NULL, 10); break;
+            case 'd': options->duration         = strtod(optarg, NULL); break;
+            case 's': options->signRatio        = strtod(optarg, NULL); break;
+            case 'b': options->batch            = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'T': options->tls              = true; break;
+            case 'c': options->reconnect        = true; break;
+            case 'C': options->compareReconnect = true; break;
+            case 't': *target                   = optarg; break;
+            case 'p': options->path             = optarg; break;
+            case 'i': options->userPrefix       = optarg; break;
+            case 'D': options->serverDelay      = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'R': options->rejectRatio      = strtod(optarg, NULL); break;
+            case 'f': options->failOnError      = true; break;
+            case 'h': LoadGenUsage(stdout); exit(EXIT_SUCCESS);
+            default: return false;
+        }
+    }
+    
+    // Run must end somehow.
+    return optind == argc && options->users > 0 && options->rate >= 0 && (options->requests || options->duration > 0) &&
+           options->signRatio >= 0 && options->signRatio <= 1 && options->rejectRatio >= 0 && options->rejectRatio <= 1;
+}
+
+static bool LoadGenExecute(const LoadGenOptions *options, struct addrinfo *address, LoadGenTlsContext *tls, LoadGenStats *total) {
+    LoadGenRun  run     = { .options = options, .address = address, .tls = tls };
+    LoadGenUser *users  = calloc(options->users, sizeof(LoadGenUser));
+    unsigned    started = 0;
+    if (!users) {
+        fprintf(stderr, "Out of memory.\n");
+        return false;
+    }
+    
+    run.start       = LoadGenNow();
+    run.deadline    = options->duration > 0 ? run.start + (uint64_t)(options->duration * kNanosPerSecond) : 0;
+    for (; started < options->users; started++) {
+        users[started].run      = &run;
+        users[started].index    = started;
+        users[started].random   = 0x9E3779B97F4A7C15ull * (started + 1);
+        if (pthread_create(&users[started].thread, NULL, LoadGenUserRun, &users[started])) {
+            fprintf(stderr, "Failed to start user %u.\n", started);
+            break;
+        }
+    }
+    for (unsigned loopUser = 0; loopUser < started; loopUser++) {
+        pthread_join(users[loopUser].thread, NULL);
+    }
+    double elapsed = (double)(LoadGenNow() - run.start) / kNanosPerSecond;
+    
+    bool retValue = LoadGenReport(users, started, elapsed, options, total) && started == options->users;
+    free(users);
+    return retValue;
+}
+
+int main(int argc, char *argv[]) {
+    LoadGenOptions options = {
+        .host       = "127.0.0.1",
+        .path       = "/",
+        .userPrefix = "loadgen-",
+        .users      = 8,
+        .requests   = 1000,
+        .signRatio  = 0.5
+    };
+    char                *target     = NULL;
+    char                port[8]     = { 0 };
+    LoadGenServer       *server     = NULL;
+    LoadGenTlsContext   *tls        = NULL;
+    
+    if (!LoadGenParse(argc, argv, &options, &target)) {
+        LoadGenUsage(stderr);
+        return EXIT_FAILURE;
+    }
+    if (options.tls && !LoadGenTlsAvailable()) {
+        fprintf(stderr, "Load generator was built without TLS support.\n");
+        return EXIT_FAILURE;
+    }
+    
+    // Broken connection is reported by send, not by signal.
+    signal(SIGPIPE, SIG_IGN);
+    
+    if (target) {
+        char *colon = strrchr(target, ':');
+        if (!colon) {
+            LoadGenUsage(stderr);
+            return EXIT_FAILURE;
+        }
+        *colon          = '\0';
+        options.host    = target;
+        options.port    = colon + 1;
+    } else {
+        LoadGenServerConfig config = { options.serverDelay, options.rejectRatio, options.tls };
+        int result = LoadGenServerStart(&config, &server);
+        if (result) {
+            fprintf(stderr, "Failed to start stand-in server: %s\n", strerror(result));
+            return EXIT_FAILURE;
+        }
+        snprintf(port, sizeof(port), "%u", LoadGenServerPort(server));
+        options.port = port;
+    }
+    
+    struct addrinfo hints       = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *address    = NULL;
+    int             result      = getaddrinfo(options.host, options.port, &hints, &address);
+    if (result) {
+        fprintf(stderr, "Failed to resolve %s: %s\n", options.host, gai_strerror(result));
+    } else if (options.tls && (result = LoadGenTlsClientCreate(&tls))) {
+        fprintf(stderr, "Failed to prepare TLS: %s\n", strerror(result));
+    }
+    
+    bool succeeded = !result;
+    if (succeeded && options.compareReconnect) {
+        // Same load twice. First pays for handshake with every request, second only once per user.
+        LoadGenStats fresh  = { 0 };
+        LoadGenStats reused = { 0 };
+        options.reconnect = true;
+        succeeded &= LoadGenExecute(&options, address, tls, &fresh);
+        options.reconnect = false;
+        printf("\n");
+        succeeded &= LoadGenExecute(&options, address, tls, &reused);
+        LoadGenReportReuse(&fresh, &reused);
+    } else if (succeeded) {
+        LoadGenStats total = { 0 };
+        succeeded = LoadGenExecute(&options, address, tls, &total);
+    }
+    
+    if (server) {
+        printf("\nstand-in server: %" PRIu64 " requests over %" PRIu64 " connections\n",
+               LoadGenServerRequestCount(server), LoadGenServerConnectionCount(server));
+        LoadGenServerStop(server);
+    }
+    
+    LoadGenTlsContextFree(tls);
+    if (address) {
+        freeaddrinfo(address);
+    }
+    return succeeded || (!options.failOnError && !result) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,238 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// memmem is GNU extension on Linux.
+#define _GNU_SOURCE
+
+#include "LoadGenHttp.h"
+#include "LoadGenTls.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define kLoadGenBufferMinCapacity   4096
+#define kLoadGenHeadMaxLength       16384
+
+// MARK: - Buffer
+
+int LoadGenBufferReserve(LoadGenBuffer *buffer, size_t additional) {
+    if (buffer->capacity - buffer->length >= additional) {
+        return 0;
+    }
+    
+    size_t capacity = buffer->capacity ? buffer->capacity : kLoadGenBufferMinCapacity;
+    while (capacity - buffer->length < additional) {
+        capacity *= 2;
+    }
+    
+    char *resized = realloc(buffer->bytes, capacity);
+    if (!resized) {
+        return ENOMEM;
+    }
+    buffer->bytes       = resized;
+    buffer->capacity    = capacity;
+    return 0;
+}
+
+int LoadGenBufferAppend(LoadGenBuffer *buffer, const void *bytes, size_t length) {
+    int result = LoadGenBufferReserve(buffer, length);
+    if (!result && length) {
+        memcpy(buffer->bytes + buffer->length, bytes, length);
+        buffer->length += length;
+    }
+    
+    return result;
+}
+
+int LoadGenBufferFormat(LoadGenBuffer *buffer, const char *format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+    if (length < 0) {
+        return EINVAL;
+    }
+    
+    // Formatter writes terminating zero as well. It's not part of the buffer.
+    int result = LoadGenBufferReserve(buffer, (size_t)length + 1);
+    if (!result) {
+        va_start(arguments, format);
+        vsnprintf(buffer->bytes + buffer->length, (size_t)length + 1, format, arguments);
+        va_end(arguments);
+        buffer->length += (size_t)length;
+    }
+    
+    return result;
+}
+
+void LoadGenBufferFree(LoadGenBuffer *buffer) {
+    free(buffer->bytes);
+    buffer->bytes       = NULL;
+    buffer->length      = 0;
+    buffer->capacity    = 0;
+}
+
+// MARK: - Messages
+
+int LoadGenHttpWrite(LoadGenStream *stream, const LoadGenBuffer *buffer) {
+    const char  *bytes  = buffer->bytes;
+    size_t      length  = buffer->length;
+    
+    while (length) {
+        ssize_t written = stream->tls ? LoadGenTlsSend(stream, bytes, length) : send(stream->fd, bytes, length, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        bytes   += written;
+        length  -= (size_t)written;
+    }
+    
+    return 0;
+}
+
+int LoadGenHttpWait(LoadGenStream *stream) {
+    // Data already decrypted by TLS would not wake poll.
+    if (stream->tls && LoadGenTlsPending(stream)) {
+        return 0;
+    }
+    
+    struct pollfd fds = { .fd = stream->fd, .events = POLLIN };
+    for (;;) {
+        int result = poll(&fds, 1, -1);
+        if (result > 0) {
+            return 0;
+        }
+        if (result < 0 && errno != EINTR) {
+            return errno;
+        }
+    }
+}
+
+static int LoadGenHttpReceive(LoadGenStream *stream, LoadGenBuffer *buffer) {
+    int result = LoadGenBufferReserve(buffer, kLoadGenBufferMinCapacity);
+    while (!result) {
+        char    *target     = buffer->bytes + buffer->length;
+        size_t  available   = buffer->capacity - buffer->length;
+        ssize_t received    = stream->tls ? LoadGenTlsReceive(stream, target, available) : recv(stream->fd, target, available, 0);
+        if (received > 0) {
+            buffer->length += (size_t)received;
+            break;
+        }
+        result = received == 0 ? ECONNRESET : errno == EINTR ? 0 : errno;
+    }
+    
+    return result;
+}
+
+int LoadGenHttpRead(LoadGenStream *stream, LoadGenBuffer *buffer, LoadGenHttpMessage *message) {
+    // Wait for whole head first. It tells how long the body is.
+    const char *headEnd = NULL;
+    while (!(headEnd = buffer->length ? memmem(buffer->bytes, buffer->length, "\r\n\r\n", 4) : NULL)) {
+        if (buffer->length > kLoadGenHeadMaxLength) {
+            return EPROTO;
+        }
+        int result = LoadGenHttpReceive(stream, buffer);
+        if (result) {
+            return result;
+        }
+    }
+    
+    message->head       = buffer->bytes;
+    message->headLength = (size_t)(headEnd - buffer->bytes) + 4;
+    message->body       = NULL;
+    message->bodyLength = 0;
+    
+    const char  *value  = NULL;
+    size_t      length  = 0;
+    if (!LoadGenHttpHeader(message, "Content-Length", &value, &length)) {
+        return EPROTO;
+    }
+    
+    char    *end        = NULL;
+    size_t  bodyLength  = (size_t)strtoul(value, &end, 10);
+    if (end == value || end > value + length) {
+        return EPROTO;
+    }
+    
+    // Receiving may move the buffer. Message pointers are set only once everything is here.
+    while (buffer->length - message->headLength < bodyLength) {
+        int result = LoadGenHttpReceive(stream, buffer);
+        if (result) {
+            return result == ECONNRESET ? EPROTO : result;
+        }
+    }
+    
+    message->head       = buffer->bytes;
+    message->body       = buffer->bytes + message->headLength;
+    message->bodyLength = bodyLength;
+    return 0;
+}
+
+void LoadGenHttpConsume(LoadGenBuffer *buffer, const LoadGenHttpMessage *message) {
+    size_t used = message->headLength + message->bodyLength;
+    memmove(buffer->bytes, buffer->bytes + used, buffer->length - used);
+    buffer->length -= used;
+}
+
+bool LoadGenHttpHeader(const LoadGenHttpMessage *message, const char *name, const char **value, size_t *length) {
+    size_t      nameLength  = strlen(name);
+    const char  *end        = message->head + message->headLength;
+    
+    // First line is request or status line. Headers follow, one per line.
+    const char *line = memmem(message->head, message->headLength, "\r\n", 2);
+    while (line && line + 2 < end) {
+        line += 2;
+        const char *lineEnd = memmem(line, (size_t)(end - line), "\r\n", 2);
+        if (!lineEnd) {
+            break;
+        }
+        
+        if ((size_t)(lineEnd - line) > nameLength && line[nameLength] == ':' && !strncasecmp(line, name, nameLength)) {
+            const char *start = line + nameLength + 1;
+            while (start < lineEnd && (*start == ' ' || *start == '\t')) {
+                start++;
+            }
+            *value  = start;
+            *length = (size_t)(lineEnd - start);
+            return true;
+        }
+        line = lineEnd;
+    }
+    
+    return false;
+}
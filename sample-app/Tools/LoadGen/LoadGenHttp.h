@@ -0,0 +1,127 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#ifndef LoadGenHttp_h
+#define LoadGenHttp_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ Minimal HTTP/1.1 framing shared by load generator and its stand-in server.
+ Only messages with Content-Length are supported. That's all HttpManager sends and all the server answers.
+ */
+
+/**
+ Connection of client or server. Plain TCP, or TLS once handshake is done.
+ */
+typedef struct {
+    int     fd;
+    // SSL of TLS connection, NULL for plain TCP.
+    void    *tls;
+} LoadGenStream;
+
+/**
+ Growing byte buffer. Zero initialized buffer is empty and valid.
+ */
+typedef struct {
+    char    *bytes;
+    size_t  length;
+    size_t  capacity;
+} LoadGenBuffer;
+
+/**
+ One message framed in buffer. Pointers are valid until buffer is changed.
+ */
+typedef struct {
+    const char  *head;
+    size_t      headLength;
+    const char  *body;
+    size_t      bodyLength;
+} LoadGenHttpMessage;
+
+/**
+ Make sure that at least given number of bytes can be appended without reallocation.
+
+ @return 0 on success, ENOMEM otherwise.
+ */
+int LoadGenBufferReserve(LoadGenBuffer *buffer, size_t additional);
+
+/**
+ Append bytes to buffer.
+
+ @return 0 on success, ENOMEM otherwise.
+ */
+int LoadGenBufferAppend(LoadGenBuffer *buffer, const void *bytes, size_t length);
+
+/**
+ Append formatted string to buffer.
+
+ @return 0 on success, ENOMEM otherwise.
+ */
+int LoadGenBufferFormat(LoadGenBuffer *buffer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ Release buffer memory. Buffer is empty and valid afterwards.
+ */
+void LoadGenBufferFree(LoadGenBuffer *buffer);
+
+/**
+ Write whole buffer to stream.
+
+ @return 0 on success, errno otherwise.
+ */
+int LoadGenHttpWrite(LoadGenStream *stream, const LoadGenBuffer *buffer);
+
+/**
+ Wait until first byte of response arrives. Used to measure time to first byte.
+
+ @return 0 on success, errno otherwise.
+ */
+int LoadGenHttpWait(LoadGenStream *stream);
+
+/**
+ Read one message. Bytes of previous message must be consumed first. Bytes of next message stay in buffer.
+
+ @param stream Connected stream.
+ @param buffer Receive buffer kept for whole connection.
+ @param message Framed message.
+ @return 0 on success, ECONNRESET when peer closed connection, EPROTO on malformed message, errno otherwise.
+ */
+int LoadGenHttpRead(LoadGenStream *stream, LoadGenBuffer *buffer, LoadGenHttpMessage *message);
+
+/**
+ Drop message from start of buffer once it's processed.
+ */
+void LoadGenHttpConsume(LoadGenBuffer *buffer, const LoadGenHttpMessage *message);
+
+/**
+ Find header value. Names are compared without case.
+
+ @return true if header was found.
+ */
+bool LoadGenHttpHeader(const LoadGenHttpMessage *message, const char *name, const char **value, size_t *length);
+
+#endif /* LoadGenHttp_h */
@@ -0,0 +1,333 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#include "LoadGenServer.h"
+#include "LoadGenHttp.h"
+#include "LoadGenTls.h"
+#include "HttpJson.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define kServerResult(__CODE__, __MESSAGE__) "{\"state\":{\"result\":{\"code\":\"" __CODE__ "\",\"message\":\"" __MESSAGE__ "\"}}}"
+
+typedef struct LoadGenConnection {
+    struct LoadGenConnection    *next;
+    LoadGenServer               *server;
+    pthread_t                   thread;
+    LoadGenStream               stream;
+} LoadGenConnection;
+
+struct LoadGenServer {
+    LoadGenServerConfig config;
+    LoadGenTlsContext   *tls;
+    int                 listenFd;
+    int                 wakeFds[2];
+    uint16_t            port;
+    pthread_t           acceptThread;
+    pthread_mutex_t     lock;
+    LoadGenConnection   *connections;
+    _Atomic(uint64_t)   requestCount;
+    _Atomic(uint64_t)   connectionCount;
+    _Atomic(uint64_t)   verificationCount;
+};
+
+// MARK: - Requests
+
+static bool LoadGenServerHasString(HttpJsonScanner scanner, const char *key) {
+    const char  *literal    = NULL;
+    size_t      length      = 0;
+    return HttpJsonFindString(scanner, key, &literal, &length);
+}
+
+static bool LoadGenServerIsName(HttpJsonScanner scanner, const char *name) {
+    const char  *literal    = NULL;
+    size_t      length      = 0;
+    size_t      nameLength  = strlen(name);
+    
+    // Literal includes quotes.
+    return HttpJsonFindString(scanner, "name", &literal, &length) && length == nameLength + 2 && !memcmp(literal + 1, name, nameLength);
+}
+
+static bool LoadGenServerReject(LoadGenServer *server) {
+    // Rejections are spread evenly, so even short run gets configured share.
+    uint64_t ticket = atomic_fetch_add(&server->verificationCount, 1);
+    return floor((double)(ticket + 1) * server->config.rejectRatio) > floor((double)ticket * server->config.rejectRatio);
+}
+
+static bool LoadGenServerIsTransaction(HttpJsonScanner scanner) {
+    // Scanner points to object with OTP and transaction data. Single request and batch item look the same.
+    HttpJsonScanner transaction = scanner;
+    return LoadGenServerHasString(scanner, "otp") && HttpJsonFindKey(&transaction, "transactionData") &&
+           LoadGenServerHasString(transaction, "amount") && LoadGenServerHasString(transaction, "beneficiary");
+}
+
+static bool LoadGenServerAnswerBatch(LoadGenServer *server, HttpJsonScanner input, LoadGenBuffer *content) {
+    // Verdict of each item is in its own code. Batch as a whole was processed.
+    HttpJsonScanner items   = input;
+    bool            valid   = LoadGenServerHasString(input, "userId") && HttpJsonFindKey(&items, "transactions") && HttpJsonExpect(&items, '[');
+    
+    LoadGenBufferFormat(content, "{\"state\":{\"result\":{\"code\":\"0\",\"message\":\"Batch processed\",\"items\":[");
+    HttpJsonScanner empty = items;
+    if (valid && !HttpJsonExpect(&empty, ']')) {
+        size_t count = 0;
+        do {
+            if (!LoadGenServerIsTransaction(items)) {
+                return false;
+            }
+            LoadGenBufferFormat(content, "%s{\"code\":\"%s\"}", count++ ? "," : "",
+                                LoadGenServerReject(server) ? "Signature verification failed" : "Signature verification succeeded");
+        } while (HttpJsonSkipValue(&items) && HttpJsonExpect(&items, ','));
+        valid = HttpJsonExpect(&items, ']');
+    }
+    
+    return valid && !LoadGenBufferFormat(content, "]}}}");
+}
+
+static int LoadGenServerAnswer(LoadGenServer *server, const LoadGenHttpMessage *request, LoadGenBuffer *content, LoadGenBuffer *response) {
+    HttpJsonScanner body    = HttpJsonScannerMake(request->body, request->bodyLength);
+    HttpJsonScanner input   = body;
+    int             status  = 400;
+    
+    content->length = 0;
+    bool hasInput = HttpJsonFindKey(&input, "input");
+    if (request->headLength < 5 || memcmp(request->head, "POST ", 5)) {
+        status = 405;
+    } else if (LoadGenServerIsName(body, "Auth_OTP")) {
+        if (hasInput && LoadGenServerHasString(input, "userId") && LoadGenServerHasString(input, "otp")) {
+            status = 201;
+            LoadGenBufferFormat(content, "%s", LoadGenServerReject(server) ?
+                                kServerResult("1", "OTP verification failed") : kServerResult("0", "OTP verification succeeded"));
+        }
+    } else if (LoadGenServerIsName(body, "Sign_OTP")) {
+        if (hasInput && LoadGenServerHasString(input, "userId") && LoadGenServerIsTransaction(input)) {
+            status = 201;
+            LoadGenBufferFormat(content, "%s", LoadGenServerReject(server) ?
+                                kServerResult("1", "Signature verification failed") : kServerResult("0", "Signature verification succeeded"));
+        }
+    } else if (LoadGenServerIsName(body, "Sign_OTP_Batch")) {
+        if (hasInput && LoadGenServerAnswerBatch(server, input, content)) {
+            status = 201;
+        }
+    } else {
+        status = 404;
+    }
+    
+    if (status != 201) {
+        content->length = 0;
+        LoadGenBufferFormat(content, "{}");
+    }
+    if (server->config.delayMicros) {
+        usleep(server->config.delayMicros);
+    }
+    
+    const char *reason = status == 201 ? "Created" : status == 404 ? "Not Found" : status == 405 ? "Method Not Allowed" : "Bad Request";
+    return LoadGenBufferFormat(response, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+                               status, reason, content->length) ||
+           LoadGenBufferAppend(response, content->bytes, content->length);
+}
+
+// MARK: - Connections
+
+static void *LoadGenServerConnectionRun(void *context) {
+    LoadGenConnection   *connection = context;
+    LoadGenBuffer       request     = { 0 };
+    LoadGenBuffer       content     = { 0 };
+    LoadGenBuffer       response    = { 0 };
+    LoadGenHttpMessage  message;
+    
+    // Handshake runs here, so slow client does not block accepting of others.
+    LoadGenStream   *stream = &connection->stream;
+    bool            ready   = !connection->server->tls || !LoadGenTlsAccept(connection->server->tls, stream);
+    
+    // Keep-alive. Serve requests until client closes connection or server is stopped.
+    while (ready && !LoadGenHttpRead(stream, &request, &message)) {
+        response.length = 0;
+        if (LoadGenServerAnswer(connection->server, &message, &content, &response) || LoadGenHttpWrite(stream, &response)) {
+            break;
+        }
+        atomic_fetch_add(&connection->server->requestCount, 1);
+        LoadGenHttpConsume(&request, &message);
+    }
+    
+    // Socket is closed by server stop, so it can't be reused while stop still refers to it.
+    shutdown(stream->fd, SHUT_RDWR);
+    LoadGenBufferFree(&request);
+    LoadGenBufferFree(&content);
+    LoadGenBufferFree(&response);
+    return NULL;
+}
+
+static void *LoadGenServerAcceptRun(void *context) {
+    LoadGenServer *server = context;
+    
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = server->listenFd, .events = POLLIN },
+            { .fd = server->wakeFds[0], .events = POLLIN }
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        
+        int fd = accept(server->listenFd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        
+        // Responses are small. Do not let Nagle hold them back.
+        int enabled = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        
+        LoadGenConnection *connection = calloc(1, sizeof(LoadGenConnection));
+        if (!connection) {
+            close(fd);
+            continue;
+        }
+        connection->server      = server;
+        connection->stream.fd   = fd;
+        
+        pthread_mutex_lock(&server->lock);
+        if (pthread_create(&connection->thread, NULL, LoadGenServerConnectionRun, connection)) {
+            close(fd);
+            free(connection);
+        } else {
+            connection->next    = server->connections;
+            server->connections = connection;
+            atomic_fetch_add(&server->connectionCount, 1);
+        }
+        pthread_mutex_unlock(&server->lock);
+    }
+    
+    return NULL;
+}
+
+// MARK: - Public API
+
+int LoadGenServerStart(const LoadGenServerConfig *config, LoadGenServer **server) {
+    LoadGenServer *retValue = calloc(1, sizeof(LoadGenServer));
+    if (!retValue) {
+        return ENOMEM;
+    }
+    retValue->config        = *config;
+    retValue->listenFd      = -1;
+    retValue->wakeFds[0]    = -1;
+    retValue->wakeFds[1]    = -1;
+    pthread_mutex_init(&retValue->lock, NULL);
+    
+    struct sockaddr_in  address = { 0 };
+    socklen_t           length  = sizeof(address);
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    int result = config->tls ? LoadGenTlsServerCreate(&retValue->tls) : 0;
+    if (!result) {
+        retValue->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (retValue->listenFd < 0 ||
+            bind(retValue->listenFd, (struct sockaddr *)&address, sizeof(address)) ||
+            listen(retValue->listenFd, SOMAXCONN) ||
+            getsockname(retValue->listenFd, (struct sockaddr *)&address, &length) ||
+            pipe(retValue->wakeFds)) {
+            result = errno;
+        }
+    }
+    if (!result) {
+        retValue->port  = ntohs(address.sin_port);
+        result          = pthread_create(&retValue->acceptThread, NULL, LoadGenServerAcceptRun, retValue);
+    }
+    
+    if (result) {
+        if (retValue->listenFd >= 0) {
+            close(retValue->listenFd);
+        }
+        if (retValue->wakeFds[0] >= 0) {
+            close(retValue->wakeFds[0]);
+            close(retValue->wakeFds[1]);
+        }
+        LoadGenTlsContextFree(retValue->tls);
+        pthread_mutex_destroy(&retValue->lock);
+        free(retValue);
+        return result;
+    }
+    
+    *server = retValue;
+    return 0;
+}
+
+uint16_t LoadGenServerPort(const LoadGenServer *server) {
+    return server->port;
+}
+
+uint64_t LoadGenServerRequestCount(LoadGenServer *server) {
+    return atomic_load(&server->requestCount);
+}
+
+uint64_t LoadGenServerConnectionCount(LoadGenServer *server) {
+    return atomic_load(&server->connectionCount);
+}
+
+void LoadGenServerStop(LoadGenServer *server) {
+    // Stop accepting first, so connection list does not change anymore.
+    if (write(server->wakeFds[1], "", 1) < 0) {
+        // Accept thread will not wake up. Nothing else we can do.
+    }
+    pthread_join(server->acceptThread, NULL);
+    
+    // Wake connections blocked in read. Their threads end right after that.
+    for (LoadGenConnection *loopConnection = server->connections; loopConnection; loopConnection = loopConnection->next) {
+        shutdown(loopConnection->stream.fd, SHUT_RDWR);
+    }
+    while (server->connections) {
+        LoadGenConnection *connection = server->connections;
+        server->connections = connection->next;
+        pthread_join(connection->thread, NULL);
+        LoadGenTlsClose(&connection->stream);
+        close(connection->stream.fd);
+        free(connection);
+    }
+    
+    close(server->listenFd);
+    close(server->wakeFds[0]);
+    close(server->wakeFds[1]);
+    LoadGenTlsContextFree(server->tls);
+    pthread_mutex_destroy(&server->lock);
+    free(server);
+}
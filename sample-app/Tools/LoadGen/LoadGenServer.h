@@ -0,0 +1,76 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#ifndef LoadGenServer_h
+#define LoadGenServer_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ Local stand-in of verification backend. Answers Auth_OTP, Sign_OTP and Sign_OTP_Batch the way
+ HttpManager expects it, so load generator can be checked without real server.
+ */
+typedef struct LoadGenServer LoadGenServer;
+
+typedef struct {
+    // Time server spends on each request before it answers.
+    unsigned    delayMicros;
+    // Share of requests answered with rejected OTP. 0 accepts everything, 1 rejects everything.
+    double      rejectRatio;
+    // Serve HTTPS with self-signed certificate instead of plain HTTP.
+    bool        tls;
+} LoadGenServerConfig;
+
+/**
+ Start server on loopback interface with port chosen by system.
+
+ @param config Server behaviour.
+ @param server Running server.
+ @return 0 on success, errno otherwise.
+ */
+int LoadGenServerStart(const LoadGenServerConfig *config, LoadGenServer **server);
+
+/**
+ @return Port server listens on.
+ */
+uint16_t LoadGenServerPort(const LoadGenServer *server);
+
+/**
+ @return Number of requests answered so far, including the invalid ones.
+ */
+uint64_t LoadGenServerRequestCount(LoadGenServer *server);
+
+/**
+ @return Number of connections accepted so far.
+ */
+uint64_t LoadGenServerConnectionCount(LoadGenServer *server);
+
+/**
+ Close all connections and release server.
+ */
+void LoadGenServerStop(LoadGenServer *server);
+
+#endif /* LoadGenServer_h */
@@ -0,0 +1,236 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#include "LoadGenTls.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#ifdef LOADGEN_TLS
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+struct LoadGenTlsContext {
+    SSL_CTX *context;
+};
+
+static int LoadGenTlsCertificate(SSL_CTX *context) {
+    // Short lived certificate of loopback server. Nobody verifies it.
+    EVP_PKEY    *key            = EVP_EC_gen("P-256");
+    X509        *certificate    = X509_new();
+    int         retValue        = EIO;
+    
+    if (key && certificate &&
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1) &&
+        X509_gmtime_adj(X509_getm_notBefore(certificate), 0) &&
+        X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 60 * 60) &&
+        X509_set_pubkey(certificate, key) &&
+        X509_NAME_add_entry_by_txt(X509_get_subject_name(certificate), "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0) &&
+        X509_set_issuer_name(certificate, X509_get_subject_name(certificate)) &&
+        X509_sign(certificate, key, EVP_sha256()) &&
+        SSL_CTX_use_certificate(context, certificate) == 1 &&
+        SSL_CTX_use_PrivateKey(context, key) == 1) {
+        retValue = 0;
+    }
+    
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    return retValue;
+}
+
+bool LoadGenTlsAvailable(void) {
+    return true;
+}
+
+int LoadGenTlsServerCreate(LoadGenTlsContext **context) {
+    LoadGenTlsContext *retValue = calloc(1, sizeof(LoadGenTlsContext));
+    if (!retValue) {
+        return ENOMEM;
+    }
+    
+    retValue->context = SSL_CTX_new(TLS_server_method());
+    if (!retValue->context || LoadGenTlsCertificate(retValue->context)) {
+        LoadGenTlsContextFree(retValue);
+        return EIO;
+    }
+    
+    // Each connection does full handshake. Client would not resume anyway.
+    SSL_CTX_set_session_cache_mode(retValue->context, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_options(retValue->context, SSL_OP_NO_TICKET);
+    SSL_CTX_set_num_tickets(retValue->context, 0);
+    
+    *context = retValue;
+    return 0;
+}
+
+int LoadGenTlsClientCreate(LoadGenTlsContext **context) {
+    LoadGenTlsContext *retValue = calloc(1, sizeof(LoadGenTlsContext));
+    if (!retValue) {
+        return ENOMEM;
+    }
+    
+    retValue->context = SSL_CTX_new(TLS_client_method());
+    if (!retValue->context) {
+        LoadGenTlsContextFree(retValue);
+        return EIO;
+    }
+    SSL_CTX_set_verify(retValue->context, SSL_VERIFY_NONE, NULL);
+    SSL_CTX_set_session_cache_mode(retValue->context, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_options(retValue->context, SSL_OP_NO_TICKET);
+    
+    *context = retValue;
+    return 0;
+}
+
+void LoadGenTlsContextFree(LoadGenTlsContext *context) {
+    if (context) {
+        SSL_CTX_free(context->context);
+        free(context);
+    }
+}
+
+static int LoadGenTlsHandshake(LoadGenTlsContext *context, LoadGenStream *stream, bool server) {
+    SSL *tls = SSL_new(context->context);
+    if (!tls) {
+        return ENOMEM;
+    }
+    
+    if (!SSL_set_fd(tls, stream->fd) || (server ? SSL_accept(tls) : SSL_connect(tls)) != 1) {
+        ERR_clear_error();
+        SSL_free(tls);
+        return EPROTO;
+    }
+    
+    stream->tls = tls;
+    return 0;
+}
+
+int LoadGenTlsAccept(LoadGenTlsContext *context, LoadGenStream *stream) {
+    return LoadGenTlsHandshake(context, stream, true);
+}
+
+int LoadGenTlsConnect(LoadGenTlsContext *context, LoadGenStream *stream) {
+    return LoadGenTlsHandshake(context, stream, false);
+}
+
+ssize_t LoadGenTlsSend(LoadGenStream *stream, const void *bytes, size_t length) {
+    size_t written = 0;
+    if (SSL_write_ex(stream->tls, bytes, length, &written) != 1) {
+        ERR_clear_error();
+        errno = EPIPE;
+        return -1;
+    }
+    
+    return (ssize_t)written;
+}
+
+ssize_t LoadGenTlsReceive(LoadGenStream *stream, void *bytes, size_t length) {
+    size_t read = 0;
+    if (SSL_read_ex(stream->tls, bytes, length, &read) != 1) {
+        // Clean close and broken connection look the same to the caller.
+        int error = SSL_get_error(stream->tls, 0);
+        ERR_clear_error();
+        if (error == SSL_ERROR_ZERO_RETURN) {
+            return 0;
+        }
+        errno = ECONNRESET;
+        return -1;
+    }
+    
+    return (ssize_t)read;
+}
+
+bool LoadGenTlsPending(LoadGenStream *stream) {
+    return SSL_pending(stream->tls) > 0;
+}
+
+void LoadGenTlsClose(LoadGenStream *stream) {
+    if (stream->tls) {
+        SSL_free(stream->tls);
+        stream->tls = NULL;
+    }
+}
+
+#else
+
+bool LoadGenTlsAvailable(void) {
+    return false;
+}
+
+int LoadGenTlsServerCreate(LoadGenTlsContext **context) {
+    (void)context;
+    return ENOTSUP;
+}
+
+int LoadGenTlsClientCreate(LoadGenTlsContext **context) {
+    (void)context;
+    return ENOTSUP;
+}
+
+void LoadGenTlsContextFree(LoadGenTlsContext *context) {
+    (void)context;
+}
+
+int LoadGenTlsAccept(LoadGenTlsContext *context, LoadGenStream *stream) {
+    (void)context;
+    (void)stream;
+    return ENOTSUP;
+}
+
+int LoadGenTlsConnect(LoadGenTlsContext *context, LoadGenStream *stream) {
+    (void)context;
+    (void)stream;
+    return ENOTSUP;
+}
+
+ssize_t LoadGenTlsSend(LoadGenStream *stream, const void *bytes, size_t length) {
+    (void)stream;
+    (void)bytes;
+    (void)length;
+    errno = ENOTSUP;
+    return -1;
+}
+
+ssize_t LoadGenTlsReceive(LoadGenStream *stream, void *bytes, size_t length) {
+    (void)stream;
+    (void)bytes;
+    (void)length;
+    errno = ENOTSUP;
+    return -1;
+}
+
+bool LoadGenTlsPending(LoadGenStream *stream) {
+    (void)stream;
+    return false;
+}
+
+void LoadGenTlsClose(LoadGenStream *stream) {
+    (void)stream;
+}
+
+#endif
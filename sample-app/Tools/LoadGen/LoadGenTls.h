@@ -0,0 +1,99 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+#ifndef LoadGenTls_h
+#define LoadGenTls_h
+
+#include "LoadGenHttp.h"
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ TLS of stand-in server and load generator. Built on OpenSSL when it's found, otherwise all calls fail with ENOTSUP.
+ Server uses freshly generated self-signed certificate and client does not verify it, so it's only meant for loopback.
+ */
+typedef struct LoadGenTlsContext LoadGenTlsContext;
+
+/**
+ @return true if load generator was built with TLS support.
+ */
+bool LoadGenTlsAvailable(void);
+
+/**
+ Create server context with self-signed certificate.
+
+ @return 0 on success, errno otherwise.
+ */
+int LoadGenTlsServerCreate(LoadGenTlsContext **context);
+
+/**
+ Create client context. Sessions are never resumed, so each new connection pays for full handshake,
+ same as fresh URL session used to.
+
+ @return 0 on success, errno otherwise.
+ */
+int LoadGenTlsClientCreate(LoadGenTlsContext **context);
+
+/**
+ Release context. Streams created with it must be closed first.
+ */
+void LoadGenTlsContextFree(LoadGenTlsContext *context);
+
+/**
+ Run server side of handshake over connected socket of the stream.
+
+ @return 0 on success, errno otherwise.
+ */
+int LoadGenTlsAccept(LoadGenTlsContext *context, LoadGenStream *stream);
+
+/**
+ Run client side of handshake over connected socket of the stream.
+
+ @return 0 on success, errno otherwise.
+ */
+int LoadGenTlsConnect(LoadGenTlsContext *context, LoadGenStream *stream);
+
+/**
+ Send over TLS stream. Same contract as send.
+ */
+ssize_t LoadGenTlsSend(LoadGenStream *stream, const void *bytes, size_t length);
+
+/**
+ Receive from TLS stream. Same contract as recv.
+ */
+ssize_t LoadGenTlsReceive(LoadGenStream *stream, void *bytes, size_t length);
+
+/**
+ @return true if TLS stream holds received data not read yet.
+ */
+bool LoadGenTlsPending(LoadGenStream *stream);
+
+/**
+ Release TLS state of the stream. Socket itself stays open.
+ */
+void LoadGenTlsClose(LoadGenStream *stream);
+
+#endif /* LoadGenTls_h */
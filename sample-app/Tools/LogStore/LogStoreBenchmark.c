@@ -0,0 +1,180 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// Linux runner of StorageBenchmark for portable LogStore core.
+// Usage: logstore_benchmark [operation count]
+
+#include "LogStore.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define kBenchmarkKeyPrefix "benchmark."
+
+typedef enum {
+    // 90 % reads, 10 % writes.
+    BenchmarkLoadReadHeavy,
+    // 10 % reads, 90 % writes.
+    BenchmarkLoadWriteHeavy,
+    // 50 % reads, 50 % writes.
+    BenchmarkLoadMixed
+} BenchmarkLoad;
+
+static const char * const kLoadNames[]  = { "read", "write", "mixed" };
+static const size_t kKeyCounts[]        = { 10, 100, 1000, 10000, 100000 };
+static const size_t kValueSizes[]       = { 16, 256, 4096 };
+
+static uint64_t BenchmarkNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static int BenchmarkCompareLatency(const void *first, const void *second) {
+    uint64_t lhs = *(const uint64_t *)first;
+    uint64_t rhs = *(const uint64_t *)second;
+    return lhs < rhs ? -1 : lhs > rhs;
+}
+
+static size_t BenchmarkKey(char *buffer, size_t capacity, size_t index) {
+    return (size_t)snprintf(buffer, capacity, kBenchmarkKeyPrefix "%zu", index);
+}
+
+static int BenchmarkMeasure(LogStore *store, BenchmarkLoad load, size_t keyCount, const char *value, size_t valueSize, size_t operationCount) {
+    unsigned    writePercent    = load == BenchmarkLoadReadHeavy ? 10 : load == BenchmarkLoadWriteHeavy ? 90 : 50;
+    uint64_t    *latencies      = calloc(operationCount ? operationCount : 1, sizeof(uint64_t));
+    size_t      *keys           = calloc(operationCount ? operationCount : 1, sizeof(size_t));
+    uint8_t     *writes         = calloc(operationCount ? operationCount : 1, 1);
+    int         retValue        = 0;
+    
+    if (!latencies || !keys || !writes) {
+        free(latencies);
+        free(keys);
+        free(writes);
+        return ENOMEM;
+    }
+    
+    // Keys are prepared up front, so only storage itself is measured.
+    for (size_t index = 0; index < operationCount; index++) {
+        keys[index]     = (size_t)rand() % keyCount;
+        writes[index]   = (unsigned)rand() % 100 < writePercent;
+    }
+    
+    uint64_t start = BenchmarkNow();
+    for (size_t index = 0; index < operationCount && !retValue; index++) {
+        char        key[32];
+        size_t      keyLength       = BenchmarkKey(key, sizeof(key), keys[index]);
+        uint64_t    operationStart  = BenchmarkNow();
+        if (writes[index]) {
+            retValue = LogStorePut(store, key, keyLength, value, valueSize);
+        } else {
+            void    *read       = NULL;
+            size_t  readLength  = 0;
+            int     result      = LogStoreGet(store, key, keyLength, &read, &readLength);
+            retValue = result == ENOENT ? 0 : result;
+            free(read);
+        }
+        latencies[index] = BenchmarkNow() - operationStart;
+    }
+    
+    // Postponed writes are part of the cost.
+    if (!retValue) {
+        retValue = LogStoreSync(store);
+    }
+    uint64_t total = BenchmarkNow() - start;
+    
+    if (!retValue) {
+        qsort(latencies, operationCount, sizeof(uint64_t), BenchmarkCompareLatency);
+        printf("logstore\t%s\t%zu\t%zu\t%.0f\t%.1f\n",
+               kLoadNames[load],
+               keyCount,
+               valueSize,
+               total ? operationCount * 1e9 / total : 0.,
+               operationCount ? latencies[(operationCount - 1) * 99 / 100] / 1e3 : 0.);
+    }
+    
+    free(latencies);
+    free(keys);
+    free(writes);
+    return retValue;
+}
+
+int main(int argc, const char *argv[]) {
+    size_t  operationCount  = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 1000;
+    char    path[]          = "/tmp/LogStoreBenchmark.XXXXXX";
+    int     fd              = mkstemp(path);
+    int     retValue        = 0;
+    
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    unlink(path);
+    
+    printf("storage\tload\tkeys\tvalue\tops/s\tp99 [us]\n");
+    for (size_t keyIndex = 0; keyIndex < sizeof(kKeyCounts) / sizeof(kKeyCounts[0]) && !retValue; keyIndex++) {
+        for (size_t sizeIndex = 0; sizeIndex < sizeof(kValueSizes) / sizeof(kValueSizes[0]) && !retValue; sizeIndex++) {
+            size_t      keyCount    = kKeyCounts[keyIndex];
+            size_t      valueSize   = kValueSizes[sizeIndex];
+            char        *value      = malloc(valueSize);
+            LogStore    *store      = NULL;
+            
+            // Each configuration starts with fresh file. Prefill is not measured.
+            if (!value || (retValue = LogStoreOpen(path, &store))) {
+                free(value);
+                retValue = retValue ? retValue : ENOMEM;
+                break;
+            }
+            memset(value, 'x', valueSize);
+            for (size_t index = 0; index < keyCount && !retValue; index++) {
+                char key[32];
+                retValue = LogStorePut(store, key, BenchmarkKey(key, sizeof(key), index), value, valueSize);
+            }
+            if (!retValue) {
+                retValue = LogStoreSync(store);
+            }
+            
+            for (BenchmarkLoad load = BenchmarkLoadReadHeavy; load <= BenchmarkLoadMixed && !retValue; load++) {
+                retValue = BenchmarkMeasure(store, load, keyCount, value, valueSize, operationCount);
+            }
+            
+            LogStoreClose(store);
+            unlink(path);
+            free(value);
+        }
+    }
+    
+    if (retValue) {
+        fprintf(stderr, "LogStore failed: %s\n", strerror(retValue));
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,274 @@
+//  MIT License
+//
+//  Copyright (c) 2020 Thales DIS
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//  SOFTWARE.
+
+// IMPORTANT: This source code is intended to serve training information purposes only.
+//            Please make sure to review our IdCloud documentation, including security guidelines.
+
+// Linux checks of portable LogStore core. Each test works on its own scratch file.
+// Usage: logstore_tests [scratch directory]
+
+#include "LogStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        return 1; \
+    } \
+} while (0)
+
+static char sPath[4096];
+
+static LogStore *TestOpen(void) {
+    LogStore *retValue = NULL;
+    return LogStoreOpen(sPath, &retValue) ? NULL : retValue;
+}
+
+static int TestPut(LogStore *store, const char *key, const char *value) {
+    return LogStorePut(store, key, strlen(key), value, strlen(value));
+}
+
+// Returns 1 when key holds exactly given value. NULL value expects missing key.
+static int TestHas(LogStore *store, const char *key, const char *value) {
+    void    *stored         = NULL;
+    size_t  storedLength    = 0;
+    int     result          = LogStoreGet(store, key, strlen(key), &stored, &storedLength);
+    int     retValue        = value ? !result && storedLength == strlen(value) && !memcmp(stored, value, storedLength)
+                                    : result == ENOENT;
+    free(stored);
+    return retValue;
+}
+
+static off_t TestFileSize(void) {
+    struct stat info;
+    return stat(sPath, &info) ? -1 : info.st_size;
+}
+
+// MARK: - Tests
+
+static int TestPutGetRemove(void) {
+    LogStore *store = TestOpen();
+    CHECK(store);
+    CHECK(TestHas(store, "missing", NULL));
+    CHECK(!TestPut(store, "key", "first"));
+    CHECK(!TestPut(store, "key", "second"));
+    CHECK(TestHas(store, "key", "second"));
+    CHECK(!LogStorePut(store, "empty", 5, "", 0));
+    CHECK(TestHas(store, "empty", ""));
+    CHECK(!LogStoreRemove(store, "key", 3));
+    CHECK(TestHas(store, "key", NULL));
+    CHECK(LogStoreGetStats(store).count == 1);
+    LogStoreClose(store);
+    return 0;
+}
+
+static int TestReopen(void) {
+    LogStore *store = TestOpen();
+    CHECK(store);
+    CHECK(!TestPut(store, "kept", "value"));
+    CHECK(!TestPut(store, "removed", "value"));
+    CHECK(!LogStoreRemove(store, "removed", 7));
+    CHECK(!TestPut(store, "changed", "old"));
+    CHECK(!TestPut(store, "changed", "new"));
+    CHECK(!LogStoreSync(store));
+    LogStoreClose(store);
+    
+    store = TestOpen();
+    CHECK(store);
+    CHECK(TestHas(store, "kept", "value"));
+    CHECK(TestHas(store, "removed", NULL));
+    CHECK(TestHas(store, "changed", "new"));
+    CHECK(LogStoreGetStats(store).count == 2);
+    LogStoreClose(store);
+    return 0;
+}
+
+static int TestBatch(void) {
+    LogStore *store = TestOpen();
+    CHECK(store);
+    CHECK(!TestPut(store, "gone", "value"));
+    
+    LogStoreOperation operations[] = {
+        { "first", 5, "1", 1 },
+        { "second", 6, "2", 1 },
+        { "gone", 4, NULL, 0 }
+    };
+    CHECK(!LogStoreWrite(store, operations, 3));
+    CHECK(TestHas(store, "first", "1"));
+    CHECK(TestHas(store, "second", "2"));
+    CHECK(TestHas(store, "gone", NULL));
+    LogStoreClose(store);
+    return 0;
+}
+
+static int TestTornBatch(void) {
+    LogStore *store = TestOpen();
+    CHECK(store);
+    CHECK(!TestPut(store, "before", "value"));
+    CHECK(!LogStoreSync(store));
+    off_t committed = TestFileSize();
+    
+    LogStoreOperation operations[] = {
+        { "first", 5, "1", 1 },
+        { "second", 6, "2", 1 }
+    };
+    CHECK(!LogStoreWrite(store, operations, 2));
+    CHECK(!LogStoreSync(store));
+    LogStoreClose(store);
+    
+    // Crash in the middle of last record. Whole batch must disappear, older data must stay.
+    off_t size = TestFileSize();
+    CHECK(size > committed);
+    CHECK(!truncate(sPath, size - 1));
+    
+    store = TestOpen();
+    CHECK(store);
+    CHECK(TestHas(store, "before", "value"));
+    CHECK(TestHas(store, "first", NULL));
+    CHECK(TestHas(store, "second", NULL));
+    CHECK(TestFileSize() == committed);
+    
+    // Store stays writable after dropping the tail.
+    CHECK(!TestPut(store, "after", "value"));
+    LogStoreClose(store);
+    
+    store = TestOpen();
+    CHECK(store);
+    CHECK(TestHas(store, "after", "value"));
+    LogStoreClose(store);
+    return 0;
+}
+
+static int TestCorruptedTail(void) {
+    LogStore *store = TestOpen();
+    CHECK(store);
+    CHECK(!TestPut(store, "key", "value"));
+    CHECK(!LogStoreSync(store));
+    LogStoreClose(store);
+    off_t committed = TestFileSize();
+    
+    int fd = open(sPath, O_WRONLY | O_APPEND);
+    CHECK(fd >= 0);
+    static const char garbage[] = "\x01\x02\x03garbage record without valid checksum";
+    CHECK(write(fd, garbage, sizeof(garbage)) == (ssize_t)sizeof(garbage));
+    close(fd);
+    
+    store = TestOpen();
+    CHECK(store);
+    CHECK(TestHas(store, "key", "value"));
+    CHECK(TestFileSize() == committed);
+    LogStoreClose(store);
+    return 0;
+}
+
+static int TestForeignFile(void) {
+    int fd = open(sPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    CHECK(write(fd, "NOTASTORE", 9) == 9);
+    close(fd);
+    
+    LogStore *store = NULL;
+    CHECK(LogStoreOpen(sPath, &store) != 0);
+    CHECK(!store);
+    return 0;
+}
+
+static int TestCompact(void) {
+    LogStore *store = TestOpen();
+    CHECK(store);
+    char key[32];
+    for (int loopIndex = 0; loopIndex < 1000; loopIndex++) {
+        snprintf(key, sizeof(key), "key.%d", loopIndex % 100);
+        CHECK(!TestPut(store, key, loopIndex % 2 ? "odd" : "even"));
+    }
+    for (int loopIndex = 0; loopIndex < 50; loopIndex++) {
+        snprintf(key, sizeof(key), "key.%d", loopIndex);
+        CHECK(!LogStoreRemove(store, key, strlen(key)));
+    }
+    
+    LogStoreStats before = LogStoreGetStats(store);
+    CHECK(before.count == 50);
+    CHECK(before.liveSize < before.fileSize);
+    
+    CHECK(!LogStoreCompact(store));
+    LogStoreStats after = LogStoreGetStats(store);
+    CHECK(after.count == 50);
+    // Only file header is left on top of live records.
+    CHECK(after.fileSize - after.liveSize == 8);
+    CHECK(after.fileSize < before.fileSize);
+    CHECK(TestHas(store, "key.10", NULL));
+    CHECK(TestHas(store, "key.51", "odd"));
+    CHECK(TestHas(store, "key.98", "even"));
+    
+    // Compacted file must be complete on its own.
+    CHECK(!TestPut(store, "key.10", "back"));
+    LogStoreClose(store);
+    store = TestOpen();
+    CHECK(store);
+    CHECK(LogStoreGetStats(store).count == 51);
+    CHECK(TestHas(store, "key.10", "back"));
+    CHECK(TestHas(store, "key.99", "odd"));
+    LogStoreClose(store);
+    return 0;
+}
+
+// MARK: - Runner
+
+typedef struct {
+    const char  *name;
+    int         (*run)(void);
+} TestCase;
+
+static const TestCase kTests[] = {
+    { "PutGetRemove",   TestPutGetRemove },
+    { "Reopen",         TestReopen },
+    { "Batch",          TestBatch },
+    { "TornBatch",      TestTornBatch },
+    { "CorruptedTail",  TestCorruptedTail },
+    { "ForeignFile",    TestForeignFile },
+    { "Compact",        TestCompact }
+};
+
+int main(int argc, const char *argv[]) {
+    const char  *directory  = argc > 1 ? argv[1] : "/tmp";
+    int         failures    = 0;
+    
+    for (size_t loopIndex = 0; loopIndex < sizeof(kTests) / sizeof(kTests[0]); loopIndex++) {
+        snprintf(sPath, sizeof(sPath), "%s/logstore_test_%ld_%s", directory, (long)getpid(), kTests[loopIndex].name);
+        unlink(sPath);
+        
+        int failed = kTests[loopIndex].run();
+        printf("%-16s %s\n", kTests[loopIndex].name, failed ? "FAILED" : "OK");
+        failures += failed;
+        
+        unlink(sPath);
+    }
+    
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}